@@ -3,14 +3,30 @@
 //
 
 #include "ljson.h"
+#include "ljson_context.h"
+#include "ljson_conv.h"
+#include "ljson_file.h"
+#include "ljson_index.h"
+#include "ljson_parser.h"
+#include "ljson_push.h"
 #include <cassert> // assert()
 #include <cmath>   // HUGE_VAL
 #include <algorithm>
+#include <atomic>  // atomic_thread_fence()
+#include <cstring> // memcpy()
 
 #ifndef LJSON_PARSE_STACK_INIT_SIZE
 #define LJSON_PARSE_STACK_INIT_SIZE 256
 #endif
 
+#ifndef LJSON_ARENA_INIT_SIZE
+#define LJSON_ARENA_INIT_SIZE 4096
+#endif
+
+#ifndef LJSON_ARENA_MAX_CHUNK_SIZE
+#define LJSON_ARENA_MAX_CHUNK_SIZE (1 << 20)
+#endif
+
 namespace ljson {
 
 namespace {
@@ -19,20 +35,64 @@ bool isdigit(const char& ch) { return ch >= '0' && ch <= '9'; }
 
 bool isdigit1to9(const char& ch) { return ch >= '1' && ch <= '9'; }
 
-std::shared_ptr<ljson_value> create_ljson_value_by_type(LJSON_TYPE type) {
+/*
+ * store an integer literal exactly when it fits in 64 bits
+ * @digits: significant digits accumulated, wrapped around, in d.mantissa
+ * @return: false when the number has to be a double, "-0" included
+ */
+bool parse_integer(const conv::decimal& d, int digits, ljson_number_value *number) {
+  uint64_t value = d.mantissa;
+  if (digits > conv::kMaxMantissaDigits) {
+    // only 20 digits up to 18446744073709551615 fit
+    if (digits > conv::kMaxMantissaDigits + 1)
+      return false;
+    const char* p = d.first + d.negative;
+    uint64_t head = 0;
+    for (int i = 0; i < conv::kMaxMantissaDigits; ++i)
+      head = head * 10 + static_cast<uint64_t>(p[i] - '0');
+    auto last = static_cast<uint64_t>(p[conv::kMaxMantissaDigits] - '0');
+    if (head > (UINT64_MAX - last) / 10)
+      return false;
+    value = head * 10 + last;
+  }
+  if (d.negative) {
+    if (value == 0 || value > static_cast<uint64_t>(INT64_MAX) + 1)
+      return false;
+    number->type = LJSON_NUMBER_INT64;
+    number->int64 = value == static_cast<uint64_t>(INT64_MAX) + 1 ? INT64_MIN : -static_cast<int64_t>(value);
+  } else if (value <= static_cast<uint64_t>(INT64_MAX)) {
+    number->type = LJSON_NUMBER_INT64;
+    number->int64 = static_cast<int64_t>(value);
+  } else {
+    number->type = LJSON_NUMBER_UINT64;
+    number->uint64 = value;
+  }
+  return true;
+}
+
+/// FNV-1a, keys are short and this is one multiply per byte
+size_t hash_key(const char* key, size_t len) {
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < len; ++i) {
+    h ^= static_cast<unsigned char>(key[i]);
+    h *= 0x100000001b3ULL;
+  }
+  return static_cast<size_t>(h ^ (h >> 32));
+}
+
+/// literals carry no state, every parsed document shares these
+ljson_null null_literal;
+ljson_true true_literal;
+ljson_false false_literal;
+
+ljson_value* literal_by_type(LJSON_TYPE type) {
   switch (type) {
     case LJSON_NULL:
-      return ljson_null::create();
+      return &null_literal;
     case LJSON_TRUE:
-      return ljson_true::create();
+      return &true_literal;
     case LJSON_FALSE:
-      return ljson_false::create();
-    case LJSON_STRING:
-      return ljson_string::create();
-    case LJSON_ARRAY:
-      return ljson_array::create();
-    case LJSON_OBJECT:
-      return ljson_objects::create();
+      return &false_literal;
     default:
       return nullptr;
   }
@@ -40,48 +100,269 @@ std::shared_ptr<ljson_value> create_ljson_value_by_type(LJSON_TYPE type) {
 
 }
 
-struct ljson_context {
-public:
-  explicit ljson_context(const char* json) : json_(json), stack_(nullptr), size_(0), top_(0) {}
-  ~ljson_context();
-  void parse_whitespace();
-  std::shared_ptr<ljson_value> parse_literal(const char* literal, LJSON_TYPE type, int *ret);
-  std::shared_ptr<ljson_value> parse_number(int *ret);
-  std::shared_ptr<ljson_value> parse_value(int *ret);
-  void encode_uft8(unsigned u);
-  LJSON_STATE parse_string_raw(char **str, size_t *len);
-  std::shared_ptr<ljson_value> parse_string(int *ret);
-  std::shared_ptr<ljson_value> parse_array(int *ret);
-  std::shared_ptr<ljson_value> parse_object(int *ret);
-
-public:
-  static const char* parse_hex4(const char* p, unsigned *u);
-  void put_char(char ch);
-  void *push(size_t size);
-  void *pop(size_t size);
-  void push_buffer(std::shared_ptr<void> value);
-
-  template<typename T>
-  std::vector<std::shared_ptr<T>> pop_buffer(size_t size);
-
-public:
-  const char *json_;
-  char *stack_;
-  size_t size_, top_;
-  std::vector<std::shared_ptr<void>> array_buffer_;
-  /*
-   * @ch: next expected character
-   * @noted: exit if next character is not ch
-   */
-  void expect_next(const char &ch);
+struct ljson_arena::chunk {
+  chunk* next;
 };
 
+struct ljson_arena::cleanup {
+  void (*fn)(void*);
+  void* obj;
+  cleanup* next;
+};
+
+ljson_arena::~ljson_arena() {
+  for (cleanup* c = cleanups_; c != nullptr; c = c->next)
+    c->fn(c->obj);
+  while (head_ != nullptr) {
+    chunk* next = head_->next;
+    ::operator delete(head_);
+    head_ = next;
+  }
+}
+
+void ljson_arena::reset() {
+  for (cleanup* c = cleanups_; c != nullptr; c = c->next)
+    c->fn(c->obj);
+  cleanups_ = nullptr;
+  if (head_ == nullptr)
+    return;
+  /// the current chunk is the largest one, oversized requests aside
+  chunk* next = head_->next;
+  while (next != nullptr) {
+    chunk* c = next;
+    next = c->next;
+    ::operator delete(c);
+  }
+  head_->next = nullptr;
+  chunk_count_ = 1;
+  cur_ = reinterpret_cast<char*>(head_ + 1);
+}
+
+void* ljson_arena::allocate_slow(size_t size, size_t align) {
+  if (next_size_ == 0)
+    next_size_ = LJSON_ARENA_INIT_SIZE;
+  size_t need = sizeof(chunk) + size + align;
+  auto c = static_cast<chunk*>(::operator new(std::max(need, next_size_)));
+  chunk_count_++;
+  auto p = reinterpret_cast<uintptr_t>(c + 1);
+  auto aligned = (p + align - 1) & ~static_cast<uintptr_t>(align - 1);
+  if (need > next_size_ / 2 && head_ != nullptr) {
+    /// oversized request gets its own chunk, keep bumping in the current one
+    c->next = head_->next;
+    head_->next = c;
+    return reinterpret_cast<void*>(aligned);
+  }
+  c->next = head_;
+  head_ = c;
+  end_ = reinterpret_cast<char*>(c) + std::max(need, next_size_);
+  cur_ = reinterpret_cast<char*>(aligned + size);
+  if (next_size_ < LJSON_ARENA_MAX_CHUNK_SIZE)
+    next_size_ <<= 1;
+  return reinterpret_cast<void*>(aligned);
+}
+
+const char* ljson_arena::copy_string(const char* str, size_t len) {
+  if (len == 0)
+    return "";
+  auto dst = static_cast<char*>(allocate(len, 1));
+  memcpy(dst, str, len);
+  return dst;
+}
+
+void ljson_arena::add_cleanup(void (*fn)(void*), void* obj) {
+  auto c = create<cleanup>();
+  c->fn = fn;
+  c->obj = obj;
+  c->next = cleanups_;
+  cleanups_ = c;
+}
+
+void ljson_string::set_value(std::shared_ptr<void> value) {
+  auto real_ptr = std::static_pointer_cast<std::string>(value);
+  if (arena_ != nullptr) {
+    size_ = real_ptr->size();
+    data_ = arena_->copy_string(real_ptr->data(), size_);
+  } else {
+    str_ = *real_ptr;
+  }
+}
+
+std::shared_ptr<void> ljson_array::get_value() const {
+  if (arena_ == nullptr)
+    return std::make_shared<std::vector<std::shared_ptr<ljson_value>>>(elements_);
+  auto owner = arena_->shared_from_this();
+  auto elements = std::make_shared<std::vector<std::shared_ptr<ljson_value>>>();
+  elements->reserve(size_);
+  for (size_t i = 0; i < size_; ++i)
+    elements->emplace_back(owner, values_[i]);
+  return elements;
+}
+
+void ljson_array::set_value(std::shared_ptr<void> value) {
+  auto real_ptr = std::static_pointer_cast<std::vector<std::shared_ptr<ljson_value>>>(value);
+  if (arena_ == nullptr) {
+    elements_ = *real_ptr;
+    index_elements();
+    return;
+  }
+  /// new elements are not arena nodes, keep them alive as long as the arena
+  auto holder = arena_->create_with_cleanup<std::vector<std::shared_ptr<ljson_value>>>(*real_ptr);
+  size_ = holder->size();
+  values_ = arena_->allocate_array<ljson_value*>(size_);
+  for (size_t i = 0; i < size_; ++i)
+    values_[i] = (*holder)[i].get();
+}
+
+void ljson_array::index_elements() {
+  raw_.resize(elements_.size());
+  for (size_t i = 0; i < elements_.size(); ++i)
+    raw_[i] = elements_[i].get();
+}
+
+std::shared_ptr<void> ljson_objects::get_value() const {
+  auto members = std::make_shared<std::vector<std::shared_ptr<ljson_member>>>();
+  if (arena_ == nullptr) {
+    members->reserve(members_.size());
+    for (const auto& m : members_)
+      members->push_back(std::make_shared<ljson_member>(m->key, m->value));
+    return members;
+  }
+  auto owner = arena_->shared_from_this();
+  members->reserve(size_);
+  for (size_t i = 0; i < size_; ++i) {
+    const entry& e = entries_[i];
+    members->push_back(std::make_shared<ljson_member>(std::string(e.key, e.key_size),
+                                                      std::shared_ptr<ljson_value>(owner, e.value)));
+  }
+  return members;
+}
+
+void ljson_objects::set_value(std::shared_ptr<void> value) {
+  auto real_ptr = std::static_pointer_cast<std::vector<std::shared_ptr<ljson_member>>>(value);
+  // the index holds positions into the entries about to be replaced
+  delete[] index_.exchange(nullptr);
+  if (arena_ == nullptr) {
+    members_ = *real_ptr;
+    index_members();
+    return;
+  }
+  /// new values are not arena nodes, keep them alive as long as the arena; the
+  /// members stay the caller's, it may assign to them afterwards
+  auto holder = arena_->create_with_cleanup<std::vector<std::shared_ptr<ljson_value>>>();
+  size_ = real_ptr->size();
+  holder->reserve(size_);
+  entries_ = arena_->allocate_array<entry>(size_);
+  for (size_t i = 0; i < size_; ++i) {
+    const ljson_member& m = *(*real_ptr)[i];
+    holder->push_back(m.value);
+    entries_[i].key = arena_->copy_string(m.key.data(), m.key.size());
+    entries_[i].key_size = m.key.size();
+    entries_[i].value = m.value.get();
+  }
+  cleanup_by_arena();
+}
+
+ljson_objects::~ljson_objects() {
+  delete[] index_.load();
+}
+
+void ljson_objects::cleanup_by_arena() {
+  if (arena_cleanup_ || size_ < kHashMinSize)
+    return;
+  arena_cleanup_ = true;
+  arena_->add_cleanup([](void* p) { static_cast<ljson_objects*>(p)->~ljson_objects(); }, this);
+}
+
+const ljson_value& ljson_value::null_value() {
+  return null_literal;
+}
+
+const ljson_value& ljson_objects::value_or_null(const ljson_value* value) {
+  return value != nullptr ? *value : null_literal;
+}
+
+const uint32_t* ljson_objects::build_index() const {
+  const entry* e = entries();
+  size_t n = size();
+  // at most half full, probes stay short
+  size_t capacity = 1;
+  while (capacity < 2 * n)
+    capacity <<= 1;
+  auto slots = new uint32_t[capacity + 1]();
+  slots[0] = static_cast<uint32_t>(capacity - 1);
+  uint32_t* table = slots + 1;
+  for (size_t i = 0; i < n; ++i) {
+    size_t h = hash_key(e[i].key, e[i].key_size) & (capacity - 1);
+    for (;; h = (h + 1) & (capacity - 1)) {
+      if (table[h] == 0) {
+        table[h] = static_cast<uint32_t>(i + 1);
+        break;
+      }
+      // a duplicate key, the first member keeps the slot
+      const entry& other = e[table[h] - 1];
+      if (other.key_size == e[i].key_size && memcmp(other.key, e[i].key, e[i].key_size) == 0)
+        break;
+    }
+  }
+  const uint32_t* expected = nullptr;
+  // another thread may have built the same index meanwhile, keep the first one
+  if (!index_.compare_exchange_strong(expected, slots, std::memory_order_acq_rel, std::memory_order_acquire)) {
+    delete[] slots;
+    return expected;
+  }
+  return slots;
+}
+
+const ljson_value* ljson_objects::find(const char* key, size_t len) const {
+  const entry* e = entries();
+  size_t n = size();
+  if (n < kHashMinSize || n > UINT32_MAX / 4) {
+    for (size_t i = 0; i < n; ++i)
+      if (e[i].key_size == len && memcmp(e[i].key, key, len) == 0)
+        return e[i].value;
+    return nullptr;
+  }
+  const uint32_t* slots = index_.load(std::memory_order_acquire);
+  if (slots == nullptr)
+    slots = build_index();
+  size_t mask = slots[0];
+  const uint32_t* table = slots + 1;
+  for (size_t h = hash_key(key, len) & mask; table[h] != 0; h = (h + 1) & mask) {
+    const entry& m = e[table[h] - 1];
+    if (m.key_size == len && memcmp(m.key, key, len) == 0)
+      return m.value;
+  }
+  return nullptr;
+}
+
+void ljson_objects::index_members() {
+  raw_.resize(members_.size());
+  for (size_t i = 0; i < members_.size(); ++i) {
+    // the caller may still assign to the member it passed, raw_ points into the copy
+    members_[i] = std::make_shared<ljson_member>(members_[i]->key, members_[i]->value);
+    raw_[i] = entry{members_[i]->key.data(), members_[i]->key.size(), members_[i]->value.get()};
+  }
+}
+
 ljson_context::~ljson_context() {
   assert(top_ == 0);
   if (stack_ != nullptr)
     free(stack_);
 }
 
+void ljson_context::reset(const char* json, const char* end, ljson_arena* arena, bool insitu, bool padded) {
+  json_ = json;
+  end_ = end;
+  arena_ = arena;
+  insitu_ = insitu;
+  padded_ = padded;
+  borrow_ = false;
+  top_ = 0;
+  values_.clear();
+  keys_.clear();
+  frames_.clear();
+}
+
 void ljson_context::put_char(char ch) {
   auto address = static_cast<char *>(push(sizeof(char)));
   *address = ch;
@@ -107,100 +388,104 @@ void * ljson_context::pop(size_t size) {
   return stack_ + (top_ -= size);
 }
 
-void ljson_context::push_buffer(std::shared_ptr<void> value) {
-  array_buffer_.push_back(std::move(value));
-}
-
 template <typename T>
-std::vector<std::shared_ptr<T> > ljson_context::pop_buffer(size_t size) {
-  assert(size <= array_buffer_.size());
-  std::vector<std::shared_ptr<T>> pops;
-  while (size > 0) {
-    size--;
-    auto back = std::static_pointer_cast<T>(array_buffer_.back());
-    pops.push_back(back);
-    array_buffer_.pop_back();
-  }
-  // notice that reverse is must, we need to keep the order as elements were pushed.
-  std::reverse(pops.begin(), pops.end());
-  return pops;
-}
-
-void ljson_context::expect_next(const char &ch) {
-  assert(*json_ == ch);
-  json_++;
+T* ljson_context::pop_slice(std::vector<T>& stack, size_t size) {
+  assert(size <= stack.size());
+  auto slice = arena_->allocate_array<T>(size);
+  // the tail keeps the order the items were pushed in
+  if (size != 0)
+    memcpy(slice, stack.data() + stack.size() - size, size * sizeof(T));
+  stack.resize(stack.size() - size);
+  return slice;
 }
 
-void ljson_context::parse_whitespace() {
-  const char* p = json_;
-  while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')
-    p++;
-  json_ = p;
-}
-
-std::shared_ptr<ljson_value> ljson_context::parse_literal(const char *literal, LJSON_TYPE type, int *ret) {
+LJSON_STATE ljson_context::parse_literal_raw(const char *literal) {
   size_t i = 0;
   expect_next(literal[0]);
-  *ret = LJSON_PARSE_OK;
   for (; literal[i+1]; i++)
-    if (json_[i] != literal[i+1]) {
-      *ret = LJSON_PARSE_INVALID_VALUE;
-      return nullptr;
-    }
+    if (json_ + i == end_ || json_[i] != literal[i+1])
+      return LJSON_PARSE_INVALID_VALUE;
   json_ += i;
-  return create_ljson_value_by_type(type);
+  return LJSON_PARSE_OK;
 }
 
-std::shared_ptr<ljson_value> ljson_context::parse_number(int *ret) {
+LJSON_STATE ljson_context::parse_number_raw(ljson_number_value *number) {
   const char* p = json_;
-  *ret = LJSON_PARSE_OK;
+  // '\0' stands for the end of the input, it ends the number like any other character
+  auto at = [this](const char* q) { return q != end_ ? *q : '\0'; };
+  conv::decimal d;
+  d.mantissa = 0;
+  d.negative = false;
+  d.truncated = false;
+  d.first = p;
+  // significant digits in d.mantissa, leading zeros excluded
+  int digits = 0;
+  int64_t fraction = 0, exponent = 0;
+  bool integer = true;
   // process sign character
-  if (*p == '-') p++;
+  if (at(p) == '-') {
+    d.negative = true;
+    p++;
+  }
   // process only one '0'
-  if (*p == '0') p++;
+  if (at(p) == '0') p++;
   else {
-    if (!isdigit1to9(*p)) {
-      *ret = LJSON_PARSE_INVALID_VALUE;
-      return nullptr;
-    }
+    if (!isdigit1to9(at(p)))
+      return LJSON_PARSE_INVALID_VALUE;
     // process all digits
-    for (p++; isdigit(*p); ++p);
+    for (; isdigit(at(p)); ++p, ++digits)
+      d.mantissa = d.mantissa * 10 + static_cast<uint64_t>(*p - '0');
   }
-  if (*p == '.') {
+  if (at(p) == '.') {
     p++;
-    if (!isdigit(*p)) {
-      *ret = LJSON_PARSE_INVALID_VALUE;
-      return nullptr;
-    }
+    integer = false;
+    if (!isdigit(at(p)))
+      return LJSON_PARSE_INVALID_VALUE;
     // process all digits
-    for (p++; isdigit(*p); ++p);
+    const char* fraction_first = p;
+    for (; isdigit(at(p)); ++p) {
+      d.mantissa = d.mantissa * 10 + static_cast<uint64_t>(*p - '0');
+      digits += digits != 0 || *p != '0';
+    }
+    fraction = p - fraction_first;
   }
-  if (*p == 'e' || *p == 'E') {
+  if (at(p) == 'e' || at(p) == 'E') {
     p++;
-    if (*p == '+' || *p == '-') p++;
-    if (!isdigit(*p)) {
-      *ret = LJSON_PARSE_INVALID_VALUE;
-      return nullptr;
-    }
-    // process all digits
-    for (p++; isdigit(*p); ++p);
-  }
-  errno = 0;
-  auto number = strtod(json_, nullptr);
-  // in set_number we set the type to LJSON_NUMBER
-  auto value = ljson_number::create(number);
-  if (errno == ERANGE && (number == HUGE_VAL || number == -HUGE_VAL)) {
-    // we have to set back value type to LSJON_NULL
-    *ret = LJSON_PARSE_NUMBER_TOO_BIG;
-    return nullptr;
+    integer = false;
+    bool negative = false;
+    if (at(p) == '+' || at(p) == '-')
+      negative = *p++ == '-';
+    if (!isdigit(at(p)))
+      return LJSON_PARSE_INVALID_VALUE;
+    // process all digits, anything past 10^8 is out of range anyway
+    for (; isdigit(at(p)); ++p)
+      if (exponent < 100000000)
+        exponent = exponent * 10 + (*p - '0');
+    if (negative)
+      exponent = -exponent;
+  }
+  d.exponent = exponent - fraction;
+  d.last = p;
+  if (integer && parse_integer(d, digits, number)) {
+    json_ = p;
+    return LJSON_PARSE_OK;
   }
+  // the mantissa wrapped around, take the digits again from the text
+  if (digits > conv::kMaxMantissaDigits)
+    conv::truncate_decimal(&d);
+  number->type = LJSON_NUMBER_DOUBLE;
+  number->number = conv::to_double(d);
+  if (number->number == HUGE_VAL || number->number == -HUGE_VAL)
+    return LJSON_PARSE_NUMBER_TOO_BIG;
   json_ = p;
-  return value;
+  return LJSON_PARSE_OK;
 }
 
 // reference: https://zhuanlan.zhihu.com/p/22731540
-const char* ljson_context::parse_hex4(const char *p, unsigned int *u) {
+const char* ljson_context::parse_hex4(const char *p, const char *end, unsigned int *u) {
   *u = 0;
+  if (end - p < 4)
+    return nullptr;
   for (int i = 0; i < 4; ++i) {
     char ch = *p++;
     *u <<= 4;
@@ -212,34 +497,95 @@ const char* ljson_context::parse_hex4(const char *p, unsigned int *u) {
   return p;
 }
 
-void ljson_context::encode_uft8(unsigned int u) {
-  if (u <= 0x7F)
-    put_char(u & 0xFF);
+size_t ljson_context::encode_utf8(unsigned int u, char *out) {
+  if (u <= 0x7F) {
+    out[0] = u & 0xFF;
+    return 1;
+  }
   else if (u <= 0x7FF) {
-    put_char(0xC0 | ((u >> 6) & 0xFF));
-    put_char(0x80 | ( u & 0x3F));
+    out[0] = 0xC0 | ((u >> 6) & 0xFF);
+    out[1] = 0x80 | ( u & 0x3F);
+    return 2;
   }
   else if (u <= 0xFFFF) {
-    put_char(0xE0 | ((u >> 12) & 0xFF));
-    put_char(0x80 | ((u >>  6) & 0x3F));
-    put_char(0x80 | ( u        & 0x3F));
+    out[0] = 0xE0 | ((u >> 12) & 0xFF);
+    out[1] = 0x80 | ((u >>  6) & 0x3F);
+    out[2] = 0x80 | ( u        & 0x3F);
+    return 3;
   }
   else {
     assert(u <= 0x10FFFF);
-    put_char(0xF0 | ((u >> 18) & 0xFF));
-    put_char(0x80 | ((u >> 12) & 0x3F));
-    put_char(0x80 | ((u >>  6) & 0x3F));
-    put_char(0x80 | ( u        & 0x3F));
+    out[0] = 0xF0 | ((u >> 18) & 0xFF);
+    out[1] = 0x80 | ((u >> 12) & 0x3F);
+    out[2] = 0x80 | ((u >>  6) & 0x3F);
+    out[3] = 0x80 | ( u        & 0x3F);
+    return 4;
+  }
+}
+
+const char* ljson_context::parse_escape(const char *p, const char *end, char *out, size_t *n, LJSON_STATE *state) {
+  *n = 1;
+  switch (p != end ? *p++ : '\0') {
+    case '\"': *out = '\"'; return p;
+    case '\\': *out = '\\'; return p;
+    case '/':  *out = '/';  return p;
+    case 'b':  *out = '\b'; return p;
+    case 'f':  *out = '\f'; return p;
+    case 'n':  *out = '\n'; return p;
+    case 'r':  *out = '\r'; return p;
+    case 't':  *out = '\t'; return p;
+    case 'u':
+      unsigned u, u2;
+      *state = LJSON_PARSE_INVALID_UNICODE_HEX;
+      if (!(p = parse_hex4(p, end, &u)))
+        return nullptr;
+      if (u >= 0xD800 && u <= 0xDBFF) {
+        *state = LJSON_PARSE_INVALID_UNICODE_SURROGATE;
+        if (end - p < 2 || p[0] != '\\' || p[1] != 'u')
+          return nullptr;
+        p += 2;
+        *state = LJSON_PARSE_INVALID_UNICODE_HEX;
+        if (!(p = parse_hex4(p, end, &u2)))
+          return nullptr;
+        *state = LJSON_PARSE_INVALID_UNICODE_SURROGATE;
+        if (u2 < 0xDC00 || u2 > 0xDFFF)
+          return nullptr;
+        u = (((u - 0xD800) << 10) | (u2 - 0xDC00)) + 0x10000;
+      }
+      *n = encode_utf8(u, out);
+      return p;
+    default:
+      *state = LJSON_PARSE_INVALID_STRING_ESCAPE;
+      return nullptr;
   }
 }
 
 #define STRING_ERROR(ret) do { top_ = head; return ret; } while(0)
 
-LJSON_STATE ljson_context::parse_string_raw(char **str, size_t *len) {
+LJSON_STATE ljson_context::parse_string_raw(const char **str, size_t *len) {
   size_t head = top_;
   expect_next('\"');
-  const char* p = json_;
+  const char* p = scan_string(json_);
+  if (p != end_ && *p == '\"') {
+    // no escape at all, the string can be taken from the input as it is
+    *str = json_;
+    *len = p - json_;
+    json_ = p + 1;
+    return LJSON_PARSE_OK;
+  }
+  p = json_;
+  char buf[4];
+  size_t n;
+  LJSON_STATE state;
   for (;;) {
+    // copy the run of plain characters in one go
+    const char* q = scan_string(p);
+    if (q != p) {
+      memcpy(push(q - p), p, q - p);
+      p = q;
+    }
+    if (p == end_)
+      STRING_ERROR(LJSON_PARSE_MISS_QUOTATION_MARK);
     char ch = *p++;
     switch (ch) {
       case '\"':
@@ -249,179 +595,448 @@ LJSON_STATE ljson_context::parse_string_raw(char **str, size_t *len) {
         json_ = p;
         return LJSON_PARSE_OK;
       case '\\':
-        switch (*p++) {
-          case '\"': put_char( '\"'); break;
-          case '\\': put_char('\\'); break;
-          case '/':  put_char('/' ); break;
-          case 'b':  put_char( '\b'); break;
-          case 'f':  put_char('\f'); break;
-          case 'n':  put_char('\n'); break;
-          case 'r':  put_char('\r'); break;
-          case 't':  put_char('\t'); break;
-          case 'u':
-            unsigned u, u2;
-            if (!(p = parse_hex4(p, &u)))
-              STRING_ERROR(LJSON_PARSE_INVALID_UNICODE_HEX);
-            if (u >= 0xD800 && u <= 0xDBFF) {
-              if (*p++ != '\\')
-                STRING_ERROR(LJSON_PARSE_INVALID_UNICODE_SURROGATE);
-              if (*p++ != 'u')
-                STRING_ERROR(LJSON_PARSE_INVALID_UNICODE_SURROGATE);
-              if (!(p = parse_hex4(p, &u2)))
-                STRING_ERROR(LJSON_PARSE_INVALID_UNICODE_HEX);
-              if (u2 < 0xDC00 || u2 > 0xDFFF)
-                STRING_ERROR(LJSON_PARSE_INVALID_UNICODE_SURROGATE);
-              u = (((u - 0xD800) << 10) | (u2 - 0xDC00)) + 0x10000;
-            }
-            encode_uft8(u);
-            break;
-          default:
-            STRING_ERROR(LJSON_PARSE_INVALID_STRING_ESCAPE);
-        }
+        if (!(p = parse_escape(p, end_, buf, &n, &state)))
+          STRING_ERROR(state);
+        memcpy(push(n), buf, n);
         break;
-      case '\0':
-        STRING_ERROR(LJSON_PARSE_MISS_QUOTATION_MARK);
       default:
-        if (static_cast<unsigned char>(ch) < 0x20)
-          STRING_ERROR(LJSON_PARSE_INVALID_STRING_CHAR);
-        put_char(ch);
+        STRING_ERROR(LJSON_PARSE_INVALID_STRING_CHAR);
     }
   }
 }
 
-std::shared_ptr<ljson_value> ljson_context::parse_string(int *ret) {
-  *ret = LJSON_PARSE_OK;
-  char *str = nullptr;
-  size_t len = 0;
-  *ret = parse_string_raw(&str, &len);
-  if (*ret == LJSON_PARSE_OK) {
-    std::string val(str, len);
-    return ljson_string::create(val);
+LJSON_STATE ljson_context::parse_string_insitu(const char **str, size_t *len) {
+  expect_next('\"');
+  /// json_ comes from a mutable buffer in insitu mode
+  char* start = const_cast<char*>(json_);
+  // most strings have no escape at all, they are left untouched
+  const char* p = scan_string(start);
+  char* w = start + (p - start);
+  LJSON_STATE state;
+  for (;;) {
+    if (p == end_)
+      return LJSON_PARSE_MISS_QUOTATION_MARK;
+    char ch = *p++;
+    switch (ch) {
+      case '\"':
+        *str = start;
+        *len = w - start;
+        json_ = p;
+        return LJSON_PARSE_OK;
+      case '\\': {
+        /// an escape never decodes to more bytes than it takes
+        size_t n;
+        if (!(p = parse_escape(p, end_, w, &n, &state)))
+          return state;
+        w += n;
+        // move the following run of plain characters down in one go
+        const char* q = scan_string(p);
+        memmove(w, p, q - p);
+        w += q - p;
+        p = q;
+        break;
+      }
+      default:
+        return LJSON_PARSE_INVALID_STRING_CHAR;
+    }
   }
-  return nullptr;
 }
 
-std::shared_ptr<ljson_value> ljson_context::parse_array(int *ret) {
-  size_t size = 0;
-  expect_next('[');
-  parse_whitespace();
-  *ret = LJSON_PARSE_OK;
-  if (*json_ == ']') {
-    json_++;
-    return ljson_array::create();
+LJSON_STATE ljson_context::parse_string_persist(const char **str, size_t *len) {
+  if (insitu_)
+    return parse_string_insitu(str, len);
+  if (arena_ == nullptr)
+    return parse_string_raw(str, len);
+  const char *raw = nullptr;
+  const char *first = json_ + 1;
+  LJSON_STATE ret = parse_string_raw(&raw, len);
+  if (ret == LJSON_PARSE_OK)
+    *str = borrow_ && raw == first ? raw : arena_->copy_string(raw, *len);
+  return ret;
+}
+
+/*
+ * builds ljson_value nodes in the arena. finished values wait in values_
+ * and keys in keys_ until their container ends, then the slice of the
+ * container is copied into its arena array at once.
+ */
+struct ljson_context::dom_builder {
+  typedef ljson_value value_type;
+
+  explicit dom_builder(ljson_context *context) : c(context) {}
+
+  bool null() { return push(literal_by_type(LJSON_NULL)); }
+
+  bool boolean(bool b) { return push(literal_by_type(b ? LJSON_TRUE : LJSON_FALSE)); }
+
+  bool number(const ljson_number_value& number) { return push(c->arena_->create<ljson_number>(number)); }
+
+  bool string(const char *str, size_t len) { return push(c->arena_->create<ljson_string>(c->arena_, str, len)); }
+
+  bool key(const char *str, size_t len) {
+    c->keys_.push_back(ljson_objects::entry{str, len, nullptr});
+    return true;
   }
-  for (;;) {
-    std::shared_ptr<ljson_value> tmp_value = parse_value(ret);
-    if (*ret != LJSON_PARSE_OK)
-      break;
-    push_buffer(tmp_value);
-    size++;
-    parse_whitespace();
-    if (*json_ == ',') {
-      json_++;
-      parse_whitespace();
-    } else if (*json_ == ']') {
-      json_++;
-      auto buffer = pop_buffer<ljson_value>(size);
-      return ljson_array::create(buffer);
-    } else {
-      *ret = LJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
-      break;
-    }
+
+  bool start_array() { return true; }
+
+  bool end_array(size_t size) {
+    auto values = c->pop_slice(c->values_, size);
+    return push(c->arena_->create<ljson_array>(c->arena_, values, size));
   }
-  // Pop the value in the buffer
-  pop_buffer<ljson_value>(size);
-  return nullptr;
-}
 
-std::shared_ptr<ljson_value> ljson_context::parse_object(int *ret) {
-  size_t size = 0;
-  *ret = LJSON_PARSE_OK;
-  expect_next('{');
-  parse_whitespace();
-  if (*json_ == '}') {
-    json_++;
-    return ljson_objects::create();
+  bool start_object() { return true; }
+
+  bool end_object(size_t size) {
+    auto entries = c->pop_slice(c->keys_, size);
+    assert(size <= c->values_.size());
+    ljson_value** values = c->values_.data() + c->values_.size() - size;
+    for (size_t i = 0; i < size; ++i)
+      entries[i].value = values[i];
+    c->values_.resize(c->values_.size() - size);
+    return push(c->arena_->create<ljson_objects>(c->arena_, entries, size));
   }
-  for (;;) {
-    /// we have to declare obj here, because @func push_buffer is shallow copy
-    char *key = nullptr;
-    size_t len = 0;
-    if (*json_ != '"') {
-      *ret = LJSON_PARSE_MISS_KEY;
-      break;
-    }
-    *ret = parse_string_raw(&key, &len);
-    std::string k(key, len);
-    if (*ret != LJSON_PARSE_OK) {
-      break;
-    }
-    parse_whitespace();
-    if (*json_ != ':') {
-      *ret = LJSON_PARSE_MISS_COLON;
-      break;
-    }
-    json_++;
-    parse_whitespace();
-    /// parse value
-    auto value = parse_value(ret);
-    if (*ret != LJSON_PARSE_OK) {
-      break;
-    }
-    /// notice here are shallow copy
-    auto obj = std::make_shared<ljson_member>(k, value);
-    push_buffer(obj);
-    size++;
-    parse_whitespace();
-    if (*json_ == ',') {
-      json_++;
-      parse_whitespace();
-    } else if (*json_ == '}') {
-      json_++;
-      auto buffer = pop_buffer<ljson_member>(size);
-      return ljson_objects::create(buffer);
-    } else {
-      *ret = LJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
-      break;
-    }
+
+  /// the parsed value, once parse_value() succeeded
+  ljson_value* root() {
+    assert(!c->values_.empty());
+    ljson_value* root = c->values_.back();
+    c->values_.pop_back();
+    return root;
+  }
+
+  bool push(ljson_value *value) {
+    c->values_.push_back(value);
+    return true;
+  }
+
+  ljson_context *c;
+};
+
+/// builds ljson_compact_value nodes, finished values wait on the byte stack
+struct ljson_context::compact_builder {
+  typedef ljson_compact_value value_type;
+
+  explicit compact_builder(ljson_context *context) : c(context) {}
+
+  bool null() { return push_simple(LJSON_NULL); }
+
+  bool boolean(bool b) { return push_simple(b ? LJSON_TRUE : LJSON_FALSE); }
+
+  bool number(const ljson_number_value& number) {
+    ljson_compact_value v;
+    v.set_number(number);
+    return push(v);
   }
-  /// pop and free members in the buffer
-  pop_buffer<ljson_member>(size);
-  return nullptr;
-}
 
-std::shared_ptr<ljson_value> ljson_context::parse_value(int *ret) {
-  switch (*json_) {
-    case 't': return parse_literal("true", LJSON_TRUE, ret);
-    case 'f': return parse_literal("false", LJSON_FALSE, ret);
-    case 'n': return parse_literal("null", LJSON_NULL, ret);
-    default: return parse_number(ret);
-    case '"': return parse_string(ret);
-    case '[': return parse_array(ret);
-    case '{': return parse_object(ret);
-    case '\0': { *ret = LJSON_PARSE_EXPECT_VALUE; return nullptr; }
+  bool string(const char *str, size_t len) {
+    ljson_compact_value v;
+    v.payload_.str = str;
+    v.set(LJSON_STRING, len);
+    return push(v);
   }
+
+  bool key(const char *str, size_t len) { return string(str, len); }
+
+  bool start_array() { return true; }
+
+  bool end_array(size_t size) {
+    ljson_compact_value v;
+    size_t bytes = size * sizeof(ljson_compact_value);
+    auto elements = c->arena_->allocate_array<ljson_compact_value>(size);
+    if (size != 0)
+      memcpy(elements, c->pop(bytes), bytes);
+    v.payload_.elements = elements;
+    v.set(LJSON_ARRAY, size);
+    return push(v);
+  }
+
+  bool start_object() { return true; }
+
+  bool end_object(size_t size) {
+    /// a key and its value are laid out like a ljson_compact_member
+    ljson_compact_value v;
+    size_t bytes = size * sizeof(ljson_compact_member);
+    auto members = c->arena_->allocate_array<ljson_compact_member>(size);
+    if (size != 0)
+      memcpy(members, c->pop(bytes), bytes);
+    v.payload_.members = members;
+    v.set(LJSON_OBJECT, size);
+    return push(v);
+  }
+
+  ljson_compact_value* root() {
+    auto root = c->arena_->create<ljson_compact_value>();
+    memcpy(root, c->pop(sizeof(ljson_compact_value)), sizeof(ljson_compact_value));
+    return root;
+  }
+
+  bool push(const ljson_compact_value& v) {
+    memcpy(c->push(sizeof(v)), &v, sizeof(v));
+    return true;
+  }
+
+  bool push_simple(LJSON_TYPE type) {
+    ljson_compact_value v;
+    v.set(type, 0);
+    return push(v);
+  }
+
+  ljson_context *c;
+};
+
+namespace {
+
+/*
+ * nodes take a few times the bytes of their text, a small document gets a
+ * first chunk to match instead of LJSON_ARENA_INIT_SIZE: many documents alive
+ * at once, like the lines of ndjson, would be mostly empty chunks otherwise.
+ */
+size_t first_chunk_size(size_t len) {
+  return std::min<size_t>(LJSON_ARENA_INIT_SIZE, std::max<size_t>(256, 8 * len));
 }
 
-std::shared_ptr<ljson_value> ljson_value::parse(const char *json, int *ret) {
-  ljson_context context(json);
-  context.parse_whitespace();
-  *ret = LJSON_PARSE_OK;
-  auto value = context.parse_value(ret);
+/// run a context set up on the input and on arena, see parse_document()
+template<typename Builder>
+std::shared_ptr<typename Builder::value_type> build_document(ljson_context& context, std::shared_ptr<ljson_arena> arena,
+                                                             LJSON_ENGINE engine, int *ret,
+                                                             std::shared_ptr<ljson_mapped_file> borrowed = nullptr) {
+  Builder builder(&context);
+  *ret = engine == LJSON_ENGINE_TWO_STAGE ? context.parse_root_indexed(builder) : context.parse_root(builder);
   if (*ret == LJSON_PARSE_OK) {
-    context.parse_whitespace();
-    if (*context.json_ == '\0') {
-      return value;
-    }
-    *ret = LJSON_PARSE_ROOT_NOT_SINGULAR;
+    /// strings point into the file, the arena holds it until the document dies
+    if (borrowed != nullptr)
+      arena->create_with_cleanup<std::shared_ptr<ljson_mapped_file>>(borrowed);
+    return {arena, builder.root()};
   }
+  /// drop the values of the containers left open
+  context.top_ = 0;
   return nullptr;
 }
 
+/*
+ * @end: one past the last byte of the input, no terminator is needed
+ * @Builder: ljson_context::dom_builder or ljson_context::compact_builder
+ * @borrowed: the mapping holding the input, strings without escape are kept in it when set
+ */
+template<typename Builder>
+std::shared_ptr<typename Builder::value_type> parse_document(const char *json, const char *end, bool insitu,
+                                                             bool padded, size_t max_depth, LJSON_ENGINE engine,
+                                                             int *ret,
+                                                             std::shared_ptr<ljson_mapped_file> borrowed = nullptr) {
+  /// every node of the document lives in this arena, root shares its ownership
+  auto arena = std::make_shared<ljson_arena>(first_chunk_size(end - json));
+  ljson_context context(json, end, arena.get(), insitu, padded, max_depth);
+  context.borrow_ = borrowed != nullptr;
+  return build_document<Builder>(context, std::move(arena), engine, ret, std::move(borrowed));
+}
 
+template<typename Builder>
+std::shared_ptr<typename Builder::value_type> parse_file_document(const char *path, LJSON_FILE_MODE mode,
+                                                                  size_t max_depth, LJSON_ENGINE engine, int *ret) {
+  auto file = ljson_mapped_file::open(path);
+  if (file == nullptr) {
+    *ret = LJSON_FILE_ERROR;
+    return nullptr;
+  }
+  const char *data = file->data();
+  return parse_document<Builder>(data, data + file->size(), false, file->padded(), max_depth, engine, ret,
+                                 mode == LJSON_FILE_ZERO_COPY ? file : nullptr);
+}
 
+}
+
+std::shared_ptr<ljson_value> ljson_value::parse(const char *json, int *ret,
+                                                size_t max_depth, LJSON_ENGINE engine) {
+  return parse_document<ljson_context::dom_builder>(json, json + strlen(json), false, false, max_depth, engine, ret);
+}
 
+std::shared_ptr<ljson_value> ljson_value::parse(const char *data, size_t len, int *ret,
+                                                size_t max_depth, LJSON_ENGINE engine) {
+  return parse_document<ljson_context::dom_builder>(data, data + len, false, false, max_depth, engine, ret);
+}
 
+std::shared_ptr<ljson_value> ljson_value::parse_padded(const char *data, size_t len, int *ret,
+                                                       size_t max_depth, LJSON_ENGINE engine) {
+  return parse_document<ljson_context::dom_builder>(data, data + len, false, true, max_depth, engine, ret);
+}
+
+std::shared_ptr<ljson_value> ljson_value::parse_insitu(char *json, int *ret,
+                                                       size_t max_depth, LJSON_ENGINE engine) {
+  return parse_document<ljson_context::dom_builder>(json, json + strlen(json), true, false, max_depth, engine, ret);
+}
 
+std::shared_ptr<ljson_compact_value> ljson_compact_value::parse(const char *json, int *ret,
+                                                                size_t max_depth, LJSON_ENGINE engine) {
+  return parse_document<ljson_context::compact_builder>(json, json + strlen(json), false, false,
+                                                        max_depth, engine, ret);
+}
+
+std::shared_ptr<ljson_compact_value> ljson_compact_value::parse(const char *data, size_t len, int *ret,
+                                                                size_t max_depth, LJSON_ENGINE engine) {
+  return parse_document<ljson_context::compact_builder>(data, data + len, false, false, max_depth, engine, ret);
+}
+
+std::shared_ptr<ljson_compact_value> ljson_compact_value::parse_padded(const char *data, size_t len, int *ret,
+                                                                       size_t max_depth, LJSON_ENGINE engine) {
+  return parse_document<ljson_context::compact_builder>(data, data + len, false, true, max_depth, engine, ret);
+}
+
+std::shared_ptr<ljson_compact_value> ljson_compact_value::parse_insitu(char *json, int *ret,
+                                                                       size_t max_depth, LJSON_ENGINE engine) {
+  return parse_document<ljson_context::compact_builder>(json, json + strlen(json), true, false, max_depth, engine, ret);
+}
+
+std::shared_ptr<ljson_value> ljson_value::parse_file(const char *path, int *ret, LJSON_FILE_MODE mode,
+                                                     size_t max_depth, LJSON_ENGINE engine) {
+  return parse_file_document<ljson_context::dom_builder>(path, mode, max_depth, engine, ret);
+}
+
+std::shared_ptr<ljson_compact_value> ljson_compact_value::parse_file(const char *path, int *ret, LJSON_FILE_MODE mode,
+                                                                     size_t max_depth, LJSON_ENGINE engine) {
+  return parse_file_document<ljson_context::compact_builder>(path, mode, max_depth, engine, ret);
+}
+
+ljson_parser::ljson_parser(size_t max_depth, LJSON_ENGINE engine, bool reuse_arena)
+  : context_(new ljson_context(nullptr, nullptr, nullptr, false, false, max_depth)),
+    index_(new ljson_structural_index()), engine_(engine), reuse_arena_(reuse_arena) {
+  context_->index_ = index_.get();
+}
+
+ljson_parser::~ljson_parser() = default;
+
+std::shared_ptr<ljson_arena> ljson_parser::next_arena(size_t len) {
+  if (reuse_arena_ && arena_ != nullptr && arena_.use_count() == 1) {
+    /*
+     * the last document was dropped, maybe on another thread: use_count()
+     * is a relaxed load, order it after that release before writing over it.
+     */
+    std::atomic_thread_fence(std::memory_order_acquire);
+    arena_->reset();
+    return arena_;
+  }
+  auto arena = std::make_shared<ljson_arena>(first_chunk_size(len));
+  if (reuse_arena_)
+    arena_ = arena;
+  return arena;
+}
+
+template<typename Builder>
+std::shared_ptr<typename Builder::value_type> ljson_parser::parse_range(const char *json, const char *end,
+                                                                        bool insitu, bool padded, int *ret) {
+  auto arena = next_arena(end - json);
+  context_->reset(json, end, arena.get(), insitu, padded);
+  return build_document<Builder>(*context_, std::move(arena), engine_, ret);
+}
+
+std::shared_ptr<ljson_value> ljson_parser::parse(const char *data, size_t len, int *ret) {
+  return parse_range<ljson_context::dom_builder>(data, data + len, false, false, ret);
+}
+
+std::shared_ptr<ljson_value> ljson_parser::parse_padded(const char *data, size_t len, int *ret) {
+  return parse_range<ljson_context::dom_builder>(data, data + len, false, true, ret);
+}
+
+std::shared_ptr<ljson_value> ljson_parser::parse_insitu(char *json, int *ret) {
+  return parse_range<ljson_context::dom_builder>(json, json + strlen(json), true, false, ret);
+}
+
+std::shared_ptr<ljson_compact_value> ljson_parser::parse_compact(const char *data, size_t len, int *ret) {
+  return parse_range<ljson_context::compact_builder>(data, data + len, false, false, ret);
+}
+
+std::shared_ptr<ljson_compact_value> ljson_parser::parse_compact_padded(const char *data, size_t len, int *ret) {
+  return parse_range<ljson_context::compact_builder>(data, data + len, false, true, ret);
+}
+
+std::shared_ptr<ljson_compact_value> ljson_parser::parse_compact_insitu(char *json, int *ret) {
+  return parse_range<ljson_context::compact_builder>(json, json + strlen(json), true, false, ret);
+}
+
+void ljson_parser::reset() {
+  context_->reset(nullptr, nullptr, nullptr, false, false);
+  if (arena_ != nullptr && arena_.use_count() == 1) {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    arena_->reset();
+  }
+}
+
+void ljson_parser::release() {
+  size_t max_depth = context_->max_depth_;
+  context_.reset(new ljson_context(nullptr, nullptr, nullptr, false, false, max_depth));
+  index_.reset(new ljson_structural_index());
+  context_->index_ = index_.get();
+  arena_ = nullptr;
+}
+
+ljson_document_handler::ljson_document_handler(callback on_document)
+  : on_document_(std::move(on_document)), arena_(std::make_shared<ljson_arena>()),
+    context_(new ljson_context(nullptr, nullptr, arena_.get())), depth_(0) {}
+
+ljson_document_handler::~ljson_document_handler() = default;
+
+bool ljson_document_handler::null() {
+  ljson_context::dom_builder(context_.get()).null();
+  return value_done();
+}
+
+bool ljson_document_handler::boolean(bool b) {
+  ljson_context::dom_builder(context_.get()).boolean(b);
+  return value_done();
+}
+
+bool ljson_document_handler::number(const ljson_number_value& number) {
+  ljson_context::dom_builder(context_.get()).number(number);
+  return value_done();
+}
+
+bool ljson_document_handler::string(const char *str, size_t len) {
+  /// push parser strings only live during the call
+  ljson_context::dom_builder(context_.get()).string(arena_->copy_string(str, len), len);
+  return value_done();
+}
+
+bool ljson_document_handler::key(const char *str, size_t len) {
+  return ljson_context::dom_builder(context_.get()).key(arena_->copy_string(str, len), len);
+}
+
+bool ljson_document_handler::start_object() {
+  depth_++;
+  return true;
+}
+
+bool ljson_document_handler::end_object(size_t size) {
+  depth_--;
+  ljson_context::dom_builder(context_.get()).end_object(size);
+  return value_done();
+}
+
+bool ljson_document_handler::start_array() {
+  depth_++;
+  return true;
+}
+
+bool ljson_document_handler::end_array(size_t size) {
+  depth_--;
+  ljson_context::dom_builder(context_.get()).end_array(size);
+  return value_done();
+}
+
+void ljson_document_handler::reset() {
+  depth_ = 0;
+  /// the values built so far live in the arena, a fresh one lets them go
+  arena_ = std::make_shared<ljson_arena>();
+  context_->reset(nullptr, nullptr, arena_.get(), false, false);
+}
+
+bool ljson_document_handler::value_done() {
+  if (depth_ != 0)
+    return true;
+  std::shared_ptr<ljson_value> document(arena_, ljson_context::dom_builder(context_.get()).root());
+  /// the next document gets its own arena, this one is owned by document
+  arena_ = std::make_shared<ljson_arena>();
+  context_->arena_ = arena_.get();
+  return on_document_(std::move(document));
+}
 
 } // namespace ljson
@@ -5,12 +5,28 @@
 #ifndef LJSON_LJSON_H_
 #define LJSON_LJSON_H_
 
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
 #include <memory>
+#include <new>
 #include <vector>
 #include <string>
+#include <utility>
 
 namespace ljson {
 
+/// default maximum number of nested arrays and objects, deeper input fails with LJSON_PARSE_NESTING_TOO_DEEP
+#ifndef LJSON_PARSE_MAX_DEPTH
+#define LJSON_PARSE_MAX_DEPTH 1024
+#endif
+
+/// readable bytes parse_padded() needs past the end of the input, the widest simd block
+#define LJSON_PADDING 32
+
 enum LJSON_STATE {
   LJSON_PARSE_OK = 0,
   LJSON_PARSE_EXPECT_VALUE,
@@ -25,7 +41,31 @@ enum LJSON_STATE {
   LJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET,
   LJSON_PARSE_MISS_KEY,
   LJSON_PARSE_MISS_COLON,
-  LJSON_PARSE_COMMA_OR_CURLY_BRACKET
+  LJSON_PARSE_COMMA_OR_CURLY_BRACKET,
+  LJSON_PARSE_NESTING_TOO_DEEP,
+  LJSON_PARSE_HANDLER_STOPPED,
+  /// lookups of ljson_ondemand_value, the document itself may be valid
+  LJSON_ACCESS_INCORRECT_TYPE,
+  LJSON_ACCESS_NO_SUCH_KEY,
+  LJSON_ACCESS_INDEX_OUT_OF_RANGE,
+  /// parse_file() could not open or read the file, errno tells why
+  LJSON_FILE_ERROR
+};
+
+/// how parse() reads the input, both give the same documents and errors
+enum LJSON_ENGINE {
+  /// one pass deciding on every token as it is read
+  LJSON_ENGINE_ONE_PASS = 0,
+  /// index every structural character first, then walk the index, see ljson_index.h
+  LJSON_ENGINE_TWO_STAGE
+};
+
+/// what parse_file() does with the strings of the file
+enum LJSON_FILE_MODE {
+  /// copied into the document, the file is unmapped once parsed
+  LJSON_FILE_COPY = 0,
+  /// strings without escape point into the mapping, which the document keeps until it dies
+  LJSON_FILE_ZERO_COPY
 };
 
 enum LJSON_TYPE {
@@ -38,7 +78,132 @@ enum LJSON_TYPE {
   LJSON_OBJECT
 };
 
+enum LJSON_NUMBER_TYPE {
+  LJSON_NUMBER_DOUBLE = 0,
+  LJSON_NUMBER_INT64,
+  LJSON_NUMBER_UINT64
+};
+
+/*
+ * ljson_number_value: a number as stored in the nodes.
+ * integer literals (no fraction, no exponent) that fit in 64 bits keep their
+ * exact value, as int64 or, only above INT64_MAX, as uint64. "-0" stays a
+ * double so its sign is kept.
+ */
+struct ljson_number_value {
+  LJSON_NUMBER_TYPE type;
+  union {
+    double number;
+    int64_t int64;
+    uint64_t uint64;
+  };
+
+  double to_double() const {
+    switch (type) {
+      case LJSON_NUMBER_INT64: return static_cast<double>(int64);
+      case LJSON_NUMBER_UINT64: return static_cast<double>(uint64);
+      default: return number;
+    }
+  }
+
+  bool is_int64() const { return type == LJSON_NUMBER_INT64; }
+
+  bool is_uint64() const { return type == LJSON_NUMBER_UINT64 || (type == LJSON_NUMBER_INT64 && int64 >= 0); }
+
+  /// @return: the integer, requires is_int64()
+  int64_t to_int64() const {
+    assert(is_int64());
+    return int64;
+  }
+
+  /// @return: the integer, requires is_uint64()
+  uint64_t to_uint64() const {
+    assert(is_uint64());
+    return type == LJSON_NUMBER_UINT64 ? uint64 : static_cast<uint64_t>(int64);
+  }
+};
+
 typedef struct ljson_member ljson_member;
+typedef struct ljson_compact_member ljson_compact_member;
+struct ljson_context;
+class ljson_array;
+class ljson_objects;
+
+/*
+ * ljson_arena: bump allocator owning every node of a parsed document.
+ * memory is carved out of large chunks which are released all at once when
+ * the arena dies, nodes created here never have their destructor called, so
+ * anything that needs one has to be created by create_with_cleanup().
+ * a parsed document is the arena itself, the root returned by parse() is an
+ * aliasing shared_ptr that keeps the arena alive.
+ */
+class ljson_arena : public std::enable_shared_from_this<ljson_arena> {
+public:
+  ljson_arena() : head_(nullptr), cur_(nullptr), end_(nullptr), next_size_(0),
+                  chunk_count_(0), cleanups_(nullptr) {}
+  /// @first_chunk: size of the first chunk, e.g. sized after the input of a small document
+  explicit ljson_arena(size_t first_chunk) : head_(nullptr), cur_(nullptr), end_(nullptr),
+                                             next_size_(first_chunk), chunk_count_(0), cleanups_(nullptr) {}
+  ~ljson_arena();
+
+  ljson_arena(const ljson_arena&) = delete;
+  ljson_arena& operator=(const ljson_arena&) = delete;
+
+  void* allocate(size_t size, size_t align = alignof(void*)) {
+    auto p = reinterpret_cast<uintptr_t>(cur_);
+    auto aligned = (p + align - 1) & ~static_cast<uintptr_t>(align - 1);
+    if (aligned + size <= reinterpret_cast<uintptr_t>(end_) && aligned >= p) {
+      cur_ = reinterpret_cast<char*>(aligned + size);
+      return reinterpret_cast<void*>(aligned);
+    }
+    return allocate_slow(size, align);
+  }
+
+  template<typename T>
+  T* allocate_array(size_t n) {
+    return n == 0 ? nullptr : static_cast<T*>(allocate(n * sizeof(T), alignof(T)));
+  }
+
+  /// @noted: destructor of T will never run
+  template<typename T, typename... Args>
+  T* create(Args&&... args) {
+    return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+  }
+
+  /// same as create() but ~T() runs when the arena dies
+  template<typename T, typename... Args>
+  T* create_with_cleanup(Args&&... args) {
+    T* obj = create<T>(std::forward<Args>(args)...);
+    add_cleanup([](void* p) { static_cast<T*>(p)->~T(); }, obj);
+    return obj;
+  }
+
+  /// copy len bytes of str into the arena, result is not null-terminated
+  const char* copy_string(const char* str, size_t len);
+
+  void add_cleanup(void (*fn)(void*), void* obj);
+
+  /*
+   * run the cleanups and free every chunk but the current one, which is
+   * bumped again from its start: nothing created before may be used anymore.
+   */
+  void reset();
+
+  size_t chunk_count() const { return chunk_count_; }
+
+private:
+  struct chunk;
+  struct cleanup;
+
+  void* allocate_slow(size_t size, size_t align);
+
+  chunk* head_;
+  char* cur_;
+  char* end_;
+  size_t next_size_;
+  size_t chunk_count_;
+  cleanup* cleanups_;
+};
 
 //class ljson_value {
 //public:
@@ -55,7 +220,76 @@ public:
 
   virtual void set_value(std::shared_ptr<void> value) = 0;
 
-  static std::shared_ptr<ljson_value> parse(const char* json, int *ret);
+  /*
+   * accessors without copies, views into the node valid as long as it is
+   * alive and unchanged, unlike get_value() they never allocate.
+   */
+  /// bytes of a string, not null-terminated: see size()
+  inline const char* as_string() const;
+  /// string length, number of array elements or object members
+  inline size_t size() const;
+  /*
+   * index-th element of an array and member of an object (see
+   * ljson_objects::find()). an index out of range, a missing key or a value
+   * of another type reads as null, so lookups chain: doc["a"]["b"][0] is
+   * null when any step is missing.
+   */
+  inline const ljson_value& operator[](size_t index) const;
+  const ljson_value& operator[](int index) const { return (*this)[static_cast<size_t>(index)]; }
+  inline const ljson_value& operator[](const char* key) const;
+  inline const ljson_value& operator[](const std::string& key) const;
+  /// to iterate over the elements or the members with begin()/end(), asserts the type
+  inline const ljson_array& as_array() const;
+  inline const ljson_objects& as_object() const;
+  /// shared by every document, what a missing element or member reads as
+  static const ljson_value& null_value();
+
+  /*
+   * @max_depth: maximum number of nested arrays and objects, the parser does
+   *             not recurse so it only bounds the memory of deep input
+   * @engine: how the input is read, the result does not depend on it
+   */
+  static std::shared_ptr<ljson_value> parse(const char* json, int *ret,
+                                            size_t max_depth = LJSON_PARSE_MAX_DEPTH,
+                                            LJSON_ENGINE engine = LJSON_ENGINE_ONE_PASS);
+
+  /*
+   * parse exactly len bytes of data, no terminator needed: a '\0' inside is
+   * an ordinary byte. nothing past data + len is looked at except by the
+   * vectorized scanners, whose aligned loads cannot leave the memory pages
+   * holding data.
+   */
+  static std::shared_ptr<ljson_value> parse(const char* data, size_t len, int *ret,
+                                            size_t max_depth = LJSON_PARSE_MAX_DEPTH,
+                                            LJSON_ENGINE engine = LJSON_ENGINE_ONE_PASS);
+
+  /*
+   * same as parse(data, len, ret) for a buffer followed by at least
+   * LJSON_PADDING readable bytes, of any content. the scanners then load
+   * whole blocks from any position without extra care.
+   */
+  static std::shared_ptr<ljson_value> parse_padded(const char* data, size_t len, int *ret,
+                                                   size_t max_depth = LJSON_PARSE_MAX_DEPTH,
+                                                   LJSON_ENGINE engine = LJSON_ENGINE_ONE_PASS);
+
+  /*
+   * parse json in place: strings are unescaped inside json and string values
+   * and keys point into it instead of being copied.
+   * @noted: json must outlive the returned document
+   */
+  static std::shared_ptr<ljson_value> parse_insitu(char* json, int *ret,
+                                                   size_t max_depth = LJSON_PARSE_MAX_DEPTH,
+                                                   LJSON_ENGINE engine = LJSON_ENGINE_ONE_PASS);
+
+  /*
+   * parse the file at path straight from a read-only mapping of it, see
+   * ljson_mapped_file. *ret is LJSON_FILE_ERROR, errno set, when it cannot
+   * be read.
+   */
+  static std::shared_ptr<ljson_value> parse_file(const char* path, int *ret,
+                                                 LJSON_FILE_MODE mode = LJSON_FILE_COPY,
+                                                 size_t max_depth = LJSON_PARSE_MAX_DEPTH,
+                                                 LJSON_ENGINE engine = LJSON_ENGINE_ONE_PASS);
 
 };
 
@@ -94,17 +328,39 @@ public:
 
 class ljson_number : public ljson_value {
 public:
-  ljson_number() : number_(0.0) {}
+  ljson_number() : ljson_number(0.0) {}
 
-  explicit ljson_number(double number) : number_(number) {}
+  explicit ljson_number(double number) {
+    value_.type = LJSON_NUMBER_DOUBLE;
+    value_.number = number;
+  }
+
+  explicit ljson_number(const ljson_number_value& value) : value_(value) {}
 
   static std::shared_ptr<ljson_value> create(double number) {
     return std::make_shared<ljson_number>(number);
   }
 
+  static std::shared_ptr<ljson_value> create_int64(int64_t number) {
+    ljson_number_value value;
+    value.type = LJSON_NUMBER_INT64;
+    value.int64 = number;
+    return std::make_shared<ljson_number>(value);
+  }
+
+  static std::shared_ptr<ljson_value> create_uint64(uint64_t number) {
+    if (number <= static_cast<uint64_t>(INT64_MAX))
+      return create_int64(static_cast<int64_t>(number));
+    ljson_number_value value;
+    value.type = LJSON_NUMBER_UINT64;
+    value.uint64 = number;
+    return std::make_shared<ljson_number>(value);
+  }
+
   LJSON_TYPE get_type() const override { return LJSON_NUMBER; }
 
-  std::shared_ptr<void> get_value() const override { return std::make_shared<double>(number_); }
+  /// always a double, integers above 2^53 are rounded, see get_int64()/get_uint64()
+  std::shared_ptr<void> get_value() const override { return std::make_shared<double>(value_.to_double()); }
 
   static double get_value_helper(const std::shared_ptr<void>& val) {
     auto ptr = std::static_pointer_cast<double>(val);
@@ -113,18 +369,37 @@ public:
 
   void set_value(std::shared_ptr<void> value) override {
     auto real_ptr = std::static_pointer_cast<double>(value);
-    number_ = *real_ptr;
+    value_.type = LJSON_NUMBER_DOUBLE;
+    value_.number = *real_ptr;
   }
+
+  LJSON_NUMBER_TYPE get_number_type() const { return value_.type; }
+
+  double get_double() const { return value_.to_double(); }
+
+  bool is_int64() const { return value_.is_int64(); }
+
+  bool is_uint64() const { return value_.is_uint64(); }
+
+  int64_t get_int64() const { return value_.to_int64(); }
+
+  uint64_t get_uint64() const { return value_.to_uint64(); }
+
 private:
-  double number_;
+  ljson_number_value value_;
 
 };
 
 class ljson_string : public ljson_value {
 public:
-  ljson_string() = default;
+  ljson_string() : arena_(nullptr), data_(nullptr), size_(0) {}
 
-  explicit ljson_string(std::string str) : str_(std::move(str)) {}
+  explicit ljson_string(std::string str)
+    : str_(std::move(str)), arena_(nullptr), data_(nullptr), size_(0) {}
+
+  /// @data: size bytes living in arena, not null-terminated
+  ljson_string(ljson_arena* arena, const char* data, size_t size)
+    : arena_(arena), data_(data), size_(size) {}
 
   static std::shared_ptr<ljson_value> create(std::string str = "") {
     return std::make_shared<ljson_string>(str);
@@ -132,27 +407,41 @@ public:
 
   LJSON_TYPE get_type() const override { return LJSON_STRING; }
 
-  std::shared_ptr<void> get_value() const override { return std::make_shared<std::string>(str_); }
+  /// not null-terminated in a parsed document
+  const char* data() const { return arena_ != nullptr ? data_ : str_.data(); }
+
+  size_t size() const { return arena_ != nullptr ? size_ : str_.size(); }
+
+  std::shared_ptr<void> get_value() const override {
+    if (arena_ != nullptr)
+      return std::make_shared<std::string>(data_, size_);
+    return std::make_shared<std::string>(str_);
+  }
 
   static std::string get_value_helper(const std::shared_ptr<void>& val) {
     auto ptr = std::static_pointer_cast<std::string>(val);
     return *ptr;
   }
 
-  void set_value(std::shared_ptr<void> value) override {
-    auto real_ptr = std::static_pointer_cast<std::string>(value);
-    str_ = *real_ptr;
-  }
+  void set_value(std::shared_ptr<void> value) override;
 private:
   std::string str_;
+  /// set when the string lives in an arena, str_ is unused then
+  ljson_arena* arena_;
+  const char* data_;
+  size_t size_;
 };
 
 class ljson_array : public ljson_value {
 public:
-  ljson_array() = default;
+  ljson_array() : arena_(nullptr), values_(nullptr), size_(0) {}
 
   explicit ljson_array(std::vector<std::shared_ptr<ljson_value>> value)
-    : elements_(std::move(value)) {}
+    : elements_(std::move(value)), arena_(nullptr), values_(nullptr), size_(0) { index_elements(); }
+
+  /// @values: size element pointers living in arena
+  ljson_array(ljson_arena* arena, ljson_value** values, size_t size)
+    : arena_(arena), values_(values), size_(size) {}
 
   static std::shared_ptr<ljson_value> create() {
     return std::make_shared<ljson_array>();
@@ -164,29 +453,95 @@ public:
 
   LJSON_TYPE get_type() const override { return LJSON_ARRAY; }
 
-  std::shared_ptr<void> get_value() const override {
-    return std::make_shared<std::vector<std::shared_ptr<ljson_value>>>(elements_);
+  /// walks the element pointers of the array, dereferences to the element
+  class const_iterator {
+  public:
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef ljson_value value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const ljson_value* pointer;
+    typedef const ljson_value& reference;
+
+    explicit const_iterator(ljson_value* const* p = nullptr) : p_(p) {}
+    reference operator*() const { return **p_; }
+    pointer operator->() const { return *p_; }
+    reference operator[](difference_type n) const { return *p_[n]; }
+    const_iterator& operator++() { ++p_; return *this; }
+    const_iterator operator++(int) { return const_iterator(p_++); }
+    const_iterator& operator--() { --p_; return *this; }
+    const_iterator operator--(int) { return const_iterator(p_--); }
+    const_iterator& operator+=(difference_type n) { p_ += n; return *this; }
+    const_iterator operator+(difference_type n) const { return const_iterator(p_ + n); }
+    const_iterator operator-(difference_type n) const { return const_iterator(p_ - n); }
+    difference_type operator-(const const_iterator& other) const { return p_ - other.p_; }
+    bool operator==(const const_iterator& other) const { return p_ == other.p_; }
+    bool operator!=(const const_iterator& other) const { return p_ != other.p_; }
+    bool operator<(const const_iterator& other) const { return p_ < other.p_; }
+
+  private:
+    ljson_value* const* p_;
+  };
+
+  size_t size() const { return arena_ != nullptr ? size_ : raw_.size(); }
+
+  const ljson_value& operator[](size_t index) const {
+    assert(index < size());
+    return *values()[index];
   }
 
+  const_iterator begin() const { return const_iterator(values()); }
+
+  const_iterator end() const { return const_iterator(values() + size()); }
+
+  /// elements of an arena array share ownership of the whole arena
+  std::shared_ptr<void> get_value() const override;
+
   static std::vector<std::shared_ptr<ljson_value>> get_value_helper(const std::shared_ptr<void>& val) {
     auto ptr = std::static_pointer_cast<std::vector<std::shared_ptr<ljson_value>>>(val);
     return *ptr;
   }
 
-  void set_value(std::shared_ptr<void> value) override {
-    auto real_ptr = std::static_pointer_cast<std::vector<std::shared_ptr<ljson_value>>>(value);
-    elements_ = *real_ptr;
-  }
+  void set_value(std::shared_ptr<void> value) override;
 private:
+  ljson_value* const* values() const { return arena_ != nullptr ? values_ : raw_.data(); }
+  /// fill raw_ after elements_ changed
+  void index_elements();
+
   std::vector<std::shared_ptr<ljson_value>> elements_;
+  /// the pointers of elements_, what the accessors walk outside an arena
+  std::vector<ljson_value*> raw_;
+  /// set when the array lives in an arena, elements_ is unused then
+  ljson_arena* arena_;
+  ljson_value** values_;
+  size_t size_;
 };
 
 class ljson_objects : public ljson_value {
 public:
-  ljson_objects() = default;
+  /// member record of an object living in an arena
+  struct entry {
+    const char* key;
+    size_t key_size;
+    ljson_value* value;
+  };
+
+  /// objects from this size on get a hash index of their keys with the first lookup
+  static const size_t kHashMinSize = 16;
+
+  ljson_objects() : arena_(nullptr), entries_(nullptr), size_(0), index_(nullptr), arena_cleanup_(false) {}
 
   explicit ljson_objects(std::vector<std::shared_ptr<ljson_member>> value)
-    : members_(std::move(value)) {}
+    : members_(std::move(value)), arena_(nullptr), entries_(nullptr), size_(0), index_(nullptr),
+      arena_cleanup_(false) { index_members(); }
+
+  /// @entries: size members living in arena
+  ljson_objects(ljson_arena* arena, entry* entries, size_t size)
+    : arena_(arena), entries_(entries), size_(size), index_(nullptr), arena_cleanup_(false) { cleanup_by_arena(); }
+
+  ~ljson_objects() override;
+
+  ljson_objects(const ljson_objects&) = delete;
+  ljson_objects& operator=(const ljson_objects&) = delete;
 
   static std::shared_ptr<ljson_value> create() {
     return std::make_shared<ljson_objects>();
@@ -203,16 +558,67 @@ public:
 
   LJSON_TYPE get_type() const override { return LJSON_OBJECT; }
 
-  std::shared_ptr<void> get_value() const override {
-    return std::make_shared<std::vector<std::shared_ptr<ljson_member>>>(members_);
-  }
+  typedef const entry* const_iterator;
 
-  void set_value(std::shared_ptr<void> value) override {
-    auto real_ptr = std::static_pointer_cast<std::vector<std::shared_ptr<ljson_member>>>(value);
-    members_ = *real_ptr;
+  size_t size() const { return arena_ != nullptr ? size_ : raw_.size(); }
+
+  /// index-th member, its key is not null-terminated in a parsed document
+  const entry& operator[](size_t index) const {
+    assert(index < size());
+    return entries()[index];
   }
+
+  const entry& operator[](int index) const { return (*this)[static_cast<size_t>(index)]; }
+
+  const_iterator begin() const { return entries(); }
+
+  const_iterator end() const { return entries() + size(); }
+
+  /*
+   * value of the first member named key, nullptr when there is none: with
+   * duplicate keys the later ones are only reachable by iterating.
+   * small objects are scanned, from kHashMinSize members on the first call
+   * builds a hash index of the keys, open addressing in one array. lookups
+   * can run concurrently, the index is published atomically.
+   */
+  const ljson_value* find(const char* key, size_t len) const;
+  const ljson_value* find(const char* key) const { return find(key, strlen(key)); }
+  const ljson_value* find(const std::string& key) const { return find(key.data(), key.size()); }
+
+  /// same as find(), a missing key reads as null
+  const ljson_value& operator[](const char* key) const { return value_or_null(find(key)); }
+  const ljson_value& operator[](const std::string& key) const { return value_or_null(find(key)); }
+
+  /// members are built on every call, assigning to them leaves the object
+  /// as it is; values of an arena object share ownership of the whole arena
+  std::shared_ptr<void> get_value() const override;
+
+  /// the object keeps copies of the given members, later changes to them are not seen
+  void set_value(std::shared_ptr<void> value) override;
 private:
+  const entry* entries() const { return arena_ != nullptr ? entries_ : raw_.data(); }
+  /// replace members_ by copies nobody else holds, then fill raw_
+  void index_members();
+  /// an arena never runs destructors, have it run this one once the index may be built
+  void cleanup_by_arena();
+  /// slot 0 holds the mask of the table, the other slots an entry index + 1 or 0 when free
+  const uint32_t* build_index() const;
+  /// shared by every document, a missing key reads as it
+  static const ljson_value& value_or_null(const ljson_value* value);
+
   std::vector<std::shared_ptr<ljson_member>> members_;
+  /// members_ as entries, what the accessors walk outside an arena: the
+  /// members are never handed out, the keys and values stay put until set_value()
+  std::vector<entry> raw_;
+  /// set when the object lives in an arena, members_ is unused then
+  ljson_arena* arena_;
+  entry* entries_;
+  size_t size_;
+  /// built by the first find() on a large object over entries(), which only
+  /// set_value() changes, it drops the index first
+  mutable std::atomic<const uint32_t*> index_;
+  /// the destructor is registered in the cleanups of arena_
+  bool arena_cleanup_;
 };
 
 struct ljson_member {
@@ -222,6 +628,175 @@ struct ljson_member {
   std::shared_ptr<ljson_value> value;   /* member value */
 };
 
+const char* ljson_value::as_string() const {
+  assert(get_type() == LJSON_STRING);
+  return static_cast<const ljson_string*>(this)->data();
+}
+
+size_t ljson_value::size() const {
+  switch (get_type()) {
+    case LJSON_STRING: return static_cast<const ljson_string*>(this)->size();
+    case LJSON_ARRAY: return static_cast<const ljson_array*>(this)->size();
+    case LJSON_OBJECT: return static_cast<const ljson_objects*>(this)->size();
+    default:
+      assert(false && "size() of a scalar");
+      return 0;
+  }
+}
+
+const ljson_value& ljson_value::operator[](size_t index) const {
+  if (get_type() != LJSON_ARRAY || index >= as_array().size())
+    return null_value();
+  return as_array()[index];
+}
+
+const ljson_value& ljson_value::operator[](const char* key) const {
+  return get_type() == LJSON_OBJECT ? as_object()[key] : null_value();
+}
+
+const ljson_value& ljson_value::operator[](const std::string& key) const {
+  return get_type() == LJSON_OBJECT ? as_object()[key] : null_value();
+}
+
+const ljson_array& ljson_value::as_array() const {
+  assert(get_type() == LJSON_ARRAY);
+  return *static_cast<const ljson_array*>(this);
+}
+
+const ljson_objects& ljson_value::as_object() const {
+  assert(get_type() == LJSON_OBJECT);
+  return *static_cast<const ljson_objects*>(this);
+}
+
+/*
+ * ljson_compact_value: 16 bytes tagged alternative to the ljson_value classes.
+ * no vtable, type and length share one word with the payload next to it.
+ * strings are pointer + length (not null-terminated), elements of an array
+ * and members of an object are stored contiguously, all of them live in
+ * the arena of the parsed document.
+ */
+class ljson_compact_value {
+public:
+  ljson_compact_value() : tag_(LJSON_NULL) { payload_.number = 0.0; }
+
+  LJSON_TYPE get_type() const { return static_cast<LJSON_TYPE>(tag_ & 0xFF); }
+
+  /// any number type, integers above 2^53 are rounded
+  double get_number() const {
+    assert(get_type() == LJSON_NUMBER);
+    return number_value().to_double();
+  }
+
+  LJSON_NUMBER_TYPE get_number_type() const {
+    assert(get_type() == LJSON_NUMBER);
+    return static_cast<LJSON_NUMBER_TYPE>(tag_ >> 8);
+  }
+
+  bool is_int64() const { return number_value().is_int64(); }
+
+  bool is_uint64() const { return number_value().is_uint64(); }
+
+  int64_t get_int64() const { return number_value().to_int64(); }
+
+  uint64_t get_uint64() const { return number_value().to_uint64(); }
+
+  const char* get_string() const {
+    assert(get_type() == LJSON_STRING);
+    return payload_.str;
+  }
+
+  size_t get_string_length() const {
+    assert(get_type() == LJSON_STRING);
+    return size();
+  }
+
+  /// string length, number of array elements or object members (number type for numbers)
+  size_t size() const { return static_cast<size_t>(tag_ >> 8); }
+
+  const ljson_compact_value& operator[](size_t index) const {
+    assert(get_type() == LJSON_ARRAY && index < size());
+    return payload_.elements[index];
+  }
+
+  inline const ljson_compact_member& get_member(size_t index) const;
+
+  /// same contract as ljson_value::parse, root shares ownership of the document
+  static std::shared_ptr<ljson_compact_value> parse(const char* json, int *ret,
+                                                    size_t max_depth = LJSON_PARSE_MAX_DEPTH,
+                                                    LJSON_ENGINE engine = LJSON_ENGINE_ONE_PASS);
+
+  /// same contract as ljson_value::parse(data, len, ret)
+  static std::shared_ptr<ljson_compact_value> parse(const char* data, size_t len, int *ret,
+                                                    size_t max_depth = LJSON_PARSE_MAX_DEPTH,
+                                                    LJSON_ENGINE engine = LJSON_ENGINE_ONE_PASS);
+
+  /// same contract as ljson_value::parse_padded
+  static std::shared_ptr<ljson_compact_value> parse_padded(const char* data, size_t len, int *ret,
+                                                           size_t max_depth = LJSON_PARSE_MAX_DEPTH,
+                                                           LJSON_ENGINE engine = LJSON_ENGINE_ONE_PASS);
+
+  /// same contract as ljson_value::parse_insitu
+  static std::shared_ptr<ljson_compact_value> parse_insitu(char* json, int *ret,
+                                                           size_t max_depth = LJSON_PARSE_MAX_DEPTH,
+                                                           LJSON_ENGINE engine = LJSON_ENGINE_ONE_PASS);
+
+  /// same contract as ljson_value::parse_file
+  static std::shared_ptr<ljson_compact_value> parse_file(const char* path, int *ret,
+                                                         LJSON_FILE_MODE mode = LJSON_FILE_COPY,
+                                                         size_t max_depth = LJSON_PARSE_MAX_DEPTH,
+                                                         LJSON_ENGINE engine = LJSON_ENGINE_ONE_PASS);
+
+private:
+  friend struct ljson_context;
+
+  void set(LJSON_TYPE type, size_t size) {
+    tag_ = static_cast<uint64_t>(type) | (static_cast<uint64_t>(size) << 8);
+  }
+
+  void set_number(const ljson_number_value& value) {
+    set(LJSON_NUMBER, value.type);
+    switch (value.type) {
+      case LJSON_NUMBER_INT64: payload_.int64 = value.int64; break;
+      case LJSON_NUMBER_UINT64: payload_.uint64 = value.uint64; break;
+      default: payload_.number = value.number; break;
+    }
+  }
+
+  ljson_number_value number_value() const {
+    assert(get_type() == LJSON_NUMBER);
+    ljson_number_value value;
+    value.type = static_cast<LJSON_NUMBER_TYPE>(tag_ >> 8);
+    switch (value.type) {
+      case LJSON_NUMBER_INT64: value.int64 = payload_.int64; break;
+      case LJSON_NUMBER_UINT64: value.uint64 = payload_.uint64; break;
+      default: value.number = payload_.number; break;
+    }
+    return value;
+  }
+
+  union {
+    double number;
+    int64_t int64;
+    uint64_t uint64;
+    const char* str;
+    const ljson_compact_value* elements;
+    const ljson_compact_member* members;
+  } payload_;
+  uint64_t tag_;  /* type in the lowest byte, size in the others */
+};
+
+static_assert(sizeof(ljson_compact_value) == 16, "ljson_compact_value must stay 16 bytes");
+
+struct ljson_compact_member {
+  ljson_compact_value key;    /* always a string */
+  ljson_compact_value value;
+};
+
+const ljson_compact_member& ljson_compact_value::get_member(size_t index) const {
+  assert(get_type() == LJSON_OBJECT && index < size());
+  return payload_.members[index];
+}
+
 } // namespace ljson
 
 #endif //LJSON_LJSON_H_
@@ -0,0 +1,1181 @@
+#include "ljson.h"
+#include "ljson_file.h"
+#include "ljson_generator.h"
+#include "ljson_index.h"
+#include "ljson_ndjson.h"
+#include "ljson_ondemand.h"
+#include "ljson_parser.h"
+#include "ljson_push.h"
+#include "ljson_sax.h"
+#include "ljson_simd.h"
+#include "ljson_tape.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#if defined(__unix__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace ljson;
+
+/// heap allocations so far, counted to show which walks allocate
+static std::atomic<size_t> allocations(0);
+
+void* operator new(size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = malloc(size != 0 ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+/// not inlined, gcc would see the free() of an operator new pointer and warn
+__attribute__((noinline)) void operator delete(void* p) noexcept { free(p); }
+
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept { free(p); }
+
+/// run fn repeatedly for at least min_seconds, return the best time of one run
+static double bench_seconds(const std::function<void()>& fn, double min_seconds = 0.5) {
+  double best = 1e30, total = 0.0;
+  int runs = 0;
+  while (total < min_seconds || runs < 3) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    best = elapsed < best ? elapsed : best;
+    total += elapsed;
+    runs++;
+  }
+  return best;
+}
+
+static void report(const char* name, size_t bytes, double seconds) {
+  printf("%-46s %10.3f ms %10.1f MB/s\n", name, seconds * 1e3, bytes / 1e6 / seconds);
+}
+
+/// array of small records, mixing every value type
+static std::string make_records(int count) {
+  std::string json = "[";
+  for (int i = 0; i < count; ++i) {
+    if (i) json += ",";
+    json += "{\"id\":" + std::to_string(i) + ",\"name\":\"user name " + std::to_string(i) +
+            "\",\"tags\":[\"a\",\"b\",true,null],\"score\":" + std::to_string(i * 0.25) + "}";
+  }
+  json += "]";
+  return json;
+}
+
+/// records nested a few levels deep, pretty-printed with indent spaces per level
+static std::string make_nested(int count, int indent) {
+  std::string json;
+  int depth = 0;
+  auto newline = [&] {
+    if (indent == 0)
+      return;
+    json += "\n";
+    json.append(static_cast<size_t>(depth * indent), ' ');
+  };
+  auto open = [&](char ch) { json += ch; depth++; newline(); };
+  auto close = [&](char ch) { depth--; newline(); json += ch; };
+  auto key = [&](const char* k) { json += "\""; json += k; json += indent ? "\": " : "\":"; };
+  open('[');
+  for (int i = 0; i < count; ++i) {
+    if (i) { json += ","; newline(); }
+    open('{');
+    key("id"); json += std::to_string(i); json += ","; newline();
+    key("geo"); open('{');
+    key("country"); json += "\"fr\""; json += ","; newline();
+    key("city"); json += "\"paris\""; close('}'); json += ","; newline();
+    key("children"); open('[');
+    for (int j = 0; j < 3; ++j) {
+      if (j) { json += ","; newline(); }
+      open('{'); key("name"); json += "\"child\""; json += ","; newline();
+      key("flags"); open('['); json += "true,"; newline(); json += "null"; close(']');
+      close('}');
+    }
+    close(']');
+    close('}');
+  }
+  close(']');
+  return json;
+}
+
+/// array of long strings, one in eight carrying escapes
+static std::string make_strings(int count, size_t length) {
+  std::string json = "[";
+  for (int i = 0; i < count; ++i) {
+    if (i) json += ",";
+    json += "\"";
+    for (size_t j = 0; j < length; ++j)
+      json += static_cast<char>('a' + (i + j) % 26);
+    if (i % 8 == 0)
+      json += "\\n\\t\\u00e9 tail";
+    json += "\"";
+  }
+  json += "]";
+  return json;
+}
+
+/// array of coordinate pairs, printed with 6 to 17 significant digits
+static std::string make_numbers(int count) {
+  std::string json = "[";
+  char buffer[64];
+  unsigned seed = 12345;
+  for (int i = 0; i < count; ++i) {
+    seed = seed * 1103515245u + 12345u;
+    double lat = (seed % 1800000000u) / 1e7 - 90.0;
+    seed = seed * 1103515245u + 12345u;
+    double lng = (seed % 3600000000u) / 1e7 - 180.0;
+    snprintf(buffer, sizeof(buffer), "%s[%.*g,%.*g]", i ? "," : "", 6 + i % 12, lat, 6 + i % 12, lng);
+    json += buffer;
+  }
+  json += "]";
+  return json;
+}
+
+/// records of 64-bit snowflake ids and small counters
+static std::string make_integers(int count) {
+  std::string json = "[";
+  uint64_t id = 1541815603606036480ULL;
+  for (int i = 0; i < count; ++i) {
+    id += 4194304ULL * (i % 7 + 1) + static_cast<uint64_t>(i % 4096);
+    json += i ? ",{\"id\":" : "{\"id\":";
+    json += std::to_string(id) + ",\"likes\":" + std::to_string(i % 1000) + ",\"parent\":" +
+            std::to_string(id - 12345) + "}";
+  }
+  json += "]";
+  return json;
+}
+
+static double traverse(const ljson_value& v) {
+  switch (v.get_type()) {
+    case LJSON_NUMBER:
+      return ljson_number::get_value_helper(v.get_value());
+    case LJSON_STRING:
+      return static_cast<double>(ljson_string::get_value_helper(v.get_value()).size());
+    case LJSON_ARRAY: {
+      double sum = 0.0;
+      for (auto& e : ljson_array::get_value_helper(v.get_value()))
+        sum += traverse(*e);
+      return sum;
+    }
+    case LJSON_OBJECT: {
+      double sum = 0.0;
+      for (auto& m : ljson_objects::get_value_helper(v.get_value()))
+        sum += m->key.size() + traverse(*m->value);
+      return sum;
+    }
+    default:
+      return 1.0;
+  }
+}
+
+static double traverse(const ljson_compact_value& v) {
+  switch (v.get_type()) {
+    case LJSON_NUMBER:
+      return v.get_number();
+    case LJSON_STRING:
+      return static_cast<double>(v.get_string_length());
+    case LJSON_ARRAY: {
+      double sum = 0.0;
+      for (size_t i = 0; i < v.size(); ++i)
+        sum += traverse(v[i]);
+      return sum;
+    }
+    case LJSON_OBJECT: {
+      double sum = 0.0;
+      for (size_t i = 0; i < v.size(); ++i)
+        sum += v.get_member(i).key.get_string_length() + traverse(v.get_member(i).value);
+      return sum;
+    }
+    default:
+      return 1.0;
+  }
+}
+
+/// walks each container once, from its first child with next()
+static double traverse(const ljson_tape_value& v) {
+  switch (v.get_type()) {
+    case LJSON_NUMBER:
+      return v.get_number();
+    case LJSON_STRING:
+      return static_cast<double>(v.get_string_length());
+    case LJSON_ARRAY: {
+      double sum = 0.0;
+      size_t size = v.size();
+      if (size == 0)
+        return sum;
+      ljson_tape_value e = v[0];
+      for (size_t i = 0; i < size; ++i, e = e.next())
+        sum += traverse(e);
+      return sum;
+    }
+    case LJSON_OBJECT: {
+      double sum = 0.0;
+      size_t size = v.size();
+      if (size == 0)
+        return sum;
+      ljson_tape_member member = v.get_member(0);
+      for (size_t i = 0; i < size; ++i) {
+        sum += member.key.get_string_length() + traverse(member.value);
+        member.key = member.value.next();
+        member.value = member.key.next();
+      }
+      return sum;
+    }
+    default:
+      return 1.0;
+  }
+}
+
+/// traverse() through the views of the nodes, nothing is copied
+static double traverse_views(const ljson_value& v) {
+  switch (v.get_type()) {
+    case LJSON_NUMBER:
+      return static_cast<const ljson_number&>(v).get_double();
+    case LJSON_STRING:
+      return static_cast<double>(v.size());
+    case LJSON_ARRAY: {
+      double sum = 0.0;
+      for (const ljson_value& e : v.as_array())
+        sum += traverse_views(e);
+      return sum;
+    }
+    case LJSON_OBJECT: {
+      double sum = 0.0;
+      for (const ljson_objects::entry& m : v.as_object())
+        sum += m.key_size + traverse_views(*m.value);
+      return sum;
+    }
+    default:
+      return 1.0;
+  }
+}
+
+static void bench_compact_value() {
+  printf("node size: ljson_number %zu, ljson_string %zu, ljson_array %zu, ljson_objects %zu, "
+         "ljson_compact_value %zu\n", sizeof(ljson_number), sizeof(ljson_string), sizeof(ljson_array),
+         sizeof(ljson_objects), sizeof(ljson_compact_value));
+  std::string json = make_records(100000);
+  int ret = LJSON_PARSE_OK;
+  report("parse ljson_value", json.size(), bench_seconds([&] {
+    ljson_value::parse(json.c_str(), &ret);
+  }));
+  report("parse ljson_compact_value", json.size(), bench_seconds([&] {
+    ljson_compact_value::parse(json.c_str(), &ret);
+  }));
+  auto value = ljson_value::parse(json.c_str(), &ret);
+  auto compact = ljson_compact_value::parse(json.c_str(), &ret);
+  volatile double sink = 0.0;
+  report("traverse ljson_value", json.size(), bench_seconds([&] { sink = traverse(*value); }));
+  report("traverse ljson_value, views", json.size(), bench_seconds([&] { sink = traverse_views(*value); }));
+  report("traverse ljson_compact_value", json.size(), bench_seconds([&] { sink = traverse(*compact); }));
+  (void)sink;
+}
+
+static void bench_insitu() {
+  std::string json = make_records(100000);
+  std::string buffer = json;
+  int ret = LJSON_PARSE_OK;
+  report("parse ljson_value", json.size(), bench_seconds([&] {
+    ljson_value::parse(json.c_str(), &ret);
+  }));
+  /// insitu rewrites escaped strings, restore the input on every run
+  report("parse_insitu ljson_value (with copy)", json.size(), bench_seconds([&] {
+    memcpy(&buffer[0], json.data(), json.size());
+    ljson_value::parse_insitu(&buffer[0], &ret);
+  }));
+  report("parse ljson_compact_value", json.size(), bench_seconds([&] {
+    ljson_compact_value::parse(json.c_str(), &ret);
+  }));
+  report("parse_insitu ljson_compact_value (with copy)", json.size(), bench_seconds([&] {
+    memcpy(&buffer[0], json.data(), json.size());
+    ljson_compact_value::parse_insitu(&buffer[0], &ret);
+  }));
+}
+
+static void bench_strings() {
+  std::string json = make_strings(20000, 200);
+  std::string buffer = json;
+  int ret = LJSON_PARSE_OK;
+  report("parse long strings", json.size(), bench_seconds([&] {
+    ljson_value::parse(json.c_str(), &ret);
+  }));
+  report("parse_insitu long strings (with copy)", json.size(), bench_seconds([&] {
+    memcpy(&buffer[0], json.data(), json.size());
+    ljson_value::parse_insitu(&buffer[0], &ret);
+  }));
+}
+
+static void bench_numbers() {
+  std::string json = make_numbers(200000);
+  int ret = LJSON_PARSE_OK;
+  volatile double sink = 0.0;
+  /// baseline: only the conversions, the way the parser did them before
+  report("strtod over every number", json.size(), bench_seconds([&] {
+    double sum = 0.0;
+    for (const char* p = json.c_str(); *p != '\0';) {
+      if (*p == '-' || (*p >= '0' && *p <= '9')) {
+        char* end;
+        sum += strtod(p, &end);
+        p = end;
+      } else {
+        p++;
+      }
+    }
+    sink = sum;
+  }));
+  report("parse ljson_compact_value", json.size(), bench_seconds([&] {
+    ljson_compact_value::parse(json.c_str(), &ret);
+  }));
+  report("parse ljson_value", json.size(), bench_seconds([&] {
+    ljson_value::parse(json.c_str(), &ret);
+  }));
+  (void)sink;
+}
+
+static void bench_integers() {
+  std::string json = make_integers(200000);
+  int ret = LJSON_PARSE_OK;
+  report("parse ljson_compact_value", json.size(), bench_seconds([&] {
+    ljson_compact_value::parse(json.c_str(), &ret);
+  }));
+  report("parse ljson_value", json.size(), bench_seconds([&] {
+    ljson_value::parse(json.c_str(), &ret);
+  }));
+}
+
+/// messages packed back to back like in a receive buffer, none null-terminated
+static void bench_bounded() {
+  std::string buffer;
+  std::vector<std::pair<size_t, size_t>> messages;
+  for (int i = 0; i < 20000; ++i) {
+    std::string message = make_records(4 + i % 5);
+    messages.emplace_back(buffer.size(), message.size());
+    buffer += message;
+  }
+  buffer.append(LJSON_PADDING, ' ');
+  int ret = LJSON_PARSE_OK;
+  size_t bytes = buffer.size() - LJSON_PADDING;
+  report("copy to std::string + parse", bytes, bench_seconds([&] {
+    for (auto& m : messages) {
+      std::string copy(buffer, m.first, m.second);
+      ljson_compact_value::parse(copy.c_str(), &ret);
+    }
+  }));
+  report("parse(data, len)", bytes, bench_seconds([&] {
+    for (auto& m : messages)
+      ljson_compact_value::parse(buffer.data() + m.first, m.second, &ret);
+  }));
+  report("parse_padded(data, len)", bytes, bench_seconds([&] {
+    for (auto& m : messages)
+      ljson_compact_value::parse_padded(buffer.data() + m.first, m.second, &ret);
+  }));
+}
+
+/// sums the "id" member of every record, the rest of the input is only validated
+struct sum_ids {
+  bool null() { return true; }
+  bool boolean(bool) { return true; }
+  bool number(const ljson_number_value& number) {
+    if (next_is_id)
+      sum += number.to_double();
+    next_is_id = false;
+    return true;
+  }
+  bool string(const char*, size_t) { next_is_id = false; return true; }
+  bool key(const char* str, size_t len) {
+    next_is_id = len == 2 && str[0] == 'i' && str[1] == 'd';
+    return true;
+  }
+  bool start_object() { return true; }
+  bool end_object(size_t) { return true; }
+  bool start_array() { return true; }
+  bool end_array(size_t) { return true; }
+
+  bool next_is_id = false;
+  double sum = 0.0;
+};
+
+static void bench_sax() {
+  std::string json = make_records(100000);
+  int ret = LJSON_PARSE_OK;
+  volatile double sink = 0.0;
+  report("sax: sum ids", json.size(), bench_seconds([&] {
+    sum_ids handler;
+    ljson_sax::parse(json.data(), json.size(), handler);
+    sink = handler.sum;
+  }));
+  report("ljson_compact_value: parse + sum ids", json.size(), bench_seconds([&] {
+    auto root = ljson_compact_value::parse(json.data(), json.size(), &ret);
+    double sum = 0.0;
+    for (size_t i = 0; i < root->size(); ++i)
+      sum += (*root)[i].get_member(0).value.get_number();
+    sink = sum;
+  }));
+  report("ljson_value: parse + sum ids", json.size(), bench_seconds([&] {
+    auto root = ljson_value::parse(json.data(), json.size(), &ret);
+    double sum = 0.0;
+    for (auto& record : ljson_array::get_value_helper(root->get_value()))
+      sum += ljson_number::get_value_helper(ljson_objects::get_value_helper(record->get_value())[0]->value->get_value());
+    sink = sum;
+  }));
+  (void)sink;
+}
+
+/// the records of make_records as a stream of values, one per line
+static std::string make_record_stream(int count) {
+  std::string json = make_records(count);
+  std::string stream;
+  // drop the brackets, a record ends with the only '}' of it
+  for (size_t i = 1; i + 1 < json.size(); ++i) {
+    if (json[i] == ',' && json[i - 1] == '}')
+      stream += '\n';
+    else
+      stream += json[i];
+  }
+  return stream;
+}
+
+static void bench_push() {
+  std::string json = make_records(100000);
+  volatile double sink = 0.0;
+  for (size_t chunk : {size_t(1460), size_t(65536)}) {
+    std::string name = "push sax: sum ids, " + std::to_string(chunk) + " byte chunks";
+    report(name.c_str(), json.size(), bench_seconds([&] {
+      sum_ids handler;
+      ljson_push_parser<sum_ids> parser(handler);
+      for (size_t pos = 0; pos < json.size(); pos += chunk)
+        parser.feed(json.data() + pos, std::min(chunk, json.size() - pos));
+      parser.finish();
+      sink = handler.sum;
+    }));
+  }
+  std::string stream = make_record_stream(100000);
+  report("push documents: one per record, 65536 byte chunks", stream.size(), bench_seconds([&] {
+    size_t count = 0;
+    ljson_document_handler handler([&count](std::shared_ptr<ljson_value>) {
+      count++;
+      return true;
+    });
+    ljson_push_parser<ljson_document_handler> parser(handler);
+    for (size_t pos = 0; pos < stream.size(); pos += 65536)
+      parser.feed(stream.data() + pos, std::min(size_t(65536), stream.size() - pos));
+    parser.finish();
+    sink = count;
+  }));
+  (void)sink;
+}
+
+static void bench_ndjson() {
+  std::string stream = make_record_stream(200000);
+  stream += '\n';
+  volatile size_t sink = 0;
+  report("ndjson: getline + ljson_value::parse, kept", stream.size(), bench_seconds([&] {
+    std::istringstream in(stream);
+    std::string line;
+    std::vector<std::shared_ptr<ljson_value>> documents;
+    int ret = LJSON_PARSE_OK;
+    while (std::getline(in, line))
+      documents.push_back(ljson_value::parse(line.c_str(), &ret));
+    sink = documents.size();
+  }));
+  size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+  for (size_t threads : {size_t(1), size_t(2), hardware}) {
+    ljson_ndjson::options opts;
+    opts.threads = threads;
+    std::string name = "ljson_ndjson::parse, " + std::to_string(threads) + " threads";
+    report(name.c_str(), stream.size(), bench_seconds([&] {
+      sink = ljson_ndjson::parse(stream.data(), stream.size(), opts).size();
+    }));
+    name = "ljson_ndjson::parse_unordered, " + std::to_string(threads) + " threads";
+    report(name.c_str(), stream.size(), bench_seconds([&] {
+      std::atomic<size_t> count(0);
+      ljson_ndjson::parse_unordered(stream.data(), stream.size(), [&count](ljson_ndjson::record&) { count++; },
+                                    opts);
+      sink = count.load();
+    }));
+  }
+  (void)sink;
+}
+
+/// one array of count numbers and one object of count members
+static void bench_wide() {
+  std::string array = "[", object = "{";
+  for (int i = 0; i < 100000; ++i) {
+    array += (i ? "," : "") + std::to_string(i);
+    object += (i ? ",\"k" : "\"k") + std::to_string(i) + "\":" + std::to_string(i);
+  }
+  array += "]";
+  object += "}";
+  volatile int sink = 0;
+  report("ljson_value::parse, 100k element array", array.size(), bench_seconds([&] {
+    int ret = LJSON_PARSE_OK;
+    sink = ljson_value::parse(array.data(), array.size(), &ret)->get_type();
+  }));
+  report("ljson_value::parse, 100k member object", object.size(), bench_seconds([&] {
+    int ret = LJSON_PARSE_OK;
+    sink = ljson_value::parse(object.data(), object.size(), &ret)->get_type();
+  }));
+  std::string million = "[";
+  for (int i = 0; i < 1000000; ++i)
+    million += (i ? ",[" : "[") + std::to_string(i) + "]";
+  million += "]";
+  int ret = LJSON_PARSE_OK;
+  auto value = ljson_value::parse(million.data(), million.size(), &ret);
+  double walked = 0.0;
+  size_t before = allocations.load();
+  walked = traverse(*value);
+  size_t copying = allocations.load() - before;
+  walked += traverse_views(*value);
+  size_t viewing = allocations.load() - before - copying;
+  report("walk 1M arrays, get_value_helper", million.size(), bench_seconds([&] { walked = traverse(*value); }));
+  printf("  %zu allocations per walk\n", copying);
+  report("walk 1M arrays, views", million.size(), bench_seconds([&] { walked = traverse_views(*value); }));
+  printf("  %zu allocations per walk\n", viewing);
+  sink = static_cast<int>(walked);
+  (void)sink;
+}
+
+/// 32 lookups by key on an object of 120 members, the way a router reads a message
+static void bench_find() {
+  std::string json = "{";
+  std::vector<std::string> keys;
+  for (int i = 0; i < 120; ++i) {
+    keys.push_back("header_field_" + std::to_string(i * 7919 % 1000));
+    json += (i ? ",\"" : "\"") + keys.back() + "\":" + std::to_string(i);
+  }
+  json += "}";
+  std::vector<std::string> wanted;
+  for (int i = 0; i < 32; ++i)
+    wanted.push_back(keys[(i * 37) % keys.size()]);
+  const int messages = 10000;
+  volatile double sink = 0.0;
+  auto per_lookup = [&](const char* name, double seconds) {
+    printf("%-46s %10.3f ms %8.1f ns/lookup\n", name, seconds * 1e3, seconds * 1e9 / (messages * wanted.size()));
+  };
+  int ret = LJSON_PARSE_OK;
+  std::vector<std::shared_ptr<ljson_value>> docs;
+  for (int i = 0; i < messages; ++i)
+    docs.push_back(ljson_value::parse(json.c_str(), &ret));
+  per_lookup("get_value_helper + string compare", bench_seconds([&] {
+    double sum = 0.0;
+    for (auto& doc : docs) {
+      auto members = ljson_objects::get_value_helper(doc->get_value());
+      for (auto& key : wanted)
+        for (auto& m : members)
+          if (m->key == key) {
+            sum += static_cast<const ljson_number&>(*m->value).get_double();
+            break;
+          }
+    }
+    sink = sum;
+  }));
+  per_lookup("linear scan of the entries", bench_seconds([&] {
+    double sum = 0.0;
+    for (auto& doc : docs)
+      for (auto& key : wanted)
+        for (const ljson_objects::entry& m : doc->as_object())
+          if (m.key_size == key.size() && memcmp(m.key, key.data(), key.size()) == 0) {
+            sum += static_cast<const ljson_number&>(*m.value).get_double();
+            break;
+          }
+    sink = sum;
+  }));
+  // the first lookup on a document builds its index, parsing alone for comparison
+  per_lookup("parse only", bench_seconds([&] {
+    for (auto& doc : docs)
+      doc = ljson_value::parse(json.c_str(), &ret);
+  }));
+  per_lookup("parse + find, index built on first", bench_seconds([&] {
+    double sum = 0.0;
+    for (auto& doc : docs) {
+      doc = ljson_value::parse(json.c_str(), &ret);
+      for (auto& key : wanted)
+        sum += static_cast<const ljson_number&>((*doc)[key]).get_double();
+    }
+    sink = sum;
+  }));
+  per_lookup("ljson_objects::find, index built", bench_seconds([&] {
+    double sum = 0.0;
+    for (auto& doc : docs)
+      for (auto& key : wanted)
+        sum += static_cast<const ljson_number&>((*doc)[key]).get_double();
+    sink = sum;
+  }));
+  (void)sink;
+}
+
+/// write documents back out, against parsing them, sizes are the output
+static void bench_stringify() {
+  struct {
+    const char* name;
+    std::string json;
+  } inputs[] = {
+    {"records", make_records(100000)},
+    {"strings", make_strings(20000, 200)},
+    {"numbers", make_numbers(100000)},
+    {"integers", make_integers(200000)},
+  };
+  volatile size_t sink = 0;
+  for (auto& input : inputs) {
+    int ret = LJSON_PARSE_OK;
+    auto value = ljson_value::parse(input.json.c_str(), &ret);
+    auto compact = ljson_compact_value::parse(input.json.c_str(), &ret);
+    size_t bytes = ljson_generator::stringify(*value).size();
+    std::string name = std::string(input.name) + ": parse ljson_value";
+    report(name.c_str(), input.json.size(), bench_seconds([&] {
+      sink = ljson_value::parse(input.json.c_str(), &ret)->get_type();
+    }));
+    name = std::string(input.name) + ": stringify ljson_value to std::string";
+    report(name.c_str(), bytes, bench_seconds([&] { sink = ljson_generator::stringify(*value).size(); }));
+    ljson_buffer out;
+    name = std::string(input.name) + ": stringify ljson_value, reused buffer";
+    report(name.c_str(), bytes, bench_seconds([&] {
+      out.clear();
+      ljson_generator::stringify(*value, &out);
+      sink = out.size();
+    }));
+    name = std::string(input.name) + ": stringify ljson_compact_value";
+    report(name.c_str(), bytes, bench_seconds([&] {
+      out.clear();
+      ljson_generator::stringify(*compact, &out);
+      sink = out.size();
+    }));
+  }
+  (void)sink;
+}
+
+/// small responses built from structs: through the dom, or written as events
+static void bench_writer() {
+  struct response {
+    int64_t id;
+    std::string user;
+    double score;
+    bool ok;
+  };
+  std::vector<response> responses;
+  for (int i = 0; i < 100000; ++i)
+    responses.push_back({i, "user name " + std::to_string(i), i * 0.25, i % 3 != 0});
+  auto write = [](ljson_writer& writer, const response& r) {
+    writer.start_object();
+    writer.key("id");
+    writer.number(r.id);
+    writer.key("user");
+    writer.string(r.user);
+    writer.key("tags");
+    writer.start_array();
+    writer.string("a");
+    writer.string("b");
+    writer.end_array();
+    writer.key("score");
+    writer.number(r.score);
+    writer.key("ok");
+    writer.boolean(r.ok);
+    writer.end_object();
+  };
+  ljson_buffer out;
+  size_t bytes = 0;
+  {
+    ljson_writer writer(&out);
+    for (auto& r : responses) {
+      writer.reset();
+      write(writer, r);
+    }
+    bytes = out.size();
+  }
+  volatile size_t sink = 0;
+  /// allocations are counted over one more pass
+  auto per_response = [&](const char* name, const std::function<void()>& pass) {
+    double seconds = bench_seconds(pass);
+    size_t before = allocations.load();
+    pass();
+    double allocated = static_cast<double>(allocations.load() - before) / responses.size();
+    printf("%-46s %10.3f ms %10.1f MB/s %6.0f ns/response %5.1f allocations/response\n", name, seconds * 1e3,
+           bytes / 1e6 / seconds, seconds * 1e9 / responses.size(), allocated);
+  };
+  per_response("create() + stringify, reused buffer", [&] {
+    for (auto& r : responses) {
+      std::vector<std::shared_ptr<ljson_member>> members;
+      members.push_back(std::make_shared<ljson_member>("id", ljson_number::create_int64(r.id)));
+      members.push_back(std::make_shared<ljson_member>("user", ljson_string::create(r.user)));
+      members.push_back(std::make_shared<ljson_member>(
+          "tags", ljson_array::create({ljson_string::create("a"), ljson_string::create("b")})));
+      members.push_back(std::make_shared<ljson_member>("score", ljson_number::create(r.score)));
+      members.push_back(std::make_shared<ljson_member>("ok", r.ok ? ljson_true::create() : ljson_false::create()));
+      out.clear();
+      ljson_generator::stringify(*ljson_objects::create(std::move(members)), &out);
+      sink += out.size();
+    }
+  });
+  per_response("ljson_writer, reused buffer", [&] {
+    ljson_writer writer(&out);
+    for (auto& r : responses) {
+      out.clear();
+      writer.reset();
+      write(writer, r);
+      sink += out.size();
+    }
+  });
+  per_response("ljson_writer, callback", [&] {
+    ljson_writer writer([&](const char*, size_t len) { sink += len; });
+    for (auto& r : responses) {
+      writer.reset();
+      write(writer, r);
+    }
+  });
+  (void)sink;
+}
+
+/// one small message after another, each one dropped before the next
+static void bench_parser() {
+  std::vector<std::string> messages;
+  size_t bytes = 0;
+  for (int i = 0; i < 100000; ++i) {
+    messages.push_back("{\"id\":" + std::to_string(i) + ",\"user\":\"user name " + std::to_string(i) +
+                       "\",\"tags\":[\"a\",\"b\"],\"score\":" + std::to_string(i * 0.25) + ",\"ok\":true}");
+    bytes += messages.back().size();
+  }
+  volatile size_t sink = 0;
+  auto per_message = [&](const char* name, double seconds) {
+    printf("%-46s %10.3f ms %10.1f MB/s %8.0f ns/message\n", name, seconds * 1e3, bytes / 1e6 / seconds,
+           seconds * 1e9 / messages.size());
+  };
+  per_message("ljson_value::parse", bench_seconds([&] {
+    int ret = LJSON_PARSE_OK;
+    for (auto& m : messages)
+      sink += ljson_value::parse(m.data(), m.size(), &ret)->get_type();
+  }));
+  per_message("ljson_parser::parse, new arena each", bench_seconds([&] {
+    ljson_parser parser(LJSON_PARSE_MAX_DEPTH, LJSON_ENGINE_ONE_PASS, false);
+    int ret = LJSON_PARSE_OK;
+    for (auto& m : messages)
+      sink += parser.parse(m.data(), m.size(), &ret)->get_type();
+  }));
+  per_message("ljson_parser::parse", bench_seconds([&] {
+    ljson_parser parser;
+    int ret = LJSON_PARSE_OK;
+    for (auto& m : messages)
+      sink += parser.parse(m.data(), m.size(), &ret)->get_type();
+  }));
+  per_message("ljson_compact_value::parse", bench_seconds([&] {
+    int ret = LJSON_PARSE_OK;
+    for (auto& m : messages)
+      sink += ljson_compact_value::parse(m.data(), m.size(), &ret)->get_type();
+  }));
+  per_message("ljson_parser::parse_compact", bench_seconds([&] {
+    ljson_parser parser;
+    int ret = LJSON_PARSE_OK;
+    for (auto& m : messages)
+      sink += parser.parse_compact(m.data(), m.size(), &ret)->get_type();
+  }));
+  per_message("ljson_compact_value::parse, two stage", bench_seconds([&] {
+    int ret = LJSON_PARSE_OK;
+    for (auto& m : messages)
+      sink += ljson_compact_value::parse(m.data(), m.size(), &ret, LJSON_PARSE_MAX_DEPTH,
+                                         LJSON_ENGINE_TWO_STAGE)->get_type();
+  }));
+  per_message("ljson_parser::parse_compact, two stage", bench_seconds([&] {
+    ljson_parser parser(LJSON_PARSE_MAX_DEPTH, LJSON_ENGINE_TWO_STAGE);
+    int ret = LJSON_PARSE_OK;
+    for (auto& m : messages)
+      sink += parser.parse_compact(m.data(), m.size(), &ret)->get_type();
+  }));
+  (void)sink;
+}
+
+/// counts the events, nearly all the time goes to the parser
+struct count_events {
+  bool null() { return ++events != 0; }
+  bool boolean(bool) { return ++events != 0; }
+  bool number(const ljson_number_value&) { return ++events != 0; }
+  bool string(const char*, size_t) { return ++events != 0; }
+  bool key(const char*, size_t) { return ++events != 0; }
+  bool start_object() { return ++events != 0; }
+  bool end_object(size_t) { return ++events != 0; }
+  bool start_array() { return ++events != 0; }
+  bool end_array(size_t) { return ++events != 0; }
+
+  size_t events = 0;
+};
+
+static void bench_two_stage() {
+  struct {
+    const char* name;
+    std::string json;
+  } corpora[] = {
+    {"records", make_records(100000)},
+    {"nested, indented", make_nested(20000, 4)},
+    {"long strings", make_strings(20000, 200)},
+  };
+  volatile size_t sink = 0;
+  for (auto& corpus : corpora) {
+    const std::string& json = corpus.json;
+    printf("-- %s\n", corpus.name);
+    ljson_structural_index index;
+    report("stage 1 only", json.size(), bench_seconds([&] {
+      index.build(json.data(), json.size());
+      sink = index.size();
+    }));
+    const char* engines[] = {"one pass", "two stage"};
+    for (LJSON_ENGINE engine : {LJSON_ENGINE_ONE_PASS, LJSON_ENGINE_TWO_STAGE}) {
+      std::string name = std::string("sax, ") + engines[engine];
+      report(name.c_str(), json.size(), bench_seconds([&] {
+        count_events handler;
+        ljson_sax::parse(json.data(), json.size(), handler, LJSON_PARSE_MAX_DEPTH, engine);
+        sink = handler.events;
+      }));
+      name = std::string("ljson_compact_value, ") + engines[engine];
+      report(name.c_str(), json.size(), bench_seconds([&] {
+        int ret = LJSON_PARSE_OK;
+        sink = ljson_compact_value::parse(json.data(), json.size(), &ret, LJSON_PARSE_MAX_DEPTH, engine)->size();
+      }));
+    }
+  }
+  (void)sink;
+}
+
+static void bench_tape() {
+  struct {
+    const char* name;
+    std::string json;
+  } corpora[] = {
+    {"records", make_records(100000)},
+    {"nested", make_nested(20000, 0)},
+  };
+  volatile double sink = 0.0;
+  for (auto& corpus : corpora) {
+    const std::string& json = corpus.json;
+    printf("-- %s\n", corpus.name);
+    int ret = LJSON_PARSE_OK;
+    report("parse ljson_value", json.size(), bench_seconds([&] {
+      ljson_value::parse(json.data(), json.size(), &ret);
+    }));
+    report("parse ljson_compact_value", json.size(), bench_seconds([&] {
+      ljson_compact_value::parse(json.data(), json.size(), &ret);
+    }));
+    report("parse ljson_tape", json.size(), bench_seconds([&] {
+      ljson_tape::parse(json.data(), json.size(), &ret);
+    }));
+    auto value = ljson_value::parse(json.data(), json.size(), &ret);
+    auto compact = ljson_compact_value::parse(json.data(), json.size(), &ret);
+    auto tape = ljson_tape::parse(json.data(), json.size(), &ret);
+    report("traverse ljson_value", json.size(), bench_seconds([&] { sink = traverse(*value); }));
+  report("traverse ljson_value, views", json.size(), bench_seconds([&] { sink = traverse_views(*value); }));
+    report("traverse ljson_compact_value", json.size(), bench_seconds([&] { sink = traverse(*compact); }));
+    report("traverse ljson_tape", json.size(), bench_seconds([&] { sink = traverse(tape->root()); }));
+    /// the first member of every record, the rest of each record is skipped
+    report("first members, ljson_tape skipping", json.size(), bench_seconds([&] {
+      double sum = 0.0;
+      ljson_tape_value record = tape->root()[0];
+      for (size_t i = 0; i < tape->root().size(); ++i, record = record.next())
+        sum += record.get_member(0).value.get_number();
+      sink = sum;
+    }));
+    printf("tape: %zu words, %.1f bytes per input byte\n", tape->size(), tape->size() * 8.0 / json.size());
+  }
+  (void)sink;
+}
+
+/// one object of fields members, "user" and "status" in the middle, "last" at the end
+static std::string make_wide_object(int fields, int seed) {
+  std::string json = "{";
+  for (int i = 0; i < fields; ++i) {
+    if (i) json += ",";
+    if (i == fields / 2)
+      json += "\"user\":{\"id\":" + std::to_string(seed) + ",\"name\":\"user " + std::to_string(seed) + "\"},"
+              "\"status\":\"active\",";
+    json += "\"field" + std::to_string(i) + "\":";
+    switch (i % 4) {
+      case 0: json += std::to_string(i * seed); break;
+      case 1: json += "\"value " + std::to_string(i) + "\""; break;
+      case 2: json += "[1,2,{\"x\":\"]\"}]"; break;
+      default: json += "{\"a\":true,\"b\":null}"; break;
+    }
+  }
+  json += ",\"last\":1}";
+  return json;
+}
+
+static void bench_ondemand() {
+  std::vector<std::string> docs;
+  size_t bytes = 0;
+  for (int i = 0; i < 2000; ++i) {
+    docs.push_back(make_wide_object(200, i));
+    bytes += docs.back().size();
+  }
+  volatile double sink = 0.0;
+  /// read user.id, user.name and status from every document
+  report("ljson_value, 3 fields", bytes, bench_seconds([&] {
+    double sum = 0.0;
+    for (auto& json : docs) {
+      int ret = LJSON_PARSE_OK;
+      auto value = ljson_value::parse(json.data(), json.size(), &ret);
+      for (auto& m : ljson_objects::get_value_helper(value->get_value())) {
+        if (m->key == "user") {
+          auto user = ljson_objects::get_value_helper(m->value->get_value());
+          sum += ljson_number::get_value_helper(user[0]->value->get_value());
+          sum += ljson_string::get_value_helper(user[1]->value->get_value()).size();
+        } else if (m->key == "status") {
+          sum += ljson_string::get_value_helper(m->value->get_value()).size();
+        }
+      }
+    }
+    sink = sum;
+  }));
+  report("ljson_tape, 3 fields", bytes, bench_seconds([&] {
+    double sum = 0.0;
+    for (auto& json : docs) {
+      int ret = LJSON_PARSE_OK;
+      auto tape = ljson_tape::parse(json.data(), json.size(), &ret);
+      ljson_tape_member m = tape->root().get_member(0);
+      for (size_t i = 0, n = tape->root().size(); i < n; ++i) {
+        if (strcmp(m.key.get_string(), "user") == 0) {
+          sum += m.value.get_member(0).value.get_number();
+          sum += m.value.get_member(1).value.get_string_length();
+        } else if (strcmp(m.key.get_string(), "status") == 0) {
+          sum += m.value.get_string_length();
+        }
+        m.key = m.value.next();
+        m.value = m.key.next();
+      }
+    }
+    sink = sum;
+  }));
+  report("ondemand, 3 fields", bytes, bench_seconds([&] {
+    double sum = 0.0;
+    for (auto& json : docs) {
+      ljson_ondemand_document doc(json.data(), json.size());
+      ljson_ondemand_value user = doc["user"];
+      int64_t id = 0;
+      const char* str = nullptr;
+      size_t len = 0;
+      user["id"].get_int64(&id);
+      sum += id;
+      user["name"].get_string(&str, &len);
+      sum += len;
+      doc["status"].get_string(&str, &len);
+      sum += len;
+    }
+    sink = sum;
+  }));
+  report("ondemand, last field", bytes, bench_seconds([&] {
+    double sum = 0.0;
+    for (auto& json : docs) {
+      int64_t last = 0;
+      ljson_ondemand_document(json.data(), json.size())["last"].get_int64(&last);
+      sum += last;
+    }
+    sink = sum;
+  }));
+  /// one member after a large subtree, skipped by bracket matching
+  std::string big = "{\"records\":" + make_records(100000) + ",\"id\":7}";
+  report("ondemand, member after a large subtree", big.size(), bench_seconds([&] {
+    int64_t id = 0;
+    ljson_ondemand_document(big.data(), big.size())["id"].get_int64(&id);
+    sink = static_cast<double>(id);
+  }));
+  (void)sink;
+}
+
+static void bench_file() {
+  std::string json = make_strings(100000, 400);
+  const char* path = "/tmp/ljson_bench_file.json";
+  {
+    std::ofstream out(path, std::ios::binary);
+    out << json;
+  }
+  volatile size_t sink = 0;
+  int ret = LJSON_PARSE_OK;
+  report("read() into a string, parse", json.size(), bench_seconds([&] {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    std::string content(static_cast<size_t>(in.tellg()), '\0');
+    in.seekg(0);
+    in.read(&content[0], content.size());
+    sink = ljson_compact_value::parse(content.data(), content.size(), &ret)->size();
+  }));
+  report("parse_file", json.size(), bench_seconds([&] {
+    sink = ljson_compact_value::parse_file(path, &ret)->size();
+  }));
+  report("parse_file, zero copy", json.size(), bench_seconds([&] {
+    sink = ljson_compact_value::parse_file(path, &ret, LJSON_FILE_ZERO_COPY)->size();
+  }));
+  remove(path);
+  (void)sink;
+}
+
+#if defined(__unix__)
+/// write documents to a pipe and to a tmpfs file: copied into a buffer first, or gathered with writev()
+static void bench_write_fd() {
+  std::string blobs = "[";
+  for (int i = 0; i < 16; ++i)
+    blobs += (i ? ",\"" : "\"") + std::string(4 << 20, static_cast<char>('a' + i)) + "\"";
+  blobs += "]";
+  struct {
+    const char* name;
+    std::string json;
+  } inputs[] = {
+    {"4 MB strings", blobs},
+    {"long strings", make_strings(20000, 2000)},
+    {"records", make_records(100000)},
+  };
+
+  int fds[2];
+  if (pipe(fds) != 0)
+    return;
+  std::thread drain([&] {
+    char chunk[1 << 16];
+    while (read(fds[0], chunk, sizeof(chunk)) > 0) {}
+  });
+  const char* path = "/dev/shm/ljson_bench_write.json";
+  int file = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  if (file < 0) {
+    path = "/tmp/ljson_bench_write.json";
+    file = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  }
+
+  auto write_all = [](int fd, const char* p, size_t n) {
+    while (n != 0) {
+      ssize_t written = write(fd, p, n);
+      if (written <= 0)
+        return;
+      p += written;
+      n -= static_cast<size_t>(written);
+    }
+  };
+  for (auto& input : inputs) {
+    int ret = LJSON_PARSE_OK;
+    auto value = ljson_value::parse(input.json.c_str(), &ret);
+    ljson_buffer out;
+    ljson_generator::stringify(*value, &out);
+    size_t bytes = out.size();
+    struct {
+      const char* sink;
+      int fd;
+    } sinks[] = {{"pipe", fds[1]}, {"tmpfs", file}};
+    for (auto& sink : sinks) {
+      auto rewind = [&] {
+        if (sink.fd == file) {
+          lseek(file, 0, SEEK_SET);
+          if (ftruncate(file, 0) != 0)
+            return;
+        }
+      };
+      std::string name = std::string(input.name) + ", " + sink.sink + ": stringify + write";
+      report(name.c_str(), bytes, bench_seconds([&] {
+        rewind();
+        out.clear();
+        ljson_generator::stringify(*value, &out);
+        write_all(sink.fd, out.data(), out.size());
+      }));
+      name = std::string(input.name) + ", " + sink.sink + ": writev";
+      report(name.c_str(), bytes, bench_seconds([&] {
+        rewind();
+        ljson_generator::write(*value, sink.fd);
+      }));
+    }
+  }
+  close(fds[1]);
+  drain.join();
+  close(fds[0]);
+  close(file);
+  remove(path);
+}
+#endif
+
+/// walk the document like the tokenizer does: skip whitespace, consume one byte
+template<typename Skip>
+static size_t walk_tokens(const char* p, Skip skip) {
+  size_t tokens = 0;
+  for (;;) {
+    p = skip(p);
+    if (*p == '\0')
+      return tokens;
+    p++;
+    tokens++;
+  }
+}
+
+static void bench_whitespace() {
+  const int indents[] = {0, 2, 4, 8};
+  for (int indent : indents) {
+    std::string json = make_nested(20000, indent);
+    size_t minified = make_nested(20000, 0).size();
+    int ret = LJSON_PARSE_OK;
+    volatile size_t sink = 0;
+    char name[64];
+    /// throughput of the minified size, only whitespace differs between the variants
+    snprintf(name, sizeof(name), "indent %d: scalar skip", indent);
+    report(name, minified, bench_seconds([&] {
+      sink = walk_tokens(json.c_str(), [](const char* p) {
+        while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')
+          p++;
+        return p;
+      });
+    }));
+    snprintf(name, sizeof(name), "indent %d: fast path + simd skip", indent);
+    report(name, minified, bench_seconds([&] {
+      const char* end = json.c_str() + json.size();
+      sink = walk_tokens(json.c_str(), [end](const char* p) {
+        if (!simd::is_whitespace(p[0]))
+          return p;
+        if (!simd::is_whitespace(p[1]))
+          return p + 1;
+        return simd::skip_whitespace(p + 2, end);
+      });
+    }));
+    snprintf(name, sizeof(name), "indent %d: parse", indent);
+    report(name, minified, bench_seconds([&] {
+      ljson_compact_value::parse(json.c_str(), &ret);
+    }));
+    (void)sink;
+  }
+}
+
+int main(int argc, char* argv[]) {
+  const char* filter = argc > 1 ? argv[1] : "";
+  struct {
+    const char* name;
+    void (*fn)();
+  } benches[] = {
+    {"compact_value", bench_compact_value},
+    {"insitu", bench_insitu},
+    {"strings", bench_strings},
+    {"whitespace", bench_whitespace},
+    {"numbers", bench_numbers},
+    {"integers", bench_integers},
+    {"bounded", bench_bounded},
+    {"sax", bench_sax},
+    {"push", bench_push},
+    {"wide", bench_wide},
+    {"find", bench_find},
+    {"stringify", bench_stringify},
+    {"writer", bench_writer},
+#if defined(__unix__)
+    {"write_fd", bench_write_fd},
+#endif
+    {"parser", bench_parser},
+    {"ndjson", bench_ndjson},
+    {"two_stage", bench_two_stage},
+    {"tape", bench_tape},
+    {"ondemand", bench_ondemand},
+    {"file", bench_file},
+  };
+  for (auto& b : benches) {
+    if (strstr(b.name, filter) == nullptr)
+      continue;
+    printf("== %s\n", b.name);
+    b.fn();
+  }
+  return 0;
+}
@@ -0,0 +1,288 @@
+#ifndef LJSON_LJSON_CONTEXT_H_
+#define LJSON_LJSON_CONTEXT_H_
+
+/*
+ * parser state and grammar, shared by the document builders in ljson.cc and
+ * the sax interface of ljson_sax.h. the tokenizer is compiled once into the
+ * library, the loop driving a handler is a template so that handler calls
+ * are inlined.
+ */
+
+#include "ljson.h"
+#include "ljson_simd.h"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ljson {
+
+class ljson_structural_index;
+
+struct ljson_context {
+public:
+  /// @arena: where strings are copied, nullptr leaves them valid only until the next handler call
+  ljson_context(const char* json, const char* end, ljson_arena* arena, bool insitu = false, bool padded = false,
+                size_t max_depth = LJSON_PARSE_MAX_DEPTH)
+    : json_(json), end_(end), stack_(nullptr), size_(0), top_(0), arena_(arena), insitu_(insitu),
+      padded_(padded), borrow_(false), max_depth_(max_depth), index_(nullptr) {}
+  ~ljson_context();
+  /// start over on another input, the stack and the buffers keep their capacity
+  void reset(const char* json, const char* end, ljson_arena* arena, bool insitu, bool padded);
+  /// current character, '\0' at the end of the input
+  char peek() const { return json_ != end_ ? *json_ : '\0'; }
+  inline void parse_whitespace();
+  LJSON_STATE parse_literal_raw(const char* literal);
+  LJSON_STATE parse_number_raw(ljson_number_value *number);
+  static size_t encode_utf8(unsigned u, char *out);
+  /*
+   * @p: position after '\\'
+   * @out: receives the decoded bytes, at most 4, @n: number of them
+   * @return: position after the escape, nullptr on error with *state set
+   */
+  static const char* parse_escape(const char *p, const char *end, char *out, size_t *n, LJSON_STATE *state);
+  /// simd scanners bounded by end_, they may read past it on padded input
+  inline const char* scan_string(const char *p) const;
+  inline const char* skip_whitespace(const char *p) const;
+  /// unescape into the stack or point into the input, result is valid until the next push
+  LJSON_STATE parse_string_raw(const char **str, size_t *len);
+  /// unescape in place, only in insitu mode
+  LJSON_STATE parse_string_insitu(const char **str, size_t *len);
+  /// result lives as long as the document: in the input or in the arena, without arena see parse_string_raw
+  LJSON_STATE parse_string_persist(const char **str, size_t *len);
+
+  /*
+   * parse one value, nested containers included, without recursion: the
+   * open containers are kept in frames_. the value is reported to handler
+   * as a sequence of calls, see ljson_sax for the interface.
+   * @return: LJSON_PARSE_NESTING_TOO_DEEP past max_depth_ open containers,
+   *          LJSON_PARSE_HANDLER_STOPPED when a call returned false
+   */
+  template<typename Handler>
+  LJSON_STATE parse_value(Handler& handler);
+  /// parse '"key" :' of an object member
+  template<typename Handler>
+  LJSON_STATE parse_key(Handler& handler);
+  /// parse the whole input as a single value
+  template<typename Handler>
+  LJSON_STATE parse_root(Handler& handler);
+  /*
+   * same as parse_root() with the two stage engine, defined in ljson_index.h:
+   * the input is indexed first, parse_indexed() walks the positions.
+   */
+  template<typename Handler>
+  LJSON_STATE parse_root_indexed(Handler& handler);
+  /// @i: structural positions relative to json_, ending with the input length
+  template<typename Handler>
+  LJSON_STATE parse_indexed(const uint32_t* i, Handler& handler);
+  template<typename Handler>
+  LJSON_STATE parse_indexed_key(const char* base, const uint32_t* i, Handler& handler);
+
+  /// builders of ljson_value and ljson_compact_value documents
+  struct dom_builder;
+  struct compact_builder;
+  /// builder of ljson_tape documents, in ljson_tape.cc
+  struct tape_builder;
+
+public:
+  static const char* parse_hex4(const char* p, const char* end, unsigned *u);
+  void put_char(char ch);
+  void *push(size_t size);
+  void *pop(size_t size);
+
+  /// move the last size items of stack into an arena array in one copy
+  template<typename T>
+  T* pop_slice(std::vector<T>& stack, size_t size);
+
+public:
+  const char *json_;
+  /// end of the input, nothing is parsed from there
+  const char *end_;
+  char *stack_;
+  size_t size_, top_;
+  ljson_arena *arena_;
+  /// strings are unescaped in place and point into the input
+  bool insitu_;
+  /// LJSON_PADDING readable bytes follow end_
+  bool padded_;
+  /// the input lives as long as the document, parse_string_persist() keeps strings without escape in it
+  bool borrow_;
+  /// finished values of dom_builder, waiting for their container to end
+  std::vector<ljson_value*> values_;
+  /// keys of the open objects of dom_builder, end_object() fills in the values
+  std::vector<ljson_objects::entry> keys_;
+  /// an open container of parse_value()
+  struct frame {
+    bool object;
+    size_t size;  /* values completed so far */
+  };
+  std::vector<frame> frames_;
+  size_t max_depth_;
+  /// reused by parse_root_indexed() when set, a local one is built otherwise
+  ljson_structural_index *index_;
+  /*
+   * @ch: next expected character
+   * @noted: exit if next character is not ch
+   */
+  inline void expect_next(const char &ch);
+};
+
+void ljson_context::expect_next(const char &ch) {
+  assert(json_ != end_ && *json_ == ch);
+  (void)ch;  /* only checked by assert */
+  json_++;
+}
+
+const char* ljson_context::scan_string(const char *p) const {
+  return padded_ ? simd::scan_string<true>(p, end_) : simd::scan_string<false>(p, end_);
+}
+
+const char* ljson_context::skip_whitespace(const char *p) const {
+  return padded_ ? simd::skip_whitespace<true>(p, end_) : simd::skip_whitespace<false>(p, end_);
+}
+
+void ljson_context::parse_whitespace() {
+  // most tokens are preceded by no or a single whitespace, like in "a": 1
+  if (json_ == end_ || !simd::is_whitespace(json_[0]))
+    return;
+  if (json_ + 1 == end_ || !simd::is_whitespace(json_[1])) {
+    json_ += 1;
+    return;
+  }
+  json_ = skip_whitespace(json_ + 2);
+}
+
+template<typename Handler>
+LJSON_STATE ljson_context::parse_key(Handler& handler) {
+  const char *key = nullptr;
+  size_t len = 0;
+  LJSON_STATE ret;
+  if (peek() != '"')
+    return LJSON_PARSE_MISS_KEY;
+  if ((ret = parse_string_persist(&key, &len)) != LJSON_PARSE_OK)
+    return ret;
+  if (!handler.key(key, len))
+    return LJSON_PARSE_HANDLER_STOPPED;
+  parse_whitespace();
+  if (peek() != ':')
+    return LJSON_PARSE_MISS_COLON;
+  json_++;
+  parse_whitespace();
+  return LJSON_PARSE_OK;
+}
+
+#define LJSON_VALUE_ERROR(ret) do { frames_.resize(base); return ret; } while(0)
+#define LJSON_HANDLE(call) do { if (!(call)) LJSON_VALUE_ERROR(LJSON_PARSE_HANDLER_STOPPED); } while(0)
+
+template<typename Handler>
+LJSON_STATE ljson_context::parse_value(Handler& handler) {
+  const size_t base = frames_.size();
+  LJSON_STATE ret;
+  for (;;) {
+    // a value starts at json_, whitespace skipped
+    switch (peek()) {
+      case 'n':
+        if ((ret = parse_literal_raw("null")) != LJSON_PARSE_OK)
+          LJSON_VALUE_ERROR(ret);
+        LJSON_HANDLE(handler.null());
+        break;
+      case 't':
+        if ((ret = parse_literal_raw("true")) != LJSON_PARSE_OK)
+          LJSON_VALUE_ERROR(ret);
+        LJSON_HANDLE(handler.boolean(true));
+        break;
+      case 'f':
+        if ((ret = parse_literal_raw("false")) != LJSON_PARSE_OK)
+          LJSON_VALUE_ERROR(ret);
+        LJSON_HANDLE(handler.boolean(false));
+        break;
+      case '"': {
+        const char *str = nullptr;
+        size_t len = 0;
+        if ((ret = parse_string_persist(&str, &len)) != LJSON_PARSE_OK)
+          LJSON_VALUE_ERROR(ret);
+        LJSON_HANDLE(handler.string(str, len));
+        break;
+      }
+      case '[':
+        if (frames_.size() - base >= max_depth_)
+          LJSON_VALUE_ERROR(LJSON_PARSE_NESTING_TOO_DEEP);
+        json_++;
+        LJSON_HANDLE(handler.start_array());
+        parse_whitespace();
+        if (peek() == ']') {
+          json_++;
+          LJSON_HANDLE(handler.end_array(0));
+          break;
+        }
+        frames_.push_back(frame{false, 0});
+        continue;
+      case '{':
+        if (frames_.size() - base >= max_depth_)
+          LJSON_VALUE_ERROR(LJSON_PARSE_NESTING_TOO_DEEP);
+        json_++;
+        LJSON_HANDLE(handler.start_object());
+        parse_whitespace();
+        if (peek() == '}') {
+          json_++;
+          LJSON_HANDLE(handler.end_object(0));
+          break;
+        }
+        frames_.push_back(frame{true, 0});
+        if ((ret = parse_key(handler)) != LJSON_PARSE_OK)
+          LJSON_VALUE_ERROR(ret);
+        continue;
+      case '\0':
+        LJSON_VALUE_ERROR(LJSON_PARSE_EXPECT_VALUE);
+      default: {
+        ljson_number_value number;
+        if ((ret = parse_number_raw(&number)) != LJSON_PARSE_OK)
+          LJSON_VALUE_ERROR(ret);
+        LJSON_HANDLE(handler.number(number));
+        break;
+      }
+    }
+    // a value is complete, close every container ending right after it
+    for (;;) {
+      if (frames_.size() == base)
+        return LJSON_PARSE_OK;
+      frame& top = frames_.back();
+      top.size++;
+      parse_whitespace();
+      char ch = peek();
+      if (ch == ',') {
+        json_++;
+        parse_whitespace();
+        if (top.object && (ret = parse_key(handler)) != LJSON_PARSE_OK)
+          LJSON_VALUE_ERROR(ret);
+        break;
+      }
+      if (ch != (top.object ? '}' : ']'))
+        LJSON_VALUE_ERROR(LJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET);
+      json_++;
+      frame closed = top;
+      frames_.pop_back();
+      if (closed.object)
+        LJSON_HANDLE(handler.end_object(closed.size));
+      else
+        LJSON_HANDLE(handler.end_array(closed.size));
+    }
+  }
+}
+
+#undef LJSON_HANDLE
+#undef LJSON_VALUE_ERROR
+
+template<typename Handler>
+LJSON_STATE ljson_context::parse_root(Handler& handler) {
+  parse_whitespace();
+  LJSON_STATE ret = parse_value(handler);
+  if (ret != LJSON_PARSE_OK)
+    return ret;
+  parse_whitespace();
+  return json_ == end_ ? LJSON_PARSE_OK : LJSON_PARSE_ROOT_NOT_SINGULAR;
+}
+
+} // namespace ljson
+
+#endif //LJSON_LJSON_CONTEXT_H_
@@ -0,0 +1,665 @@
+#include "ljson_conv.h"
+#include <cassert> // assert()
+#include <cmath>   // HUGE_VAL, std::signbit()
+#include <cstring> // memcpy()
+
+namespace ljson {
+
+namespace conv {
+
+namespace {
+
+#if defined(__SIZEOF_INT128__)
+__extension__ typedef unsigned __int128 uint128_t;
+
+inline uint64_t mul64(uint64_t a, uint64_t b, uint64_t *lo) {
+  uint128_t r = static_cast<uint128_t>(a) * b;
+  *lo = static_cast<uint64_t>(r);
+  return static_cast<uint64_t>(r >> 64);
+}
+#else
+inline uint64_t mul64(uint64_t a, uint64_t b, uint64_t *lo) {
+  uint64_t a_lo = a & 0xFFFFFFFF, a_hi = a >> 32, b_lo = b & 0xFFFFFFFF, b_hi = b >> 32;
+  uint64_t ll = a_lo * b_lo, lh = a_lo * b_hi, hl = a_hi * b_lo, hh = a_hi * b_hi;
+  uint64_t mid = (ll >> 32) + (lh & 0xFFFFFFFF) + (hl & 0xFFFFFFFF);
+  *lo = (mid << 32) | (ll & 0xFFFFFFFF);
+  return hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+}
+#endif
+
+inline uint64_t to_bits(double d) {
+  uint64_t bits;
+  memcpy(&bits, &d, sizeof(d));
+  return bits;
+}
+
+inline double from_bits(uint64_t bits) {
+  double d;
+  memcpy(&d, &bits, sizeof(d));
+  return d;
+}
+
+const uint64_t kInfinityBits = 0x7FF0000000000000ull;
+const uint64_t kFractionMask = 0x000FFFFFFFFFFFFFull;
+
+/// unsigned integer of fixed capacity, large enough for the exact fallback
+class bigint {
+public:
+  static const int kCapacity = 200;  /* 32-bit limbs */
+
+  bigint() : size_(0) {}
+
+  explicit bigint(uint64_t value) : size_(0) {
+    for (; value != 0; value >>= 32)
+      limbs_[size_++] = static_cast<uint32_t>(value);
+  }
+
+  void mul_small(uint32_t m) {
+    uint64_t carry = 0;
+    for (int i = 0; i < size_; ++i) {
+      uint64_t t = static_cast<uint64_t>(limbs_[i]) * m + carry;
+      limbs_[i] = static_cast<uint32_t>(t);
+      carry = t >> 32;
+    }
+    if (carry != 0)
+      push(static_cast<uint32_t>(carry));
+  }
+
+  void add_small(uint32_t a) {
+    uint64_t carry = a;
+    for (int i = 0; i < size_ && carry != 0; ++i) {
+      uint64_t t = static_cast<uint64_t>(limbs_[i]) + carry;
+      limbs_[i] = static_cast<uint32_t>(t);
+      carry = t >> 32;
+    }
+    if (carry != 0)
+      push(static_cast<uint32_t>(carry));
+  }
+
+  void mul_pow5(unsigned n) {
+    static const uint32_t kPow5[] = {1, 5, 25, 125, 625, 3125, 15625, 78125, 390625, 1953125,
+                                     9765625, 48828125, 244140625, 1220703125};
+    for (; n >= 13; n -= 13)
+      mul_small(kPow5[13]);
+    if (n != 0)
+      mul_small(kPow5[n]);
+  }
+
+  void shift_left(unsigned n) {
+    if (size_ == 0)
+      return;
+    unsigned words = n / 32, bits = n % 32;
+    if (bits != 0) {
+      uint32_t carry = 0;
+      for (int i = 0; i < size_; ++i) {
+        uint32_t v = limbs_[i];
+        limbs_[i] = (v << bits) | carry;
+        carry = v >> (32 - bits);
+      }
+      if (carry != 0)
+        push(carry);
+    }
+    if (words != 0) {
+      assert(size_ + words <= kCapacity);
+      memmove(limbs_ + words, limbs_, size_ * sizeof(uint32_t));
+      memset(limbs_, 0, words * sizeof(uint32_t));
+      size_ += words;
+    }
+  }
+
+  /// @return: remainder
+  uint32_t div_small(uint32_t d) {
+    uint64_t rem = 0;
+    for (int i = size_ - 1; i >= 0; --i) {
+      uint64_t cur = (rem << 32) | limbs_[i];
+      limbs_[i] = static_cast<uint32_t>(cur / d);
+      rem = cur % d;
+    }
+    while (size_ > 0 && limbs_[size_ - 1] == 0)
+      size_--;
+    return static_cast<uint32_t>(rem);
+  }
+
+  int bit_length() const {
+    return size_ == 0 ? 0 : 32 * size_ - __builtin_clz(limbs_[size_ - 1]);
+  }
+
+  /// bits [shift, shift + 64)
+  uint64_t bits_at(int shift) const {
+    int word = shift / 32, offset = shift % 32;
+    uint64_t lo = limb(word) | (static_cast<uint64_t>(limb(word + 1)) << 32);
+    if (offset == 0)
+      return lo;
+    return (lo >> offset) | (static_cast<uint64_t>(limb(word + 2)) << (64 - offset));
+  }
+
+  static int compare(const bigint& a, const bigint& b) {
+    if (a.size_ != b.size_)
+      return a.size_ < b.size_ ? -1 : 1;
+    for (int i = a.size_ - 1; i >= 0; --i)
+      if (a.limbs_[i] != b.limbs_[i])
+        return a.limbs_[i] < b.limbs_[i] ? -1 : 1;
+    return 0;
+  }
+
+private:
+  uint32_t limb(int i) const { return i >= 0 && i < size_ ? limbs_[i] : 0; }
+
+  void push(uint32_t limb) {
+    assert(size_ < kCapacity);
+    limbs_[size_++] = limb;
+  }
+
+  uint32_t limbs_[kCapacity];
+  int size_;
+};
+
+/*
+ * 128-bit approximations of 10^e for e in [kMinExp10, kMaxExp10], rounded
+ * down and normalized so that the top bit is set. they are computed once
+ * from exact big integers: 10^e directly, 10^-e as 2^kShift / 10^e.
+ */
+const int kMinExp10 = -348;
+const int kMaxExp10 = 347;
+
+struct pow10_table {
+  static const int kShift = 1312;
+
+  pow10_table() {
+    bigint x(1);
+    for (int e = 0; e <= kMaxExp10; ++e) {
+      if (e != 0)
+        x.mul_small(10);
+      store(e, x);
+    }
+    /// floor(floor(a / b) / c) == floor(a / (b * c)), dividing by 10 step by step is exact
+    bigint y(1);
+    y.shift_left(kShift);
+    for (int e = 1; e <= -kMinExp10; ++e) {
+      y.div_small(10);
+      store(-e, y);
+    }
+  }
+
+  void store(int e, bigint x) {
+    int len = x.bit_length();
+    if (len < 128) {
+      x.shift_left(128 - len);
+      len = 128;
+    }
+    hi[e - kMinExp10] = x.bits_at(len - 64);
+    lo[e - kMinExp10] = x.bits_at(len - 128);
+  }
+
+  uint64_t hi[kMaxExp10 - kMinExp10 + 1];
+  uint64_t lo[kMaxExp10 - kMinExp10 + 1];
+};
+
+const pow10_table& pow10_128() {
+  static const pow10_table table;
+  return table;
+}
+
+/*
+ * Eisel-Lemire: man * 10^exp10 from a 64x128 bits product.
+ * reference: https://nigeltao.github.io/blog/2020/eisel-lemire.html
+ * @man: not zero
+ * @return: false when 128 bits cannot decide the rounding, or the result is
+ *          subnormal or infinite
+ */
+bool eisel_lemire(uint64_t man, int64_t exp10, uint64_t *bits) {
+  if (exp10 < kMinExp10 || exp10 > kMaxExp10)
+    return false;
+  const pow10_table& table = pow10_128();
+  int clz = __builtin_clzll(man);
+  man <<= clz;
+  /// 217706 / 2^16 ~ log2(10)
+  uint64_t ret_exp2 = static_cast<uint64_t>(((217706 * exp10) >> 16) + 64 + 1023) - clz;
+
+  uint64_t x_lo;
+  uint64_t x_hi = mul64(man, table.hi[exp10 - kMinExp10], &x_lo);
+  // wider approximation when the low bits are all ones
+  if ((x_hi & 0x1FF) == 0x1FF && x_lo + man < man) {
+    uint64_t y_lo;
+    uint64_t y_hi = mul64(man, table.lo[exp10 - kMinExp10], &y_lo);
+    uint64_t merged_hi = x_hi, merged_lo = x_lo + y_hi;
+    if (merged_lo < x_lo)
+      merged_hi++;
+    if ((merged_hi & 0x1FF) == 0x1FF && merged_lo + 1 == 0 && y_lo + man < man)
+      return false;
+    x_hi = merged_hi;
+    x_lo = merged_lo;
+  }
+
+  // shift to 54 bits
+  uint64_t msb = x_hi >> 63;
+  uint64_t ret_mantissa = x_hi >> (msb + 9);
+  ret_exp2 -= 1 ^ msb;
+
+  // half-way ambiguity
+  if (x_lo == 0 && (x_hi & 0x1FF) == 0 && (ret_mantissa & 3) == 1)
+    return false;
+
+  // from 54 to 53 bits
+  ret_mantissa += ret_mantissa & 1;
+  ret_mantissa >>= 1;
+  if (ret_mantissa >> 53 > 0) {
+    ret_mantissa >>= 1;
+    ret_exp2 += 1;
+  }
+  /// ret_exp2 <= 0 or >= 0x7FF: subnormal or infinite
+  if (ret_exp2 - 1 >= 0x7FF - 1)
+    return false;
+  *bits = (ret_exp2 << 52) | (ret_mantissa & kFractionMask);
+  return true;
+}
+
+/// exactly representable powers of ten, for the Clinger fast path
+const double kExactPow10[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/// digits of a number with an exponent, value = digits * 10^exponent
+struct digit_string {
+  static const int kMaxDigits = 768;  /* enough to tell any two halfway points apart */
+  char digits[kMaxDigits + 1];
+  int size;
+  int64_t exponent;
+};
+
+int64_t parse_exponent(const char *p, const char *last) {
+  int64_t exp = 0;
+  bool negative = false;
+  if (p < last && (*p == '+' || *p == '-'))
+    negative = *p++ == '-';
+  for (; p < last; ++p)
+    if (exp < 100000000)
+      exp = exp * 10 + (*p - '0');
+  return negative ? -exp : exp;
+}
+
+/*
+ * significant digits of the number text. past kMaxDigits only whether the
+ * dropped digits are all zeros matters, a non-zero tail becomes a final '1'.
+ */
+void collect_digits(const decimal& d, digit_string *s) {
+  const char* p = d.first;
+  if (*p == '-')
+    p++;
+  bool in_fraction = false, sticky = false;
+  s->size = 0;
+  s->exponent = 0;
+  for (; p < d.last && *p != 'e' && *p != 'E'; ++p) {
+    if (*p == '.') {
+      in_fraction = true;
+      continue;
+    }
+    if (s->size == 0 && *p == '0') {
+      s->exponent -= in_fraction;
+    } else if (s->size == digit_string::kMaxDigits) {
+      s->exponent += !in_fraction;
+      sticky |= *p != '0';
+    } else {
+      s->digits[s->size++] = *p;
+      s->exponent -= in_fraction;
+    }
+  }
+  if (p < d.last)
+    s->exponent += parse_exponent(p + 1, d.last);
+  if (sticky) {
+    s->digits[s->size++] = '1';
+    s->exponent--;
+  }
+  while (s->size > 0 && s->digits[s->size - 1] == '0') {
+    s->size--;
+    s->exponent++;
+  }
+}
+
+/*
+ * @return: sign of (digits * 10^exponent - halfway point between the
+ *          doubles of bit patterns bits and bits + 1)
+ */
+int compare_halfway(const bigint& digits, int64_t exponent, uint64_t bits) {
+  uint64_t biased = bits >> 52;
+  uint64_t m = bits & kFractionMask;
+  int64_t e = -1074;
+  if (biased != 0) {
+    m |= 1ull << 52;
+    e = static_cast<int64_t>(biased) - 1075;
+  }
+  /// halfway = (2m + 1) * 2^(e - 1), value = digits * 5^exponent * 2^exponent
+  bigint lhs = digits, rhs(2 * m + 1);
+  if (exponent >= 0)
+    lhs.mul_pow5(static_cast<unsigned>(exponent));
+  else
+    rhs.mul_pow5(static_cast<unsigned>(-exponent));
+  int64_t diff = exponent - (e - 1);
+  if (diff > 0)
+    lhs.shift_left(static_cast<unsigned>(diff));
+  else
+    rhs.shift_left(static_cast<unsigned>(-diff));
+  return bigint::compare(lhs, rhs);
+}
+
+/// correctly rounded conversion by comparing with exact halfway points
+double exact_fallback(const decimal& d) {
+  digit_string s;
+  collect_digits(d, &s);
+  if (s.size == 0)
+    return 0.0;
+  // value lies in [10^(size + exponent - 1), 10^(size + exponent))
+  if (s.size + s.exponent > 310)
+    return HUGE_VAL;
+  if (s.size + s.exponent < -324)
+    return 0.0;
+
+  bigint digits;
+  uint64_t approx_mantissa = 0;
+  int approx_digits = 0;
+  for (int i = 0; i < s.size; ++i) {
+    digits.mul_small(10);
+    digits.add_small(static_cast<uint32_t>(s.digits[i] - '0'));
+    if (approx_digits < kMaxMantissaDigits) {
+      approx_mantissa = approx_mantissa * 10 + (s.digits[i] - '0');
+      approx_digits++;
+    }
+  }
+  // start from a guess within a few ulps, then walk to the right double
+  int64_t approx_exponent = s.exponent + (s.size - approx_digits);
+  uint64_t bits;
+  if (!eisel_lemire(approx_mantissa, approx_exponent, &bits)) {
+    long double guess = static_cast<long double>(approx_mantissa) *
+                        std::pow(10.0L, static_cast<long double>(approx_exponent));
+    bits = guess > 1.7976931348623157e308L ? to_bits(1.7976931348623157e308)
+                                           : to_bits(static_cast<double>(guess));
+  }
+  for (;;) {
+    int above = compare_halfway(digits, s.exponent, bits);
+    if (above > 0) {
+      if (++bits == kInfinityBits)
+        return HUGE_VAL;
+      continue;
+    }
+    if (above == 0)
+      return from_bits(bits + (bits & 1));
+    if (bits == 0)
+      return 0.0;
+    int below = compare_halfway(digits, s.exponent, bits - 1);
+    if (below < 0) {
+      bits--;
+      continue;
+    }
+    if (below == 0)
+      return from_bits(bits - (bits & 1));
+    return from_bits(bits);
+  }
+}
+
+}
+
+void truncate_decimal(decimal *d) {
+  const char* p = d->first;
+  if (*p == '-')
+    p++;
+  bool in_fraction = false;
+  int digits = 0;
+  d->mantissa = 0;
+  d->exponent = 0;
+  d->truncated = false;
+  for (; p < d->last && *p != 'e' && *p != 'E'; ++p) {
+    if (*p == '.') {
+      in_fraction = true;
+      continue;
+    }
+    if (digits == 0 && *p == '0') {
+      d->exponent -= in_fraction;
+    } else if (digits == kMaxMantissaDigits) {
+      d->exponent += !in_fraction;
+      d->truncated |= *p != '0';
+    } else {
+      d->mantissa = d->mantissa * 10 + (*p - '0');
+      d->exponent -= in_fraction;
+      digits++;
+    }
+  }
+  if (p < d->last)
+    d->exponent += parse_exponent(p + 1, d->last);
+}
+
+double to_double(const decimal& d) {
+  double value;
+  uint64_t bits;
+  if (d.mantissa == 0 && !d.truncated) {
+    value = 0.0;
+  } else if (!d.truncated && d.mantissa <= (1ull << 53) && d.exponent >= -22 && d.exponent <= 22) {
+    // Clinger: both operands are exact, so is the single rounding
+    value = static_cast<double>(d.mantissa);
+    value = d.exponent < 0 ? value / kExactPow10[-d.exponent] : value * kExactPow10[d.exponent];
+  } else if (!d.truncated) {
+    value = eisel_lemire(d.mantissa, d.exponent, &bits) ? from_bits(bits) : exact_fallback(d);
+  } else {
+    // the dropped digits cannot matter when both bounds round the same way
+    uint64_t upper;
+    if (eisel_lemire(d.mantissa, d.exponent, &bits) && eisel_lemire(d.mantissa + 1, d.exponent, &upper) &&
+        bits == upper)
+      value = from_bits(bits);
+    else
+      value = exact_fallback(d);
+  }
+  return d.negative ? -value : value;
+}
+
+namespace {
+
+/// floor(e * log10(2)), exact for |e| <= 2620
+inline int floor_log10_pow2(int e) {
+  return (e * 1262611) >> 22;
+}
+
+/// floor(e * log10(2) + log10(3/4)), exact for |e| <= 2620
+inline int floor_log10_three_quarters_pow2(int e) {
+  return (e * 1262611 - 524031) >> 22;
+}
+
+/// floor(e * log2(10)), exact for |e| <= 1233
+inline int floor_log2_pow10(int e) {
+  return (e * 1741647) >> 19;
+}
+
+/// 10^e of the table rounded up instead of down, only 10^0 .. 10^55 fit 128 bits exactly
+inline void pow10_ceil(int e, uint64_t *hi, uint64_t *lo) {
+  const pow10_table& table = pow10_128();
+  *hi = table.hi[e - kMinExp10];
+  *lo = table.lo[e - kMinExp10];
+  if (e < 0 || e > 55) {
+    if (++*lo == 0)
+      ++*hi;
+  }
+}
+
+/// the top 64 bits of (hi:lo) * cp, the lowest one set when any of the dropped bits is
+inline uint64_t round_to_odd(uint64_t hi, uint64_t lo, uint64_t cp) {
+  uint64_t x_lo, y_lo;
+  uint64_t x_hi = mul64(lo, cp, &x_lo);
+  uint64_t y_hi = mul64(hi, cp, &y_lo);
+  uint64_t z = y_lo + x_hi;
+  uint64_t vbp = y_hi + (z < y_lo);
+  return vbp | (z > 1);
+}
+
+const char kDigitPairs[] =
+  "0001020304050607080910111213141516171819202122232425262728293031323334353637383940414243444546474849"
+  "5051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+
+int count_digits(uint64_t v) {
+  int n = 1;
+  for (;;) {
+    if (v < 10) return n;
+    if (v < 100) return n + 1;
+    if (v < 1000) return n + 2;
+    if (v < 10000) return n + 3;
+    v /= 10000;
+    n += 4;
+  }
+}
+
+/// the n digits of v, two at a time from the last one
+void write_digits(uint64_t v, int n, char *buf) {
+  char *p = buf + n;
+  while (v >= 100) {
+    unsigned pair = static_cast<unsigned>(v % 100) * 2;
+    v /= 100;
+    p -= 2;
+    p[0] = kDigitPairs[pair];
+    p[1] = kDigitPairs[pair + 1];
+  }
+  if (v >= 10) {
+    p -= 2;
+    p[0] = kDigitPairs[v * 2];
+    p[1] = kDigitPairs[v * 2 + 1];
+  } else {
+    *--p = static_cast<char>('0' + v);
+  }
+}
+
+inline void remove_trailing_zeros(uint64_t *digits, int *exponent) {
+  while (*digits % 10 == 0) {
+    *digits /= 10;
+    ++*exponent;
+  }
+}
+
+} // namespace
+
+/*
+ * the interval of the reals that round to v is scaled by a power of ten so
+ * that its bounds lie around a number of 17 or 18 digits. out of the
+ * integers inside it, one of the multiples of 10 if any is the shortest,
+ * otherwise the one closest to v. the scaled bounds are rounded to odd,
+ * which keeps their comparisons with integers exact.
+ * reference: https://github.com/c4f7fcce9cb06515/Schubfach
+ */
+void shortest(double v, uint64_t *digits, int *exponent) {
+  assert(v > 0 && v < HUGE_VAL);
+  uint64_t bits = to_bits(v);
+  uint64_t fraction = bits & kFractionMask;
+  int biased = static_cast<int>(bits >> 52);
+  uint64_t c = biased != 0 ? fraction | (1ull << 52) : fraction;
+  int q = biased != 0 ? biased - 1075 : -1074;  /* v = c * 2^q */
+
+  // integers below 2^53: v itself is the closest, it is the shortest once its zeros are dropped
+  if (q <= 0 && q > -53 && (c & ((1ull << -q) - 1)) == 0) {
+    *digits = c >> -q;
+    *exponent = 0;
+    remove_trailing_zeros(digits, exponent);
+    return;
+  }
+
+  bool even = (c & 1) == 0;
+  /// at a power of two the gap to the lower neighbour is half the one to the upper
+  bool lower_closer = fraction == 0 && biased > 1;
+  uint64_t cbl = 4 * c - 2 + lower_closer, cb = 4 * c, cbr = 4 * c + 2;
+  int k = lower_closer ? floor_log10_three_quarters_pow2(q) : floor_log10_pow2(q);
+  int h = q + floor_log2_pow10(-k) + 1;  /* in [1, 4] */
+
+  uint64_t g_hi, g_lo;
+  pow10_ceil(-k, &g_hi, &g_lo);
+  uint64_t vbl = round_to_odd(g_hi, g_lo, cbl << h);
+  uint64_t vb = round_to_odd(g_hi, g_lo, cb << h);
+  uint64_t vbr = round_to_odd(g_hi, g_lo, cbr << h);
+  // the bounds belong to the interval when c is even, round half to even reads them back as v
+  uint64_t lower = vbl + !even, upper = vbr - !even;
+
+  uint64_t s = vb >> 2;  /* v * 10^-k, rounded down */
+  *exponent = k;
+  if (s >= 10) {
+    uint64_t sp10 = s / 10 * 10;
+    bool u = lower <= 4 * sp10, w = 4 * sp10 + 40 <= upper;
+    if (u != w) {
+      *digits = u ? sp10 : sp10 + 10;
+      remove_trailing_zeros(digits, exponent);
+      return;
+    }
+  }
+  bool u = lower <= 4 * s, w = 4 * s + 4 <= upper;
+  if (u != w) {
+    *digits = u ? s : s + 1;
+  } else {
+    uint64_t mid = 4 * s + 2;
+    *digits = vb > mid || (vb == mid && (s & 1) != 0) ? s + 1 : s;
+  }
+  remove_trailing_zeros(digits, exponent);
+}
+
+char* write_double(double v, char *buf) {
+  if (std::signbit(v)) {
+    *buf++ = '-';
+    v = -v;
+  }
+  if (v == 0) {
+    memcpy(buf, "0.0", 3);
+    return buf + 3;
+  }
+  uint64_t digits;
+  int exponent;
+  shortest(v, &digits, &exponent);
+  int n = count_digits(digits);
+  int point = n + exponent;  /* v = 0.d1d2...dn * 10^point */
+
+  if (exponent >= 0 && point <= 21) {
+    // 1234e5 -> 123400000.0
+    write_digits(digits, n, buf);
+    memset(buf + n, '0', exponent);
+    memcpy(buf + point, ".0", 2);
+    return buf + point + 2;
+  }
+  if (point > 0 && point <= 21) {
+    // 1234e-2 -> 12.34
+    write_digits(digits, n, buf + 1);
+    memmove(buf, buf + 1, point);
+    buf[point] = '.';
+    return buf + n + 1;
+  }
+  if (point > -6 && point <= 0) {
+    // 1234e-6 -> 0.001234
+    memcpy(buf, "0.", 2);
+    memset(buf + 2, '0', -point);
+    write_digits(digits, n, buf + 2 - point);
+    return buf + 2 - point + n;
+  }
+  // 1234e30 -> 1.234e+33
+  write_digits(digits, n, buf + 1);
+  buf[0] = buf[1];
+  char *p = buf + 1;
+  if (n > 1) {
+    *p = '.';
+    p += n;
+  }
+  *p++ = 'e';
+  int e = point - 1;
+  *p++ = e < 0 ? '-' : '+';
+  if (e < 0)
+    e = -e;
+  return write_uint64(static_cast<uint64_t>(e), p);
+}
+
+char* write_uint64(uint64_t v, char *buf) {
+  int n = count_digits(v);
+  write_digits(v, n, buf);
+  return buf + n;
+}
+
+char* write_int64(int64_t v, char *buf) {
+  uint64_t u = static_cast<uint64_t>(v);
+  if (v < 0) {
+    *buf++ = '-';
+    u = 0 - u;
+  }
+  return write_uint64(u, buf);
+}
+
+} // namespace conv
+
+} // namespace ljson
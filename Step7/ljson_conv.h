@@ -0,0 +1,78 @@
+#ifndef LJSON_LJSON_CONV_H_
+#define LJSON_LJSON_CONV_H_
+
+/*
+ * number <-> text conversions used by the parser and the generator, internal
+ * header.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ljson {
+
+namespace conv {
+
+/*
+ * a number split by the parser while it checks the grammar.
+ * value = mantissa * 10^exponent when not truncated, otherwise mantissa holds
+ * the first 19 significant digits and the dropped ones are only in the text.
+ */
+struct decimal {
+  uint64_t mantissa;
+  int64_t exponent;
+  bool negative;
+  bool truncated;
+  const char* first;  /* number text, needed by the exact fallback */
+  const char* last;
+};
+
+/// maximum number of significant digits held exactly in decimal::mantissa
+const int kMaxMantissaDigits = 19;
+
+/*
+ * @return: the correctly rounded double (round half to even), +-HUGE_VAL
+ *          when the magnitude is too big for a double
+ */
+double to_double(const decimal& d);
+
+/*
+ * recompute mantissa and exponent of a number with more than 19 significant
+ * digits from its text, sets d->truncated
+ */
+void truncate_decimal(decimal* d);
+
+/// longest text of write_double(): sign, "0.", 5 zeros and 17 digits
+const int kMaxDoubleLength = 25;
+
+/// longest text of write_int64() and write_uint64()
+const int kMaxIntegerLength = 20;
+
+/*
+ * the shortest digits that read back as v, the closest to v when there are
+ * several (Schubfach, by Raffaello Giulietti).
+ * @v: finite and greater than zero
+ * @return: v ~ *digits * 10^*exponent, *digits has no trailing zeros
+ */
+void shortest(double v, uint64_t* digits, int* exponent);
+
+/*
+ * write v in its shortest form: fixed notation for exponents in [-6, 21)
+ * and an exponent part "e+N" / "e-N" otherwise, like javascript. integral
+ * values in fixed notation end with ".0" so that they read back as a
+ * double and not as an integer.
+ * @v: finite
+ * @return: the end of the text, at most kMaxDoubleLength bytes, not
+ *          null-terminated
+ */
+char* write_double(double v, char* buf);
+
+/// @return: the end of the text, at most kMaxIntegerLength bytes, not null-terminated
+char* write_uint64(uint64_t v, char* buf);
+char* write_int64(int64_t v, char* buf);
+
+} // namespace conv
+
+} // namespace ljson
+
+#endif //LJSON_LJSON_CONV_H_
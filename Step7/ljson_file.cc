@@ -0,0 +1,108 @@
+#include "ljson_file.h"
+#include <cerrno>
+#include <cstring> // memcpy()
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define LJSON_HAVE_MMAP 1
+#endif
+
+namespace ljson {
+
+std::shared_ptr<ljson_mapped_file> ljson_mapped_file::read(FILE* stream) {
+  std::string content;
+  char chunk[1 << 16];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), stream)) != 0)
+    content.append(chunk, n);
+  if (ferror(stream)) {
+    int error = errno;
+    fclose(stream);
+    errno = error;
+    return nullptr;
+  }
+  fclose(stream);
+  std::shared_ptr<ljson_mapped_file> file(new ljson_mapped_file());
+  file->buffer_.reset(new char[content.size() + LJSON_PADDING]());
+  memcpy(file->buffer_.get(), content.data(), content.size());
+  file->data_ = file->buffer_.get();
+  file->size_ = content.size();
+  file->padded_ = true;
+  return file;
+}
+
+#if defined(LJSON_HAVE_MMAP)
+
+std::shared_ptr<ljson_mapped_file> ljson_mapped_file::open(const char* path) {
+  int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return nullptr;
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    int error = errno;
+    close(fd);
+    errno = error;
+    return nullptr;
+  }
+  if (!S_ISREG(st.st_mode)) {
+    FILE* stream = fdopen(fd, "rb");
+    if (stream == nullptr) {
+      int error = errno;
+      close(fd);
+      errno = error;
+      return nullptr;
+    }
+    return read(stream);
+  }
+  std::shared_ptr<ljson_mapped_file> file(new ljson_mapped_file());
+  auto size = static_cast<size_t>(st.st_size);
+  if (size == 0) {
+    /// mmap() refuses an empty length
+    close(fd);
+    return file;
+  }
+  void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  int error = errno;
+  /// the mapping keeps the file open by itself
+  close(fd);
+  if (p == MAP_FAILED) {
+    errno = error;
+    return nullptr;
+  }
+  /// hints only, a kernel ignoring them still gives the same bytes
+  madvise(p, size, MADV_SEQUENTIAL);
+  madvise(p, size, MADV_WILLNEED);
+#if defined(MADV_HUGEPAGE)
+  madvise(p, size, MADV_HUGEPAGE);
+#endif
+  file->data_ = static_cast<const char*>(p);
+  file->size_ = size;
+  file->mapped_ = true;
+  // the end of the last page past the file reads as zeros
+  auto page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  size_t tail = size % page;
+  file->padded_ = tail != 0 && page - tail >= LJSON_PADDING;
+  return file;
+}
+
+ljson_mapped_file::~ljson_mapped_file() {
+  if (mapped_)
+    munmap(const_cast<char*>(data_), size_);
+}
+
+#else
+
+std::shared_ptr<ljson_mapped_file> ljson_mapped_file::open(const char* path) {
+  FILE* stream = fopen(path, "rb");
+  return stream != nullptr ? read(stream) : nullptr;
+}
+
+ljson_mapped_file::~ljson_mapped_file() = default;
+
+#endif
+
+} // namespace ljson
@@ -0,0 +1,51 @@
+#ifndef LJSON_LJSON_FILE_H_
+#define LJSON_LJSON_FILE_H_
+
+#include "ljson.h"
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+
+namespace ljson {
+
+/*
+ * ljson_mapped_file: a whole file mapped read-only with mmap(), advised for
+ * one sequential pass, and unmapped when the last owner goes away. the
+ * parse_file() entry points read through it, it can be used on its own
+ * with any parse(data, len) function, ljson_sax or ljson_ondemand_document.
+ * where mmap() is missing the file is read into a buffer instead.
+ */
+class ljson_mapped_file {
+public:
+  /// @return: nullptr with errno set when path cannot be opened, read or mapped
+  static std::shared_ptr<ljson_mapped_file> open(const char* path);
+
+  ~ljson_mapped_file();
+
+  ljson_mapped_file(const ljson_mapped_file&) = delete;
+  ljson_mapped_file& operator=(const ljson_mapped_file&) = delete;
+
+  const char* data() const { return data_; }
+
+  size_t size() const { return size_; }
+
+  /// LJSON_PADDING readable bytes follow data() + size(), parse_padded() applies
+  bool padded() const { return padded_; }
+
+private:
+  ljson_mapped_file() : data_(""), size_(0), padded_(false), mapped_(false) {}
+
+  /// read a file that cannot be mapped, like a pipe, into buffer_
+  static std::shared_ptr<ljson_mapped_file> read(FILE* stream);
+
+  const char* data_;
+  size_t size_;
+  bool padded_;
+  /// data_ is a mapping, otherwise it is buffer_ or an empty string
+  bool mapped_;
+  std::unique_ptr<char[]> buffer_;
+};
+
+} // namespace ljson
+
+#endif //LJSON_LJSON_FILE_H_
@@ -0,0 +1,623 @@
+#include "ljson_generator.h"
+#include "ljson_conv.h"
+#include "ljson_simd.h"
+#include <cassert> // assert()
+#include <cerrno>
+#include <cmath>   // std::isfinite()
+#include <climits> // IOV_MAX
+#include <new>     // std::bad_alloc
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/uio.h>
+#include <unistd.h>
+#define LJSON_HAVE_WRITEV 1
+#endif
+
+#ifndef LJSON_STRINGIFY_INIT_SIZE
+#define LJSON_STRINGIFY_INIT_SIZE 256
+#endif
+
+#ifndef LJSON_WRITER_FLUSH_SIZE
+#define LJSON_WRITER_FLUSH_SIZE 4096
+#endif
+
+/// shorter runs of string bytes are copied, an iovec costs about as much
+#ifndef LJSON_GATHER_MIN_SIZE
+#define LJSON_GATHER_MIN_SIZE 512
+#endif
+
+#ifndef LJSON_GATHER_FLUSH_SIZE
+#define LJSON_GATHER_FLUSH_SIZE (1 << 16)
+#endif
+
+namespace ljson {
+
+void ljson_buffer::grow(size_t n) {
+  size_t capacity = capacity_ != 0 ? capacity_ : LJSON_STRINGIFY_INIT_SIZE;
+  while (capacity - size_ < n)
+    capacity += capacity >> 1; /* capacity * 1.5 */
+  auto data = static_cast<char*>(realloc(data_, capacity));
+  if (data == nullptr)
+    throw std::bad_alloc();
+  data_ = data;
+  capacity_ = capacity;
+}
+
+namespace {
+
+/// how each byte is written in a string: 0 as it is, 'u' as \u00XX, otherwise '\\' and this letter
+const char kEscape[256] = {
+  'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'b', 't', 'n', 'u', 'f', 'r', 'u', 'u',  /* 0x00 */
+  'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',  /* 0x10 */
+  0, 0, '"', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,                                /* 0x20 */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,                                  /* 0x30 */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,                                  /* 0x40 */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, '\\', 0, 0, 0,                               /* 0x50 */
+};
+
+inline char escape_of(char ch) {
+  return kEscape[static_cast<unsigned char>(ch)];
+}
+
+/// @return: the end of the 2 or 6 bytes written
+inline char* write_escape(char ch, char* w) {
+  static const char hex[] = "0123456789ABCDEF";
+  char escape = escape_of(ch);
+  w[0] = '\\';
+  if (escape != 'u') {
+    w[1] = escape;
+    return w + 2;
+  }
+  memcpy(w + 1, "u00", 3);
+  w[4] = hex[static_cast<unsigned char>(ch) >> 4];
+  w[5] = hex[ch & 0xF];
+  return w + 6;
+}
+
+/*
+ * clean runs are found a block at a time by simd::scan_string() and copied
+ * as they are, only the bytes it stops at go through the table. room for
+ * the string as it is and its quotes is reserved up front, each escape
+ * reserves again for its own bytes and what is left.
+ */
+void write_string(const char* str, size_t len, ljson_buffer* out) {
+  const char* end = str + len;
+  char* begin = out->reserve(len + 2);
+  char* w = begin;
+  *w++ = '"';
+  for (const char* p = str;;) {
+    const char* special = simd::scan_string(p, end);
+    memcpy(w, p, static_cast<size_t>(special - p));
+    w += special - p;
+    if (special == end)
+      break;
+    // escapes often come in a row, \r\n for one
+    for (p = special; p != end && escape_of(*p) != 0; ++p) {
+      out->commit(static_cast<size_t>(w - begin));
+      begin = w = out->reserve(static_cast<size_t>(end - p) + 6);
+      w = write_escape(*p, w);
+    }
+  }
+  *w++ = '"';
+  out->commit(static_cast<size_t>(w - begin));
+}
+
+void write_number(const ljson_number_value& number, ljson_buffer* out) {
+  char* w = out->reserve(conv::kMaxDoubleLength);
+  char* end;
+  switch (number.type) {
+    case LJSON_NUMBER_INT64: end = conv::write_int64(number.int64, w); break;
+    case LJSON_NUMBER_UINT64: end = conv::write_uint64(number.uint64, w); break;
+    default:
+      if (!std::isfinite(number.number)) {
+        memcpy(w, "null", 4);
+        end = w + 4;
+      } else {
+        end = conv::write_double(number.number, w);
+      }
+  }
+  out->commit(static_cast<size_t>(end - w));
+}
+
+#if defined(LJSON_HAVE_WRITEV)
+
+/*
+ * output of ljson_generator::write(): runs of string bytes of at least
+ * LJSON_GATHER_MIN_SIZE are referenced where the document holds them, the
+ * rest is generated into scratch. the segments go to writev() once there
+ * are IOV_MAX of them or scratch holds LJSON_GATHER_FLUSH_SIZE bytes.
+ * segments in scratch are kept as offsets, it moves when it grows.
+ */
+class gather_output {
+public:
+  explicit gather_output(int fd) : fd_(fd), mark_(0), error_(0) {}
+
+  ljson_buffer* scratch() { return &scratch_; }
+
+  void put(char ch) {
+    if (scratch_.size() >= LJSON_GATHER_FLUSH_SIZE)
+      flush();
+    scratch_.put(ch);
+  }
+
+  void append(const char* p, size_t n) { scratch_.append(p, n); }
+
+  /// bytes that stay valid until flush()
+  void reference(const char* p, size_t n) {
+    if (n < LJSON_GATHER_MIN_SIZE) {
+      scratch_.append(p, n);
+      return;
+    }
+    close_scratch();
+    segments_.push_back(segment{p, 0, n});
+    if (segments_.size() + 1 >= kMaxSegments)
+      flush();
+  }
+
+  /// @return: false when a write has failed, errno set
+  bool flush() {
+    close_scratch();
+    iovecs_.clear();
+    for (const segment& s : segments_) {
+      iovec iov;
+      iov.iov_base = const_cast<char*>(s.data != nullptr ? s.data : scratch_.data() + s.offset);
+      iov.iov_len = s.size;
+      iovecs_.push_back(iov);
+    }
+    for (iovec* iov = iovecs_.data(), *end = iov + iovecs_.size(); iov != end && error_ == 0;) {
+      ssize_t n = ::writev(fd_, iov, static_cast<int>(end - iov));
+      if (n < 0) {
+        if (errno != EINTR)
+          error_ = errno;
+        continue;
+      }
+      // a partial write stops anywhere, even in the middle of a segment
+      auto left = static_cast<size_t>(n);
+      while (iov != end && left >= iov->iov_len)
+        left -= iov++->iov_len;
+      if (iov != end) {
+        iov->iov_base = static_cast<char*>(iov->iov_base) + left;
+        iov->iov_len -= left;
+      }
+    }
+    segments_.clear();
+    scratch_.clear();
+    mark_ = 0;
+    if (error_ != 0)
+      errno = error_;
+    return error_ == 0;
+  }
+
+private:
+#ifdef IOV_MAX
+  static const size_t kMaxSegments = IOV_MAX;
+#else
+  static const size_t kMaxSegments = 1024;
+#endif
+
+  struct segment {
+    /// nullptr for the bytes of scratch from offset on
+    const char* data;
+    size_t offset;
+    size_t size;
+  };
+
+  /// the scratch bytes written since the last segment become one
+  void close_scratch() {
+    if (scratch_.size() != mark_)
+      segments_.push_back(segment{nullptr, mark_, scratch_.size() - mark_});
+    mark_ = scratch_.size();
+  }
+
+  int fd_;
+  ljson_buffer scratch_;
+  size_t mark_;
+  std::vector<segment> segments_;
+  std::vector<iovec> iovecs_;
+  int error_;
+};
+
+/// write_string() with the clean runs referenced instead of copied
+void write_string(const char* str, size_t len, gather_output* out) {
+  if (len < LJSON_GATHER_MIN_SIZE) {
+    write_string(str, len, out->scratch());
+    return;
+  }
+  const char* end = str + len;
+  out->put('"');
+  for (const char* p = str;;) {
+    const char* special = simd::scan_string(p, end);
+    out->reference(p, static_cast<size_t>(special - p));
+    if (special == end)
+      break;
+    for (p = special; p != end && escape_of(*p) != 0; ++p) {
+      char* w = out->scratch()->reserve(6);
+      out->scratch()->commit(static_cast<size_t>(write_escape(*p, w) - w));
+    }
+  }
+  out->put('"');
+}
+
+void write_number(const ljson_number_value& number, gather_output* out) {
+  write_number(number, out->scratch());
+}
+
+#endif
+
+ljson_number_value number_of(const ljson_number& v) {
+  ljson_number_value number;
+  number.type = v.get_number_type();
+  switch (number.type) {
+    case LJSON_NUMBER_INT64: number.int64 = v.get_int64(); break;
+    case LJSON_NUMBER_UINT64: number.uint64 = v.get_uint64(); break;
+    default: number.number = v.get_double(); break;
+  }
+  return number;
+}
+
+ljson_number_value number_of(const ljson_compact_value& v) {
+  ljson_number_value number;
+  number.type = v.get_number_type();
+  switch (number.type) {
+    case LJSON_NUMBER_INT64: number.int64 = v.get_int64(); break;
+    case LJSON_NUMBER_UINT64: number.uint64 = v.get_uint64(); break;
+    default: number.number = v.get_number(); break;
+  }
+  return number;
+}
+
+/*
+ * a scalar, or the opening bracket of a container.
+ * @return: whether a container was opened, its children come next
+ */
+template<typename Output>
+bool write_open(const ljson_value& v, Output* out) {
+  switch (v.get_type()) {
+    case LJSON_NULL: out->append("null", 4); return false;
+    case LJSON_TRUE: out->append("true", 4); return false;
+    case LJSON_FALSE: out->append("false", 5); return false;
+    case LJSON_NUMBER: write_number(number_of(static_cast<const ljson_number&>(v)), out); return false;
+    case LJSON_STRING: write_string(v.as_string(), v.size(), out); return false;
+    case LJSON_ARRAY: out->put('['); return true;
+    case LJSON_OBJECT: out->put('{'); return true;
+  }
+  return false;
+}
+
+template<typename Output>
+bool write_open(const ljson_compact_value& v, Output* out) {
+  switch (v.get_type()) {
+    case LJSON_NULL: out->append("null", 4); return false;
+    case LJSON_TRUE: out->append("true", 4); return false;
+    case LJSON_FALSE: out->append("false", 5); return false;
+    case LJSON_NUMBER: write_number(number_of(v), out); return false;
+    case LJSON_STRING: write_string(v.get_string(), v.get_string_length(), out); return false;
+    case LJSON_ARRAY: out->put('['); return true;
+    case LJSON_OBJECT: out->put('{'); return true;
+  }
+  return false;
+}
+
+/// @return: the index-th child of a container, the key of a member is written before it
+template<typename Output>
+const ljson_value& write_child(const ljson_value& container, size_t index, Output* out) {
+  if (container.get_type() == LJSON_ARRAY)
+    return container.as_array()[index];
+  const ljson_objects::entry& m = container.as_object()[index];
+  write_string(m.key, m.key_size, out);
+  out->put(':');
+  return *m.value;
+}
+
+template<typename Output>
+const ljson_compact_value& write_child(const ljson_compact_value& container, size_t index, Output* out) {
+  if (container.get_type() == LJSON_ARRAY)
+    return container[index];
+  const ljson_compact_member& m = container.get_member(index);
+  write_string(m.key.get_string(), m.key.get_string_length(), out);
+  out->put(':');
+  return m.value;
+}
+
+/*
+ * the open containers with the index of their next child, the first levels
+ * are kept inline so that shallow documents do not allocate.
+ */
+template<typename Value>
+class frame_stack {
+public:
+  struct frame {
+    const Value* container;
+    size_t next;
+  };
+
+  frame_stack() : size_(0) {}
+
+  bool empty() const { return size_ == 0; }
+
+  frame& top() { return size_ <= kInline ? inline_[size_ - 1] : more_.back(); }
+
+  void push(const Value* container) {
+    if (size_ < kInline)
+      inline_[size_] = frame{container, 0};
+    else
+      more_.push_back(frame{container, 0});
+    size_++;
+  }
+
+  void pop() {
+    if (size_ > kInline)
+      more_.pop_back();
+    size_--;
+  }
+
+private:
+  static const size_t kInline = 32;
+
+  frame inline_[kInline];
+  std::vector<frame> more_;
+  size_t size_;
+};
+
+/// iterative, any depth is fine: documents built with create() have no max_depth
+template<typename Value, typename Output>
+void write_value(const Value& v, Output* out) {
+  if (!write_open(v, out))
+    return;
+  frame_stack<Value> frames;
+  frames.push(&v);
+  while (!frames.empty()) {
+    auto& top = frames.top();
+    const Value& container = *top.container;
+    if (top.next == container.size()) {
+      out->put(container.get_type() == LJSON_ARRAY ? ']' : '}');
+      frames.pop();
+      continue;
+    }
+    if (top.next != 0)
+      out->put(',');
+    const Value& child = write_child(container, top.next++, out);
+    if (write_open(child, out))
+      frames.push(&child);
+  }
+}
+
+}
+
+void ljson_generator::stringify(const ljson_value& value, ljson_buffer* out) {
+  write_value(value, out);
+}
+
+std::string ljson_generator::stringify(const ljson_value& value) {
+  ljson_buffer out;
+  write_value(value, &out);
+  return out.str();
+}
+
+void ljson_generator::stringify(const ljson_compact_value& value, ljson_buffer* out) {
+  write_value(value, out);
+}
+
+std::string ljson_generator::stringify(const ljson_compact_value& value) {
+  ljson_buffer out;
+  write_value(value, &out);
+  return out.str();
+}
+
+#if defined(LJSON_HAVE_WRITEV)
+
+bool ljson_generator::write(const ljson_value& value, int fd) {
+  gather_output out(fd);
+  write_value(value, &out);
+  return out.flush();
+}
+
+bool ljson_generator::write(const ljson_compact_value& value, int fd) {
+  gather_output out(fd);
+  write_value(value, &out);
+  return out.flush();
+}
+
+#else
+
+/// no file descriptors to write to
+bool ljson_generator::write(const ljson_value&, int) {
+  errno = ENOSYS;
+  return false;
+}
+
+bool ljson_generator::write(const ljson_compact_value&, int) {
+  errno = ENOSYS;
+  return false;
+}
+
+#endif
+
+ljson_writer::ljson_writer(ljson_buffer* out)
+    : sink_(SINK_BUFFER), out_(out), fd_(-1), error_(0), need_comma_(false), has_key_(false), done_(false) {}
+
+ljson_writer::ljson_writer(int fd)
+    : sink_(SINK_FD), out_(&staging_), fd_(fd), error_(0), need_comma_(false), has_key_(false), done_(false) {}
+
+ljson_writer::ljson_writer(callback fn)
+    : sink_(SINK_CALLBACK), out_(&staging_), fd_(-1), fn_(std::move(fn)), error_(0), need_comma_(false),
+      has_key_(false), done_(false) {}
+
+ljson_writer::~ljson_writer() {
+  flush();
+}
+
+/*
+ * the order of the events is checked on the way: a value goes at the top
+ * level once, in an array, or in an object after its key.
+ */
+void ljson_writer::begin_value() {
+#ifndef NDEBUG
+  assert(!done_ && "one value per document, reset() starts the next one");
+  assert((nesting_.empty() || nesting_.back() == '[' || has_key_) && "a value in an object needs a key first");
+  has_key_ = false;
+#endif
+  if (need_comma_)
+    out_->put(',');
+}
+
+void ljson_writer::end_value() {
+#ifndef NDEBUG
+  done_ = nesting_.empty();
+#endif
+  need_comma_ = true;
+  if (sink_ != SINK_BUFFER && staging_.size() >= LJSON_WRITER_FLUSH_SIZE)
+    flush();
+}
+
+void ljson_writer::start_object() {
+  begin_value();
+  out_->put('{');
+  need_comma_ = false;
+#ifndef NDEBUG
+  nesting_.push_back('{');
+#endif
+}
+
+void ljson_writer::end_object() {
+#ifndef NDEBUG
+  assert(!nesting_.empty() && nesting_.back() == '{' && "end_object() without start_object()");
+  assert(!has_key_ && "a key without its value");
+  nesting_.pop_back();
+#endif
+  out_->put('}');
+  end_value();
+}
+
+void ljson_writer::start_array() {
+  begin_value();
+  out_->put('[');
+  need_comma_ = false;
+#ifndef NDEBUG
+  nesting_.push_back('[');
+#endif
+}
+
+void ljson_writer::end_array() {
+#ifndef NDEBUG
+  assert(!nesting_.empty() && nesting_.back() == '[' && "end_array() without start_array()");
+  nesting_.pop_back();
+#endif
+  out_->put(']');
+  end_value();
+}
+
+void ljson_writer::key(const char* str, size_t len) {
+#ifndef NDEBUG
+  assert(!nesting_.empty() && nesting_.back() == '{' && "a key outside of an object");
+  assert(!has_key_ && "two keys in a row");
+  has_key_ = true;
+#endif
+  if (need_comma_)
+    out_->put(',');
+  write_string(str, len, out_);
+  out_->put(':');
+  need_comma_ = false;
+}
+
+void ljson_writer::null() {
+  begin_value();
+  out_->append("null", 4);
+  end_value();
+}
+
+void ljson_writer::boolean(bool b) {
+  begin_value();
+  if (b)
+    out_->append("true", 4);
+  else
+    out_->append("false", 5);
+  end_value();
+}
+
+void ljson_writer::number(double d) {
+  ljson_number_value number;
+  number.type = LJSON_NUMBER_DOUBLE;
+  number.number = d;
+  this->number(number);
+}
+
+void ljson_writer::number(int64_t i) {
+  ljson_number_value number;
+  number.type = LJSON_NUMBER_INT64;
+  number.int64 = i;
+  this->number(number);
+}
+
+void ljson_writer::number(uint64_t u) {
+  ljson_number_value number;
+  number.type = LJSON_NUMBER_UINT64;
+  number.uint64 = u;
+  this->number(number);
+}
+
+void ljson_writer::number(const ljson_number_value& number) {
+  begin_value();
+  write_number(number, out_);
+  end_value();
+}
+
+void ljson_writer::string(const char* str, size_t len) {
+  begin_value();
+  write_string(str, len, out_);
+  end_value();
+}
+
+void ljson_writer::value(const ljson_value& value) {
+  begin_value();
+  write_value(value, out_);
+  end_value();
+}
+
+void ljson_writer::value(const ljson_compact_value& value) {
+  begin_value();
+  write_value(value, out_);
+  end_value();
+}
+
+void ljson_writer::write_out(const char* data, size_t len) {
+  if (sink_ == SINK_CALLBACK) {
+    fn_(data, len);
+    return;
+  }
+#if defined(LJSON_HAVE_WRITEV)
+  while (len != 0 && error_ == 0) {
+    ssize_t n = ::write(fd_, data, len);
+    if (n < 0) {
+      if (errno != EINTR)
+        error_ = errno;
+      continue;
+    }
+    data += n;
+    len -= static_cast<size_t>(n);
+  }
+#else
+  error_ = ENOSYS;
+#endif
+}
+
+bool ljson_writer::flush() {
+  if (sink_ != SINK_BUFFER && staging_.size() != 0) {
+    write_out(staging_.data(), staging_.size());
+    staging_.clear();
+  }
+  if (error_ != 0)
+    errno = error_;
+  return error_ == 0;
+}
+
+void ljson_writer::reset() {
+  need_comma_ = false;
+#ifndef NDEBUG
+  nesting_.clear();
+  has_key_ = false;
+  done_ = false;
+#endif
+}
+
+} // namespace ljson
@@ -0,0 +1,193 @@
+#ifndef LJSON_LJSON_GENERATOR_H_
+#define LJSON_LJSON_GENERATOR_H_
+
+#include "ljson.h"
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace ljson {
+
+/*
+ * ljson_buffer: growable output bytes. it grows by half its size like the
+ * stack of ljson_context::push(), clear() keeps the capacity so a buffer
+ * reused for every document stops allocating once it is large enough.
+ */
+class ljson_buffer {
+public:
+  ljson_buffer() : data_(nullptr), size_(0), capacity_(0) {}
+  ~ljson_buffer() { free(data_); }
+
+  ljson_buffer(const ljson_buffer&) = delete;
+  ljson_buffer& operator=(const ljson_buffer&) = delete;
+
+  /// not null-terminated
+  const char* data() const { return data_; }
+
+  size_t size() const { return size_; }
+
+  size_t capacity() const { return capacity_; }
+
+  std::string str() const { return std::string(data_ != nullptr ? data_ : "", size_); }
+
+  void clear() { size_ = 0; }
+
+  /// room for n more bytes, @return: where they go, commit() the ones written
+  char* reserve(size_t n) {
+    if (capacity_ - size_ < n)
+      grow(n);
+    return data_ + size_;
+  }
+
+  void commit(size_t n) { size_ += n; }
+
+  void append(const char* p, size_t n) {
+    if (n == 0)
+      return;
+    memcpy(reserve(n), p, n);
+    size_ += n;
+  }
+
+  void put(char ch) {
+    *reserve(1) = ch;
+    size_++;
+  }
+
+private:
+  void grow(size_t n);
+
+  char* data_;
+  size_t size_, capacity_;
+};
+
+/*
+ * ljson_generator: write a document back as json text, without any
+ * whitespace. strings are escaped with the short forms \" \\ \b \f \n \r
+ * \t and \u00XX for the other control characters, every other byte is
+ * copied as it is. doubles are written with the fewest digits that read
+ * back as the same value and keep a fraction or an exponent part, 100.0
+ * is "100.0" and not the integer "100". numbers that are not finite have
+ * no json form, they are written as null.
+ */
+struct ljson_generator {
+  /// appends to out
+  static void stringify(const ljson_value& value, ljson_buffer* out);
+  static std::string stringify(const ljson_value& value);
+
+  static void stringify(const ljson_compact_value& value, ljson_buffer* out);
+  static std::string stringify(const ljson_compact_value& value);
+
+  /*
+   * write to a file descriptor with writev(), without copying long strings:
+   * runs of string and key bytes of at least LJSON_GATHER_MIN_SIZE go out
+   * from where the document holds them, between the generated segments.
+   * @return: false when a write fails, errno set, ENOSYS where there is
+   *          no writev()
+   */
+  static bool write(const ljson_value& value, int fd);
+  static bool write(const ljson_compact_value& value, int fd);
+};
+
+/*
+ * ljson_writer: write json as a stream of events, without building a
+ * document, in the form of ljson_generator. the events are those of an
+ * ljson_sax handler:
+ *
+ *   writer.start_object();
+ *   writer.key("id");
+ *   writer.number(42);
+ *   writer.key("tags");
+ *   writer.start_array();
+ *   writer.string("a");
+ *   writer.end_array();
+ *   writer.end_object();
+ *
+ * commas and colons are added by the writer. the output goes to a sink:
+ * - an ljson_buffer, appended to as the events come;
+ * - a file descriptor or a callback, through a staging buffer of the writer
+ *   handed over once it holds LJSON_WRITER_FLUSH_SIZE bytes, and on flush().
+ * nothing is allocated per event: a reused ljson_buffer, or the staging
+ * buffer of a reused writer, stops growing once large enough.
+ * the order of the events is checked with assert() in debug builds only, a
+ * release build writes whatever it is told.
+ */
+class ljson_writer {
+public:
+  typedef std::function<void(const char* data, size_t len)> callback;
+
+  explicit ljson_writer(ljson_buffer* out);
+  /// the fd is not closed
+  explicit ljson_writer(int fd);
+  explicit ljson_writer(callback fn);
+  /// flushes, errors are lost, call flush() first to see them
+  ~ljson_writer();
+
+  ljson_writer(const ljson_writer&) = delete;
+  ljson_writer& operator=(const ljson_writer&) = delete;
+
+  void start_object();
+  void end_object();
+  void start_array();
+  void end_array();
+
+  void key(const char* str, size_t len);
+  void key(const char* str) { key(str, strlen(str)); }
+  void key(const std::string& str) { key(str.data(), str.size()); }
+
+  void null();
+  void boolean(bool b);
+  void number(double d);
+  void number(int64_t i);
+  void number(uint64_t u);
+  void number(int i) { number(static_cast<int64_t>(i)); }
+  void number(unsigned u) { number(static_cast<uint64_t>(u)); }
+  void number(const ljson_number_value& number);
+  void string(const char* str, size_t len);
+  void string(const char* str) { string(str, strlen(str)); }
+  void string(const std::string& str) { string(str.data(), str.size()); }
+
+  /// a whole document as one value
+  void value(const ljson_value& value);
+  void value(const ljson_compact_value& value);
+
+  /*
+   * hand the staged bytes to the file descriptor or the callback, nothing to
+   * do for an ljson_buffer.
+   * @return: false when a write to the file descriptor has failed, errno set,
+   *          the bytes of the failed write and the ones after it are dropped
+   */
+  bool flush();
+
+  /// false once a write to the file descriptor has failed
+  bool ok() const { return error_ == 0; }
+
+  /// the next value starts a new document, written right after the last one
+  void reset();
+
+private:
+  enum sink { SINK_BUFFER, SINK_FD, SINK_CALLBACK };
+
+  void begin_value();
+  void end_value();
+  void write_out(const char* data, size_t len);
+
+  sink sink_;
+  ljson_buffer* out_;
+  ljson_buffer staging_;
+  int fd_;
+  callback fn_;
+  int error_;
+  /// a value has been written at this level, the next one is after a comma
+  bool need_comma_;
+  /// debug builds only: the open containers, '{' or '[', and where a value may go
+  std::vector<char> nesting_;
+  bool has_key_;
+  bool done_;
+};
+
+} // namespace ljson
+
+#endif //LJSON_LJSON_GENERATOR_H_
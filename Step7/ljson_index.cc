@@ -0,0 +1,47 @@
+#include "ljson_index.h"
+#include "ljson_simd.h"
+#include <cstring> // memcpy()
+
+namespace ljson {
+
+void ljson_structural_index::build(const char* json, size_t len) {
+  if (capacity_ < len + 1) {
+    positions_.reset(new uint32_t[len + 1]);
+    capacity_ = len + 1;
+  }
+  uint32_t* out = positions_.get();
+  uint64_t escaped_carry = 0;
+  uint64_t in_string_carry = 0;  /* all ones inside a string */
+  uint64_t scalar_carry = 0;
+  char tail[64];
+  for (size_t offset = 0; offset < len; offset += 64) {
+    const char* p = json + offset;
+    if (len - offset < 64) {
+      // the last stretch is completed with whitespace
+      memset(tail, ' ', sizeof(tail));
+      memcpy(tail, p, len - offset);
+      p = tail;
+    }
+    simd::masks64 m = simd::classify64(p);
+    uint64_t quote = m.quote & ~simd::find_escaped(m.backslash, &escaped_carry);
+    // set from an opening quote up to the byte before the closing one
+    uint64_t in_string = simd::prefix_xor(quote) ^ in_string_carry;
+    in_string_carry = static_cast<uint64_t>(static_cast<int64_t>(in_string) >> 63);
+    // a string, number or literal starts at a byte that is no operator or
+    // whitespace and does not follow such a byte, a quote ends a string
+    uint64_t scalar = ~(m.op | m.whitespace);
+    uint64_t nonquote_scalar = scalar & ~quote;
+    uint64_t follows_scalar = nonquote_scalar << 1 | scalar_carry;
+    scalar_carry = nonquote_scalar >> 63;
+    // string contents and closing quotes are not structural
+    uint64_t structurals = (m.op | (scalar & ~follows_scalar)) & ~(in_string ^ quote);
+    while (structurals != 0) {
+      *out++ = static_cast<uint32_t>(offset + __builtin_ctzll(structurals));
+      structurals &= structurals - 1;
+    }
+  }
+  size_ = out - positions_.get();
+  *out = static_cast<uint32_t>(len);
+}
+
+} // namespace ljson
@@ -0,0 +1,194 @@
+#ifndef LJSON_LJSON_INDEX_H_
+#define LJSON_LJSON_INDEX_H_
+
+/*
+ * two stage parsing, the LJSON_ENGINE_TWO_STAGE engine.
+ * stage 1 classifies the input 64 bytes at a time with simd compares and
+ * bit tricks, and records where every structural character and every
+ * string, number and literal starts, whitespace and string contents are
+ * never looked at again. stage 2 walks those positions and drives the same
+ * handlers as ljson_context::parse_value(), with the same error codes.
+ */
+
+#include "ljson_context.h"
+#include <cstdint>
+#include <memory>
+
+namespace ljson {
+
+class ljson_structural_index {
+public:
+  ljson_structural_index() : capacity_(0), size_(0) {}
+
+  /// inputs from this size on are parsed by the one pass engine instead
+  static const size_t kMaxInput = UINT32_MAX - 1;
+
+  /*
+   * stage 1 over [json, json + len), len < kMaxInput. a string left open
+   * is not an error here, stage 2 finds it while walking.
+   */
+  void build(const char* json, size_t len);
+
+  /// positions in the input, followed by len as a sentinel
+  const uint32_t* positions() const { return positions_.get(); }
+
+  size_t size() const { return size_; }
+
+private:
+  /// room for the worst case of one position per byte, only the used part is touched
+  std::unique_ptr<uint32_t[]> positions_;
+  size_t capacity_;
+  size_t size_;
+};
+
+template<typename Handler>
+LJSON_STATE ljson_context::parse_root_indexed(Handler& handler) {
+  size_t len = end_ - json_;
+  if (len >= ljson_structural_index::kMaxInput)
+    return parse_root(handler);
+  if (index_ != nullptr) {
+    index_->build(json_, len);
+    return parse_indexed(index_->positions(), handler);
+  }
+  ljson_structural_index index;
+  index.build(json_, len);
+  return parse_indexed(index.positions(), handler);
+}
+
+/*
+ * the bytes in [json_, next) have to be whitespace after a number or a
+ * literal: their end is not indexed, e.g. the 'x' of "1x" is skipped by
+ * stage 2. after a string or a structural character the next position is
+ * always the next byte that is not whitespace.
+ */
+#define LJSON_SCALAR_END()\
+    do {\
+      if (json_ != base + *i && skip_whitespace(json_) != base + *i)\
+        LJSON_VALUE_ERROR(frames_.empty() ? LJSON_PARSE_ROOT_NOT_SINGULAR : LJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET);\
+    } while(0)
+#define LJSON_VALUE_ERROR(ret) do { LJSON_STATE error = (ret); frames_.clear(); return error; } while(0)
+#define LJSON_HANDLE(call) do { if (!(call)) LJSON_VALUE_ERROR(LJSON_PARSE_HANDLER_STOPPED); } while(0)
+#define LJSON_TOKEN_AT(i) (json_ = base + *(i), peek())
+
+template<typename Handler>
+LJSON_STATE ljson_context::parse_indexed(const uint32_t* i, Handler& handler) {
+  const char* base = json_;
+  LJSON_STATE ret;
+  for (;;) {
+    // a value starts at position *i
+    switch (LJSON_TOKEN_AT(i++)) {
+      case 'n':
+        if ((ret = parse_literal_raw("null")) != LJSON_PARSE_OK)
+          LJSON_VALUE_ERROR(ret);
+        LJSON_HANDLE(handler.null());
+        LJSON_SCALAR_END();
+        break;
+      case 't':
+        if ((ret = parse_literal_raw("true")) != LJSON_PARSE_OK)
+          LJSON_VALUE_ERROR(ret);
+        LJSON_HANDLE(handler.boolean(true));
+        LJSON_SCALAR_END();
+        break;
+      case 'f':
+        if ((ret = parse_literal_raw("false")) != LJSON_PARSE_OK)
+          LJSON_VALUE_ERROR(ret);
+        LJSON_HANDLE(handler.boolean(false));
+        LJSON_SCALAR_END();
+        break;
+      case '"': {
+        const char *str = nullptr;
+        size_t len = 0;
+        if ((ret = parse_string_persist(&str, &len)) != LJSON_PARSE_OK)
+          LJSON_VALUE_ERROR(ret);
+        LJSON_HANDLE(handler.string(str, len));
+        break;
+      }
+      case '[':
+        if (frames_.size() >= max_depth_)
+          LJSON_VALUE_ERROR(LJSON_PARSE_NESTING_TOO_DEEP);
+        LJSON_HANDLE(handler.start_array());
+        if (LJSON_TOKEN_AT(i) == ']') {
+          i++;
+          LJSON_HANDLE(handler.end_array(0));
+          break;
+        }
+        frames_.push_back(frame{false, 0});
+        continue;
+      case '{':
+        if (frames_.size() >= max_depth_)
+          LJSON_VALUE_ERROR(LJSON_PARSE_NESTING_TOO_DEEP);
+        LJSON_HANDLE(handler.start_object());
+        if (LJSON_TOKEN_AT(i) == '}') {
+          i++;
+          LJSON_HANDLE(handler.end_object(0));
+          break;
+        }
+        frames_.push_back(frame{true, 0});
+        if ((ret = parse_indexed_key(base, i, handler)) != LJSON_PARSE_OK)
+          LJSON_VALUE_ERROR(ret);
+        i += 2;
+        continue;
+      case '\0':
+        LJSON_VALUE_ERROR(LJSON_PARSE_EXPECT_VALUE);
+      default: {
+        ljson_number_value number;
+        if ((ret = parse_number_raw(&number)) != LJSON_PARSE_OK)
+          LJSON_VALUE_ERROR(ret);
+        LJSON_HANDLE(handler.number(number));
+        LJSON_SCALAR_END();
+        break;
+      }
+    }
+    // a value is complete, close every container ending right after it
+    for (;;) {
+      if (frames_.empty()) {
+        json_ = base + *i;
+        return json_ == end_ ? LJSON_PARSE_OK : LJSON_PARSE_ROOT_NOT_SINGULAR;
+      }
+      frame& top = frames_.back();
+      top.size++;
+      char ch = LJSON_TOKEN_AT(i);
+      if (ch == ',') {
+        i++;
+        if (top.object) {
+          if ((ret = parse_indexed_key(base, i, handler)) != LJSON_PARSE_OK)
+            LJSON_VALUE_ERROR(ret);
+          i += 2;
+        }
+        break;
+      }
+      if (ch != (top.object ? '}' : ']'))
+        LJSON_VALUE_ERROR(LJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET);
+      i++;
+      frame closed = top;
+      frames_.pop_back();
+      if (closed.object)
+        LJSON_HANDLE(handler.end_object(closed.size));
+      else
+        LJSON_HANDLE(handler.end_array(closed.size));
+    }
+  }
+}
+
+template<typename Handler>
+LJSON_STATE ljson_context::parse_indexed_key(const char* base, const uint32_t* i, Handler& handler) {
+  const char *key = nullptr;
+  size_t len = 0;
+  LJSON_STATE ret;
+  if (LJSON_TOKEN_AT(i) != '"')
+    return LJSON_PARSE_MISS_KEY;
+  if ((ret = parse_string_persist(&key, &len)) != LJSON_PARSE_OK)
+    return ret;
+  if (!handler.key(key, len))
+    return LJSON_PARSE_HANDLER_STOPPED;
+  return LJSON_TOKEN_AT(i + 1) == ':' ? LJSON_PARSE_OK : LJSON_PARSE_MISS_COLON;
+}
+
+#undef LJSON_TOKEN_AT
+#undef LJSON_HANDLE
+#undef LJSON_VALUE_ERROR
+#undef LJSON_SCALAR_END
+
+} // namespace ljson
+
+#endif //LJSON_LJSON_INDEX_H_
@@ -0,0 +1,111 @@
+#include "ljson_ndjson.h"
+#include "ljson_parser.h"
+#include "ljson_simd.h"
+#include <algorithm>
+#include <atomic>
+#include <iterator> // back_inserter()
+#include <cstring> // memchr()
+#include <thread>
+
+namespace ljson {
+
+namespace {
+
+size_t worker_count(size_t threads) {
+  if (threads != 0)
+    return threads;
+  unsigned n = std::thread::hardware_concurrency();
+  return n != 0 ? n : 1;
+}
+
+/// @return: batch boundaries from data to data + len, each batch but the last ends after a '\n'
+std::vector<const char*> split_batches(const char* data, size_t len, size_t batch_size) {
+  const char* end = data + len;
+  std::vector<const char*> bounds(1, data);
+  batch_size = std::max<size_t>(batch_size, 1);
+  for (const char* p = data; static_cast<size_t>(end - p) > batch_size;) {
+    auto nl = static_cast<const char*>(memchr(p + batch_size, '\n', end - p - batch_size));
+    if (nl == nullptr)
+      break;
+    p = nl + 1;
+    bounds.push_back(p);
+  }
+  if (bounds.back() != end)
+    bounds.push_back(end);
+  return bounds;
+}
+
+/*
+ * parse the lines of [begin, end) and hand each record to fn.
+ * @input_end: end of the whole input, a line followed by LJSON_PADDING bytes
+ *             of it is parsed with parse_padded
+ * the lines share one parser, a line dropped by fn leaves its arena to the next one
+ */
+template<typename Fn>
+void parse_batch(const char* input, const char* input_end, const char* begin, const char* end, size_t max_depth,
+                 Fn&& fn) {
+  ljson_parser parser(max_depth);
+  for (const char* line = begin; line != end;) {
+    auto nl = static_cast<const char*>(memchr(line, '\n', end - line));
+    const char* line_end = nl != nullptr ? nl : end;
+    if (simd::skip_whitespace<false>(line, line_end) != line_end) {
+      ljson_ndjson::record r;
+      r.offset = line - input;
+      r.ret = LJSON_PARSE_OK;
+      size_t n = line_end - line;
+      if (input_end - line_end >= LJSON_PADDING)
+        r.value = parser.parse_padded(line, n, &r.ret);
+      else
+        r.value = parser.parse(line, n, &r.ret);
+      fn(r);
+    }
+    line = nl != nullptr ? nl + 1 : end;
+  }
+}
+
+/// call work(i) for every batch i, batches are taken in order by threads workers
+template<typename Work>
+void run_workers(size_t batches, size_t threads, Work&& work) {
+  std::atomic<size_t> next(0);
+  auto worker = [&] {
+    for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < batches;)
+      work(i);
+  };
+  threads = std::min(threads, batches);
+  std::vector<std::thread> pool;
+  for (size_t t = 1; t < threads; ++t)
+    pool.emplace_back(worker);
+  /// the calling thread is a worker too
+  worker();
+  for (auto& t : pool)
+    t.join();
+}
+
+}
+
+std::vector<ljson_ndjson::record> ljson_ndjson::parse(const char* data, size_t len, const options& opts) {
+  auto bounds = split_batches(data, len, opts.batch_size);
+  size_t batches = bounds.size() - 1;
+  std::vector<std::vector<record>> results(batches);
+  run_workers(batches, worker_count(opts.threads), [&](size_t i) {
+    parse_batch(data, data + len, bounds[i], bounds[i + 1], opts.max_depth,
+                [&](record& r) { results[i].push_back(std::move(r)); });
+  });
+  size_t total = 0;
+  for (auto& batch : results)
+    total += batch.size();
+  std::vector<record> records;
+  records.reserve(total);
+  for (auto& batch : results)
+    std::move(batch.begin(), batch.end(), std::back_inserter(records));
+  return records;
+}
+
+void ljson_ndjson::parse_unordered(const char* data, size_t len, const callback& fn, const options& opts) {
+  auto bounds = split_batches(data, len, opts.batch_size);
+  run_workers(bounds.size() - 1, worker_count(opts.threads), [&](size_t i) {
+    parse_batch(data, data + len, bounds[i], bounds[i + 1], opts.max_depth, fn);
+  });
+}
+
+} // namespace ljson
@@ -0,0 +1,50 @@
+#ifndef LJSON_LJSON_NDJSON_H_
+#define LJSON_LJSON_NDJSON_H_
+
+#include "ljson.h"
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace ljson {
+
+/*
+ * ljson_ndjson: parse newline-delimited json (json lines), one value per
+ * line, on several threads. the input is cut into batches at line
+ * boundaries, each worker takes the next batch left and parses its lines
+ * with one ljson_parser per batch, nothing is copied.
+ * lines holding only whitespace are skipped, "\r\n" line ends are fine.
+ */
+struct ljson_ndjson {
+  struct options {
+    options() : threads(0), batch_size(1 << 20), max_depth(LJSON_PARSE_MAX_DEPTH) {}
+
+    /// number of workers, 0 for one per hardware thread
+    size_t threads;
+    /// bytes per batch, a batch is extended up to the end of its last line
+    size_t batch_size;
+    size_t max_depth;
+  };
+
+  struct record {
+    /// offset of the line in the input
+    size_t offset;
+    /// LJSON_PARSE_OK or the error of the line, value is nullptr then
+    int ret;
+    std::shared_ptr<ljson_value> value;
+  };
+
+  /// @return: one record per line, in input order
+  static std::vector<record> parse(const char* data, size_t len, const options& opts = options());
+
+  /*
+   * hand every record to callback as soon as it is parsed, in no particular
+   * order: callback runs concurrently on the worker threads.
+   */
+  typedef std::function<void(record&)> callback;
+  static void parse_unordered(const char* data, size_t len, const callback& fn, const options& opts = options());
+};
+
+} // namespace ljson
+
+#endif //LJSON_LJSON_NDJSON_H_
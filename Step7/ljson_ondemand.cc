@@ -0,0 +1,370 @@
+#include "ljson_ondemand.h"
+#include "ljson_context.h"
+#include "ljson_simd.h"
+#include <cstring> // memcmp()
+
+namespace ljson {
+
+ljson_ondemand_document::ljson_ondemand_document(const char* data, size_t len, bool padded)
+  : json_(data), end_(data + len), padded_(padded) {}
+
+ljson_ondemand_value ljson_ondemand_document::root() const {
+  return value_at(skip_whitespace(json_));
+}
+
+const char* ljson_ondemand_document::skip_whitespace(const char* p) const {
+  return padded_ ? simd::skip_whitespace<true>(p, end_) : simd::skip_whitespace<false>(p, end_);
+}
+
+ljson_ondemand_value ljson_ondemand_document::value_at(const char* p) const {
+  if (p == end_)
+    return ljson_ondemand_value(this, nullptr, LJSON_PARSE_EXPECT_VALUE);
+  switch (*p) {
+    case ',': case ':': case ']': case '}':
+      return ljson_ondemand_value(this, nullptr, LJSON_PARSE_INVALID_VALUE);
+    default:
+      return ljson_ondemand_value(this, p, LJSON_PARSE_OK);
+  }
+}
+
+const char* ljson_ondemand_document::skip_string(const char* p, LJSON_STATE* error) const {
+  for (;;) {
+    p = padded_ ? simd::scan_string<true>(p, end_) : simd::scan_string<false>(p, end_);
+    if (p == end_) {
+      *error = LJSON_PARSE_MISS_QUOTATION_MARK;
+      return nullptr;
+    }
+    switch (*p) {
+      case '"':
+        return p + 1;
+      case '\\':
+        /// the escaped character is not looked at, it only must not end the string
+        if (end_ - p < 2) {
+          *error = LJSON_PARSE_MISS_QUOTATION_MARK;
+          return nullptr;
+        }
+        p += 2;
+        break;
+      default:
+        *error = LJSON_PARSE_INVALID_STRING_CHAR;
+        return nullptr;
+    }
+  }
+}
+
+const char* ljson_ondemand_document::skip_value(const char* p, LJSON_STATE* error) const {
+  switch (*p) {
+    case '"':
+      return skip_string(p + 1, error);
+    case '[':
+    case '{':
+      return skip_container(p, error);
+    default: {
+      /// a number or a literal runs up to the next separator
+      const char* q = p;
+      while (q != end_ && !simd::is_whitespace(*q) && *q != ',' && *q != ']' && *q != '}' && *q != ':')
+        q++;
+      if (q == p) {
+        *error = LJSON_PARSE_INVALID_VALUE;
+        return nullptr;
+      }
+      return q;
+    }
+  }
+}
+
+const char* ljson_ondemand_document::skip_container(const char* p, LJSON_STATE* error) const {
+  /// p is on the first bracket, depth counts the brackets open
+  size_t depth = 0;
+  uint64_t escaped_carry = 0;
+  uint64_t in_string_carry = 0;  /* all ones inside a string */
+  for (; end_ - p >= 64; p += 64) {
+    simd::brackets64 m = simd::classify_brackets64(p);
+    uint64_t quote = m.quote & ~simd::find_escaped(m.backslash, &escaped_carry);
+    uint64_t in_string = simd::prefix_xor(quote) ^ in_string_carry;
+    in_string_carry = static_cast<uint64_t>(static_cast<int64_t>(in_string) >> 63);
+    uint64_t open = m.open & ~in_string;
+    uint64_t close = m.close & ~in_string;
+    // the container can only end in this stretch if it closes depth brackets at least
+    auto closes = static_cast<size_t>(__builtin_popcountll(close));
+    if (closes < depth) {
+      depth = depth + __builtin_popcountll(open) - closes;
+      continue;
+    }
+    for (uint64_t brackets = open | close; brackets != 0; brackets &= brackets - 1) {
+      uint64_t bit = brackets & (~brackets + 1);
+      if (open & bit)
+        depth++;
+      else if (--depth == 0)
+        return p + __builtin_ctzll(bit) + 1;
+    }
+  }
+  // less than 64 bytes left, one at a time
+  bool in_string = in_string_carry != 0;
+  bool escaped = in_string && escaped_carry != 0;
+  for (; p != end_; ++p) {
+    if (in_string) {
+      if (escaped)
+        escaped = false;
+      else if (*p == '\\')
+        escaped = true;
+      else if (*p == '"')
+        in_string = false;
+      continue;
+    }
+    switch (*p) {
+      case '"':
+        in_string = true;
+        break;
+      case '[':
+      case '{':
+        depth++;
+        break;
+      case ']':
+      case '}':
+        if (--depth == 0)
+          return p + 1;
+        break;
+      default:
+        break;
+    }
+  }
+  *error = in_string ? LJSON_PARSE_MISS_QUOTATION_MARK : LJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+  return nullptr;
+}
+
+LJSON_TYPE ljson_ondemand_value::get_type() const {
+  assert(error_ == LJSON_PARSE_OK);
+  switch (*p_) {
+    case 'n': return LJSON_NULL;
+    case 't': return LJSON_TRUE;
+    case 'f': return LJSON_FALSE;
+    case '"': return LJSON_STRING;
+    case '[': return LJSON_ARRAY;
+    case '{': return LJSON_OBJECT;
+    default: return LJSON_NUMBER;
+  }
+}
+
+ljson_ondemand_value ljson_ondemand_value::find(const char* key, size_t len) const {
+  if (error_ != LJSON_PARSE_OK)
+    return *this;
+  if (*p_ != '{')
+    return failed(LJSON_ACCESS_INCORRECT_TYPE);
+  ljson_context c(p_ + 1, doc_->end_, nullptr, false, doc_->padded_);
+  LJSON_STATE ret;
+  c.parse_whitespace();
+  if (c.peek() == '}')
+    return failed(LJSON_ACCESS_NO_SUCH_KEY);
+  for (;;) {
+    const char* str = nullptr;
+    size_t n = 0;
+    if (c.peek() != '"')
+      return failed(LJSON_PARSE_MISS_KEY);
+    /// keys with escapes are unescaped on the stack of c, the others are compared in place
+    if ((ret = c.parse_string_raw(&str, &n)) != LJSON_PARSE_OK)
+      return failed(ret);
+    bool match = n == len && memcmp(str, key, len) == 0;
+    c.parse_whitespace();
+    if (c.peek() != ':')
+      return failed(LJSON_PARSE_MISS_COLON);
+    c.json_++;
+    c.parse_whitespace();
+    if (match)
+      return doc_->value_at(c.json_);
+    if (c.json_ == c.end_)
+      return failed(LJSON_PARSE_EXPECT_VALUE);
+    if ((c.json_ = doc_->skip_value(c.json_, &ret)) == nullptr)
+      return failed(ret);
+    c.parse_whitespace();
+    switch (c.peek()) {
+      case ',':
+        c.json_++;
+        c.parse_whitespace();
+        break;
+      case '}':
+        return failed(LJSON_ACCESS_NO_SUCH_KEY);
+      default:
+        return failed(LJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET);
+    }
+  }
+}
+
+ljson_ondemand_value ljson_ondemand_value::operator[](size_t index) const {
+  if (error_ != LJSON_PARSE_OK)
+    return *this;
+  if (*p_ != '[')
+    return failed(LJSON_ACCESS_INCORRECT_TYPE);
+  const char* p = doc_->skip_whitespace(p_ + 1);
+  if (p != doc_->end_ && *p == ']')
+    return failed(LJSON_ACCESS_INDEX_OUT_OF_RANGE);
+  for (size_t i = 0;; ++i) {
+    if (i == index)
+      return doc_->value_at(p);
+    if (p == doc_->end_)
+      return failed(LJSON_PARSE_EXPECT_VALUE);
+    LJSON_STATE ret;
+    if ((p = doc_->skip_value(p, &ret)) == nullptr)
+      return failed(ret);
+    p = doc_->skip_whitespace(p);
+    if (p != doc_->end_ && *p == ',') {
+      p = doc_->skip_whitespace(p + 1);
+      continue;
+    }
+    if (p != doc_->end_ && *p == ']')
+      return failed(LJSON_ACCESS_INDEX_OUT_OF_RANGE);
+    return failed(LJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET);
+  }
+}
+
+LJSON_STATE ljson_ondemand_value::size(size_t* size) const {
+  if (error_ != LJSON_PARSE_OK)
+    return error_;
+  if (*p_ != '[' && *p_ != '{')
+    return LJSON_ACCESS_INCORRECT_TYPE;
+  bool object = *p_ == '{';
+  const char* p = doc_->skip_whitespace(p_ + 1);
+  const char close = object ? '}' : ']';
+  LJSON_STATE ret;
+  size_t n = 0;
+  if (p != doc_->end_ && *p == close) {
+    *size = 0;
+    return LJSON_PARSE_OK;
+  }
+  for (;;) {
+    if (object) {
+      if (p == doc_->end_ || *p != '"')
+        return LJSON_PARSE_MISS_KEY;
+      if ((p = doc_->skip_string(p + 1, &ret)) == nullptr)
+        return ret;
+      p = doc_->skip_whitespace(p);
+      if (p == doc_->end_ || *p != ':')
+        return LJSON_PARSE_MISS_COLON;
+      p = doc_->skip_whitespace(p + 1);
+    }
+    ljson_ondemand_value element = doc_->value_at(p);
+    if (element.error_ != LJSON_PARSE_OK)
+      return element.error_;
+    if ((p = doc_->skip_value(p, &ret)) == nullptr)
+      return ret;
+    n++;
+    p = doc_->skip_whitespace(p);
+    if (p != doc_->end_ && *p == ',') {
+      p = doc_->skip_whitespace(p + 1);
+      continue;
+    }
+    if (p != doc_->end_ && *p == close) {
+      *size = n;
+      return LJSON_PARSE_OK;
+    }
+    return LJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+  }
+}
+
+LJSON_STATE ljson_ondemand_value::scalar_end(const char* p) const {
+  p = doc_->skip_whitespace(p);
+  /// the root has to be alone, any other value is followed by a separator
+  if (p_ == doc_->skip_whitespace(doc_->json_))
+    return p == doc_->end_ ? LJSON_PARSE_OK : LJSON_PARSE_ROOT_NOT_SINGULAR;
+  if (p != doc_->end_ && (*p == ',' || *p == ']' || *p == '}'))
+    return LJSON_PARSE_OK;
+  return LJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+}
+
+LJSON_STATE ljson_ondemand_value::get_null() const {
+  if (error_ != LJSON_PARSE_OK)
+    return error_;
+  if (*p_ != 'n')
+    return LJSON_ACCESS_INCORRECT_TYPE;
+  ljson_context c(p_, doc_->end_, nullptr, false, doc_->padded_);
+  LJSON_STATE ret = c.parse_literal_raw("null");
+  return ret != LJSON_PARSE_OK ? ret : scalar_end(c.json_);
+}
+
+LJSON_STATE ljson_ondemand_value::get_bool(bool* b) const {
+  if (error_ != LJSON_PARSE_OK)
+    return error_;
+  if (*p_ != 't' && *p_ != 'f')
+    return LJSON_ACCESS_INCORRECT_TYPE;
+  ljson_context c(p_, doc_->end_, nullptr, false, doc_->padded_);
+  LJSON_STATE ret = c.parse_literal_raw(*p_ == 't' ? "true" : "false");
+  if (ret != LJSON_PARSE_OK || (ret = scalar_end(c.json_)) != LJSON_PARSE_OK)
+    return ret;
+  *b = *p_ == 't';
+  return LJSON_PARSE_OK;
+}
+
+LJSON_STATE ljson_ondemand_value::get_number_value(ljson_number_value* number) const {
+  if (error_ != LJSON_PARSE_OK)
+    return error_;
+  if (*p_ != '-' && (*p_ < '0' || *p_ > '9'))
+    return LJSON_ACCESS_INCORRECT_TYPE;
+  ljson_context c(p_, doc_->end_, nullptr, false, doc_->padded_);
+  LJSON_STATE ret = c.parse_number_raw(number);
+  return ret != LJSON_PARSE_OK ? ret : scalar_end(c.json_);
+}
+
+LJSON_STATE ljson_ondemand_value::get_number(double* number) const {
+  ljson_number_value value;
+  LJSON_STATE ret = get_number_value(&value);
+  if (ret == LJSON_PARSE_OK)
+    *number = value.to_double();
+  return ret;
+}
+
+LJSON_STATE ljson_ondemand_value::get_int64(int64_t* number) const {
+  ljson_number_value value;
+  LJSON_STATE ret = get_number_value(&value);
+  if (ret != LJSON_PARSE_OK)
+    return ret;
+  if (!value.is_int64())
+    return LJSON_ACCESS_INCORRECT_TYPE;
+  *number = value.to_int64();
+  return LJSON_PARSE_OK;
+}
+
+LJSON_STATE ljson_ondemand_value::get_uint64(uint64_t* number) const {
+  ljson_number_value value;
+  LJSON_STATE ret = get_number_value(&value);
+  if (ret != LJSON_PARSE_OK)
+    return ret;
+  if (!value.is_uint64())
+    return LJSON_ACCESS_INCORRECT_TYPE;
+  *number = value.to_uint64();
+  return LJSON_PARSE_OK;
+}
+
+LJSON_STATE ljson_ondemand_value::get_string(const char** str, size_t* len) const {
+  if (error_ != LJSON_PARSE_OK)
+    return error_;
+  if (*p_ != '"')
+    return LJSON_ACCESS_INCORRECT_TYPE;
+  ljson_context c(p_, doc_->end_, nullptr, false, doc_->padded_);
+  LJSON_STATE ret = c.parse_string_raw(str, len);
+  if (ret != LJSON_PARSE_OK || (ret = scalar_end(c.json_)) != LJSON_PARSE_OK)
+    return ret;
+  if (*str != p_ + 1) {
+    /// unescaped on the stack of c, which dies here
+    if (doc_->arena_ == nullptr)
+      doc_->arena_.reset(new ljson_arena(256));
+    *str = doc_->arena_->copy_string(*str, *len);
+  }
+  return LJSON_PARSE_OK;
+}
+
+LJSON_STATE ljson_ondemand_value::get_string(std::string* str) const {
+  if (error_ != LJSON_PARSE_OK)
+    return error_;
+  if (*p_ != '"')
+    return LJSON_ACCESS_INCORRECT_TYPE;
+  ljson_context c(p_, doc_->end_, nullptr, false, doc_->padded_);
+  const char* s = nullptr;
+  size_t len = 0;
+  LJSON_STATE ret = c.parse_string_raw(&s, &len);
+  if (ret != LJSON_PARSE_OK || (ret = scalar_end(c.json_)) != LJSON_PARSE_OK)
+    return ret;
+  str->assign(s, len);
+  return LJSON_PARSE_OK;
+}
+
+} // namespace ljson
@@ -0,0 +1,129 @@
+#ifndef LJSON_LJSON_ONDEMAND_H_
+#define LJSON_LJSON_ONDEMAND_H_
+
+/*
+ * on demand access: nothing is parsed up front, doc["user"]["id"] scans the
+ * text forward from the start of the document and steps over the members
+ * and elements in the way by bracket matching, only the values actually
+ * read go through the tokenizer of ljson_context.
+ * the skipped parts are only checked for closed strings and balanced
+ * brackets, a document that is invalid elsewhere can still be read, use
+ * ljson_sax or parse() when the whole input has to be validated.
+ * every lookup starts from the value it is called on, keep the
+ * ljson_ondemand_value of an object read several times instead of looking
+ * it up from the root again.
+ */
+
+#include "ljson.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring> // strlen()
+#include <memory>
+#include <string>
+
+namespace ljson {
+
+class ljson_ondemand_document;
+
+/// a position in the text of a document, or the error met while looking it up
+class ljson_ondemand_value {
+public:
+  /// LJSON_PARSE_OK, otherwise every lookup and getter fails with this error
+  LJSON_STATE error() const { return error_; }
+
+  /// from the first byte, the value is not checked, requires error() == LJSON_PARSE_OK
+  LJSON_TYPE get_type() const;
+
+  /// first member named key, LJSON_ACCESS_NO_SUCH_KEY when there is none
+  ljson_ondemand_value operator[](const char* key) const { return find(key, strlen(key)); }
+  ljson_ondemand_value operator[](const std::string& key) const { return find(key.data(), key.size()); }
+  ljson_ondemand_value find(const char* key, size_t len) const;
+
+  /// index-th element, the ones before are skipped
+  ljson_ondemand_value operator[](size_t index) const;
+  ljson_ondemand_value operator[](int index) const { return (*this)[static_cast<size_t>(index)]; }
+
+  /*
+   * getters parse the value they are called on, LJSON_ACCESS_INCORRECT_TYPE
+   * when it is of another type.
+   */
+  LJSON_STATE get_null() const;
+  LJSON_STATE get_bool(bool* b) const;
+  /// any number type, integers above 2^53 are rounded
+  LJSON_STATE get_number(double* number) const;
+  /// LJSON_ACCESS_INCORRECT_TYPE as well when the number is not an integer in range
+  LJSON_STATE get_int64(int64_t* number) const;
+  LJSON_STATE get_uint64(uint64_t* number) const;
+  /*
+   * @str: points into the input when the string has no escape, into the
+   *       document otherwise: valid as long as both, not null-terminated.
+   *       unescaping writes to the document, only call it from one thread
+   */
+  LJSON_STATE get_string(const char** str, size_t* len) const;
+  LJSON_STATE get_string(std::string* str) const;
+  /// number of array elements or object members, all of them are skipped over
+  LJSON_STATE size(size_t* size) const;
+
+private:
+  friend class ljson_ondemand_document;
+
+  ljson_ondemand_value(const ljson_ondemand_document* doc, const char* p, LJSON_STATE error)
+    : doc_(doc), p_(p), error_(error) {}
+
+  ljson_ondemand_value failed(LJSON_STATE error) const { return ljson_ondemand_value(doc_, nullptr, error); }
+  LJSON_STATE get_number_value(ljson_number_value* number) const;
+  /// whitespace then ',', ']', '}' or the end have to follow a scalar ending at p
+  LJSON_STATE scalar_end(const char* p) const;
+
+  const ljson_ondemand_document* doc_;
+  /// first byte of the value
+  const char* p_;
+  LJSON_STATE error_;
+};
+
+class ljson_ondemand_document {
+public:
+  /// the input is only read, it has to outlive the document and every value of it
+  explicit ljson_ondemand_document(const char* json) : ljson_ondemand_document(json, strlen(json)) {}
+  ljson_ondemand_document(const char* data, size_t len) : ljson_ondemand_document(data, len, false) {}
+
+  /// LJSON_PADDING readable bytes follow data + len, see ljson_value::parse_padded
+  static ljson_ondemand_document padded(const char* data, size_t len) {
+    return ljson_ondemand_document(data, len, true);
+  }
+
+  ljson_ondemand_document(ljson_ondemand_document&&) = default;
+
+  /// the root value, LJSON_PARSE_EXPECT_VALUE for an empty input
+  ljson_ondemand_value root() const;
+
+  ljson_ondemand_value operator[](const char* key) const { return root()[key]; }
+  ljson_ondemand_value operator[](const std::string& key) const { return root()[key]; }
+  ljson_ondemand_value operator[](size_t index) const { return root()[index]; }
+  ljson_ondemand_value operator[](int index) const { return root()[index]; }
+
+private:
+  friend class ljson_ondemand_value;
+
+  ljson_ondemand_document(const char* data, size_t len, bool padded);
+
+  /// @return: past the value starting at p, nullptr on error with *error set
+  const char* skip_value(const char* p, LJSON_STATE* error) const;
+  /// @p: position after the opening '"'
+  const char* skip_string(const char* p, LJSON_STATE* error) const;
+  /// bracket matching 64 bytes at a time, @p: on the opening bracket
+  const char* skip_container(const char* p, LJSON_STATE* error) const;
+  const char* skip_whitespace(const char* p) const;
+  /// a value starting at p, the separator or end found there otherwise
+  ljson_ondemand_value value_at(const char* p) const;
+
+  const char* json_;
+  const char* end_;
+  bool padded_;
+  /// unescaped strings, created by the first one
+  mutable std::unique_ptr<ljson_arena> arena_;
+};
+
+} // namespace ljson
+
+#endif //LJSON_LJSON_ONDEMAND_H_
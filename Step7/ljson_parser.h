@@ -0,0 +1,74 @@
+#ifndef LJSON_LJSON_PARSER_H_
+#define LJSON_LJSON_PARSER_H_
+
+#include "ljson.h"
+#include <cstddef>
+#include <cstring> // strlen()
+#include <memory>
+
+namespace ljson {
+
+struct ljson_context;
+class ljson_structural_index;
+
+/*
+ * ljson_parser: the parse functions of ljson_value and ljson_compact_value
+ * for many documents in a row. the byte stack, the value buffers and the
+ * structural index of the two stage engine are kept from one document to
+ * the next, at the capacity the largest one needed.
+ * with reuse_arena the arena of the previous document is reset and reused
+ * as well, as soon as nothing of that document is alive anymore: parse,
+ * use and drop each message, and the nodes stop costing any allocation.
+ * a parser is used by one thread at a time, its documents can go anywhere.
+ */
+class ljson_parser {
+public:
+  explicit ljson_parser(size_t max_depth = LJSON_PARSE_MAX_DEPTH, LJSON_ENGINE engine = LJSON_ENGINE_ONE_PASS,
+                        bool reuse_arena = true);
+  ~ljson_parser();
+
+  ljson_parser(const ljson_parser&) = delete;
+  ljson_parser& operator=(const ljson_parser&) = delete;
+
+  /// same contracts as ljson_value::parse and friends
+  std::shared_ptr<ljson_value> parse(const char* json, int *ret) { return parse(json, strlen(json), ret); }
+  std::shared_ptr<ljson_value> parse(const char* data, size_t len, int *ret);
+  std::shared_ptr<ljson_value> parse_padded(const char* data, size_t len, int *ret);
+  std::shared_ptr<ljson_value> parse_insitu(char* json, int *ret);
+
+  /// same contracts as ljson_compact_value::parse and friends
+  std::shared_ptr<ljson_compact_value> parse_compact(const char* json, int *ret) {
+    return parse_compact(json, strlen(json), ret);
+  }
+  std::shared_ptr<ljson_compact_value> parse_compact(const char* data, size_t len, int *ret);
+  std::shared_ptr<ljson_compact_value> parse_compact_padded(const char* data, size_t len, int *ret);
+  std::shared_ptr<ljson_compact_value> parse_compact_insitu(char* json, int *ret);
+
+  /*
+   * forget the state left by the last parse, the buffers keep their
+   * capacity. the retained arena is reset too when no document holds it.
+   * parse() does the same on its own, only call it before a long pause.
+   */
+  void reset();
+
+  /// give every buffer back, the next parse starts from scratch
+  void release();
+
+private:
+  /// the arena of the next document, the retained one when it is free
+  std::shared_ptr<ljson_arena> next_arena(size_t len);
+
+  template<typename Builder>
+  std::shared_ptr<typename Builder::value_type> parse_range(const char* json, const char* end, bool insitu,
+                                                            bool padded, int *ret);
+
+  std::unique_ptr<ljson_context> context_;
+  std::unique_ptr<ljson_structural_index> index_;
+  std::shared_ptr<ljson_arena> arena_;
+  LJSON_ENGINE engine_;
+  bool reuse_arena_;
+};
+
+} // namespace ljson
+
+#endif //LJSON_LJSON_PARSER_H_
@@ -0,0 +1,428 @@
+#ifndef LJSON_LJSON_PUSH_H_
+#define LJSON_LJSON_PUSH_H_
+
+#include "ljson.h"
+#include "ljson_context.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ljson {
+
+/*
+ * ljson_push_parser: parse a stream of json values handed over in chunks of
+ * any size, e.g. as they come from a socket. events go to a handler with the
+ * ljson_sax interface as soon as their token is complete, a string, number
+ * or literal split between two chunks is carried over and reported once the
+ * next chunks complete it.
+ * the stream holds any number of values separated by optional whitespace,
+ * like "1 [2] {}", the handler sees each one closing at depth 0. a number
+ * or literal has to be followed by whitespace, '[', '{' or '"' before the
+ * next value: "01" and "truefalse" fail with LJSON_PARSE_ROOT_NOT_SINGULAR.
+ * errors stick: feed() and finish() keep returning the first error until
+ * reset().
+ */
+template<typename Handler>
+class ljson_push_parser {
+public:
+  explicit ljson_push_parser(Handler& handler, size_t max_depth = LJSON_PARSE_MAX_DEPTH)
+    : handler_(handler), tokens_(nullptr, nullptr, nullptr), max_depth_(max_depth) {
+    reset();
+  }
+
+  ljson_push_parser(const ljson_push_parser&) = delete;
+  ljson_push_parser& operator=(const ljson_push_parser&) = delete;
+
+  /// @return: LJSON_PARSE_OK while the input so far is valid, complete or not
+  LJSON_STATE feed(const char* data, size_t len);
+
+  /// end of the stream, @return: LJSON_PARSE_OK when no value is left open
+  LJSON_STATE finish();
+
+  /// forget the stream, the next feed() starts a new one. a handler keeping
+  /// state across events has to be reset too, see ljson_document_handler
+  void reset() {
+    state_ = EXPECT_VALUE;
+    need_delimiter_ = false;
+    error_ = LJSON_PARSE_OK;
+    frames_.clear();
+    carry_.clear();
+    carry_escape_ = false;
+  }
+
+  /// number of containers left open
+  size_t depth() const { return frames_.size(); }
+
+private:
+  enum parse_state {
+    EXPECT_VALUE,
+    EXPECT_VALUE_OR_CLOSE,  /* just after '[' */
+    EXPECT_KEY,
+    EXPECT_KEY_OR_CLOSE,    /* just after '{' */
+    EXPECT_COLON,
+    EXPECT_COMMA_OR_CLOSE
+  };
+
+  /*
+   * run the grammar over [p, end), the tokenizer of ljson_context parses
+   * strings, numbers and literals once their end is known.
+   * @last: nothing follows end, a token running up to it is complete
+   */
+  LJSON_STATE consume(const char* p, const char* end, bool last);
+
+  /// @return: end of the token starting at p, nullptr when it may go on past end
+  const char* token_end(const char* p, const char* end);
+
+  /*
+   * parse and report the token starting at p, *next receives the end of
+   * what was parsed. the token is tried on [p, end) directly, it is only
+   * looked for its end when it fails or reaches end: *next is nullptr when
+   * the token may go on in the next chunk, nothing is reported then.
+   */
+  LJSON_STATE parse_token(const char* p, const char* end, bool last, const char** next);
+
+  /// close the innermost container
+  bool close();
+
+  void value_done() {
+    if (frames_.empty()) {
+      state_ = EXPECT_VALUE;
+    } else {
+      frames_.back().size++;
+      state_ = EXPECT_COMMA_OR_CLOSE;
+    }
+  }
+
+  LJSON_STATE fail(LJSON_STATE error) { return error_ = error; }
+
+  static bool is_number_char(char ch) {
+    return (ch >= '0' && ch <= '9') || ch == '-' || ch == '+' || ch == '.' || ch == 'e' || ch == 'E';
+  }
+
+  static bool is_literal_char(char ch) { return ch >= 'a' && ch <= 'z'; }
+
+  Handler& handler_;
+  /// tokenizer state, only its scratch stack is kept between tokens
+  ljson_context tokens_;
+  std::vector<ljson_context::frame> frames_;
+  size_t max_depth_;
+  parse_state state_;
+  LJSON_STATE error_;
+  /// beginning of a token cut by the end of a chunk
+  std::string carry_;
+  /// carry_ is a string ending inside an escape, right after '\\'
+  bool carry_escape_;
+  /// a number or literal ended at depth 0, the next value cannot follow it directly
+  bool need_delimiter_;
+};
+
+template<typename Handler>
+LJSON_STATE ljson_push_parser<Handler>::feed(const char* data, size_t len) {
+  if (error_ != LJSON_PARSE_OK)
+    return error_;
+  const char* p = data;
+  const char* end = data + len;
+  if (!carry_.empty()) {
+    // look for the end of the carried token in this chunk
+    const char* q = p;
+    bool complete = false;
+    if (carry_[0] == '"') {
+      for (;;) {
+        if (carry_escape_) {
+          if (q == end)
+            break;
+          q++;
+          carry_escape_ = false;
+        }
+        q = simd::scan_string<false>(q, end);
+        if (q == end)
+          break;
+        if (*q++ != '\\') {
+          complete = true;
+          break;
+        }
+        carry_escape_ = true;
+      }
+    } else {
+      bool number = is_number_char(carry_[0]);
+      while (q != end && (number ? is_number_char(*q) : is_literal_char(*q)))
+        q++;
+      complete = q != end;
+    }
+    carry_.append(p, q);
+    if (!complete)
+      return LJSON_PARSE_OK;
+    std::string token;
+    token.swap(carry_);
+    LJSON_STATE ret = consume(token.data(), token.data() + token.size(), true);
+    if (ret != LJSON_PARSE_OK)
+      return ret;
+    p = q;
+  }
+  return consume(p, end, false);
+}
+
+template<typename Handler>
+LJSON_STATE ljson_push_parser<Handler>::finish() {
+  if (error_ != LJSON_PARSE_OK)
+    return error_;
+  if (!carry_.empty()) {
+    std::string token;
+    token.swap(carry_);
+    LJSON_STATE ret = consume(token.data(), token.data() + token.size(), true);
+    if (ret != LJSON_PARSE_OK)
+      return ret;
+  }
+  switch (state_) {
+    case EXPECT_VALUE:
+      return frames_.empty() ? LJSON_PARSE_OK : fail(LJSON_PARSE_EXPECT_VALUE);
+    case EXPECT_VALUE_OR_CLOSE:
+      return fail(LJSON_PARSE_EXPECT_VALUE);
+    case EXPECT_KEY:
+    case EXPECT_KEY_OR_CLOSE:
+      return fail(LJSON_PARSE_MISS_KEY);
+    case EXPECT_COLON:
+      return fail(LJSON_PARSE_MISS_COLON);
+    default:
+      return fail(LJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET);
+  }
+}
+
+template<typename Handler>
+LJSON_STATE ljson_push_parser<Handler>::consume(const char* p, const char* end, bool last) {
+  while (p != end) {
+    // like ljson_context::parse_whitespace, a single space is the common case
+    if (simd::is_whitespace(*p)) {
+      need_delimiter_ = false;
+      if (++p != end && simd::is_whitespace(*p))
+        p = simd::skip_whitespace<false>(p, end);
+      if (p == end)
+        break;
+    }
+    char ch = *p;
+    switch (state_) {
+      case EXPECT_COLON:
+        if (ch != ':')
+          return fail(LJSON_PARSE_MISS_COLON);
+        p++;
+        state_ = EXPECT_VALUE;
+        continue;
+      case EXPECT_COMMA_OR_CLOSE: {
+        bool object = frames_.back().object;
+        if (ch == ',') {
+          p++;
+          state_ = object ? EXPECT_KEY : EXPECT_VALUE;
+          continue;
+        }
+        if (ch != (object ? '}' : ']'))
+          return fail(LJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET);
+        p++;
+        if (!close())
+          return fail(LJSON_PARSE_HANDLER_STOPPED);
+        continue;
+      }
+      case EXPECT_KEY_OR_CLOSE:
+        if (ch == '}') {
+          p++;
+          if (!close())
+            return fail(LJSON_PARSE_HANDLER_STOPPED);
+          continue;
+        }
+        // fall through
+      case EXPECT_KEY:
+        if (ch != '"')
+          return fail(LJSON_PARSE_MISS_KEY);
+        break;
+      case EXPECT_VALUE_OR_CLOSE:
+        if (ch == ']') {
+          p++;
+          if (!close())
+            return fail(LJSON_PARSE_HANDLER_STOPPED);
+          continue;
+        }
+        // fall through
+      case EXPECT_VALUE:
+        if (need_delimiter_) {
+          // "01" or "truefalse", a token with a valid prefix
+          if (ch != '[' && ch != '{' && ch != '"')
+            return fail(LJSON_PARSE_ROOT_NOT_SINGULAR);
+          need_delimiter_ = false;
+        }
+        if (ch == '[' || ch == '{') {
+          if (frames_.size() >= max_depth_)
+            return fail(LJSON_PARSE_NESTING_TOO_DEEP);
+          p++;
+          bool object = ch == '{';
+          if (!(object ? handler_.start_object() : handler_.start_array()))
+            return fail(LJSON_PARSE_HANDLER_STOPPED);
+          frames_.push_back(ljson_context::frame{object, 0});
+          state_ = object ? EXPECT_KEY_OR_CLOSE : EXPECT_VALUE_OR_CLOSE;
+          continue;
+        }
+        break;
+    }
+    // a string, number or literal starts at p
+    const char* next = nullptr;
+    LJSON_STATE ret = parse_token(p, end, last, &next);
+    if (ret != LJSON_PARSE_OK)
+      return fail(ret);
+    if (next == nullptr) {
+      carry_.assign(p, end);
+      return LJSON_PARSE_OK;
+    }
+    p = next;
+  }
+  return LJSON_PARSE_OK;
+}
+
+template<typename Handler>
+const char* ljson_push_parser<Handler>::token_end(const char* p, const char* end) {
+  const char* q = p + 1;
+  carry_escape_ = false;
+  if (*p == '"') {
+    for (;;) {
+      q = simd::scan_string<false>(q, end);
+      if (q == end)
+        return nullptr;
+      // a control character ends the token too, the tokenizer reports it
+      if (*q != '\\')
+        return q + 1;
+      if (end - q < 2) {
+        carry_escape_ = true;
+        return nullptr;
+      }
+      q += 2;
+    }
+  }
+  if (is_number_char(*p)) {
+    while (q != end && is_number_char(*q))
+      q++;
+  } else if (is_literal_char(*p)) {
+    while (q != end && is_literal_char(*q))
+      q++;
+  } else {
+    // not the start of any value
+    return q;
+  }
+  return q == end ? nullptr : q;
+}
+
+template<typename Handler>
+LJSON_STATE ljson_push_parser<Handler>::parse_token(const char* p, const char* end, bool last,
+                                                    const char** next) {
+  tokens_.json_ = p;
+  tokens_.end_ = end;
+  const char *str = nullptr;
+  size_t len = 0;
+  ljson_number_value number;
+  LJSON_STATE ret;
+  switch (*p) {
+    case '"':
+      ret = tokens_.parse_string_raw(&str, &len);
+      break;
+    case 'n':
+      ret = tokens_.parse_literal_raw("null");
+      break;
+    case 't':
+      ret = tokens_.parse_literal_raw("true");
+      break;
+    case 'f':
+      ret = tokens_.parse_literal_raw("false");
+      break;
+    default:
+      ret = tokens_.parse_number_raw(&number);
+      break;
+  }
+  // a closed string is complete, a number or literal up to end may go on
+  if (!last && (ret != LJSON_PARSE_OK || (tokens_.json_ == end && *p != '"')) && token_end(p, end) == nullptr) {
+    *next = nullptr;
+    return LJSON_PARSE_OK;
+  }
+  if (ret != LJSON_PARSE_OK)
+    return ret;
+  bool ok;
+  switch (*p) {
+    case '"':
+      if (state_ == EXPECT_KEY || state_ == EXPECT_KEY_OR_CLOSE) {
+        if (!handler_.key(str, len))
+          return LJSON_PARSE_HANDLER_STOPPED;
+        state_ = EXPECT_COLON;
+        *next = tokens_.json_;
+        return LJSON_PARSE_OK;
+      }
+      ok = handler_.string(str, len);
+      break;
+    case 'n':
+      ok = handler_.null();
+      break;
+    case 't':
+      ok = handler_.boolean(true);
+      break;
+    case 'f':
+      ok = handler_.boolean(false);
+      break;
+    default:
+      ok = handler_.number(number);
+      break;
+  }
+  if (!ok)
+    return LJSON_PARSE_HANDLER_STOPPED;
+  need_delimiter_ = frames_.empty() && *p != '"';
+  value_done();
+  // what is left of the token, like "1" in "01", goes through the grammar
+  *next = tokens_.json_;
+  return LJSON_PARSE_OK;
+}
+
+template<typename Handler>
+bool ljson_push_parser<Handler>::close() {
+  ljson_context::frame closed = frames_.back();
+  frames_.pop_back();
+  if (!(closed.object ? handler_.end_object(closed.size) : handler_.end_array(closed.size)))
+    return false;
+  value_done();
+  return true;
+}
+
+/*
+ * ljson_document_handler: push parser handler building one ljson_value
+ * document per value of the stream, each handed to on_document as soon as
+ * it closes. returning false from on_document stops the parser.
+ * after an error the half-built document is still held: reset() the
+ * handler together with the parser before feeding the next stream.
+ */
+class ljson_document_handler {
+public:
+  typedef std::function<bool(std::shared_ptr<ljson_value>)> callback;
+
+  explicit ljson_document_handler(callback on_document);
+  ~ljson_document_handler();
+
+  bool null();
+  bool boolean(bool b);
+  bool number(const ljson_number_value& number);
+  bool string(const char* str, size_t len);
+  bool key(const char* str, size_t len);
+  bool start_object();
+  bool end_object(size_t size);
+  bool start_array();
+  bool end_array(size_t size);
+
+  /// drop the document being built, to go with ljson_push_parser::reset()
+  void reset();
+
+private:
+  /// a value ended, pass it on when it is a whole document
+  bool value_done();
+
+  callback on_document_;
+  std::shared_ptr<ljson_arena> arena_;
+  /// scratch stacks of the builder
+  std::unique_ptr<ljson_context> context_;
+  size_t depth_;
+};
+
+} // namespace ljson
+
+#endif //LJSON_LJSON_PUSH_H_
@@ -0,0 +1,73 @@
+#ifndef LJSON_LJSON_SAX_H_
+#define LJSON_LJSON_SAX_H_
+
+#include "ljson.h"
+#include "ljson_context.h"
+#include "ljson_index.h"
+#include <cstring>
+
+namespace ljson {
+
+/*
+ * ljson_sax: parse without building a document, every token is reported to
+ * a handler as it is read. the handler is any type with these members:
+ *
+ *   bool null();
+ *   bool boolean(bool b);
+ *   bool number(const ljson_number_value& number);
+ *   bool string(const char* str, size_t len);
+ *   bool key(const char* str, size_t len);
+ *   bool start_object();
+ *   bool end_object(size_t member_count);
+ *   bool start_array();
+ *   bool end_array(size_t element_count);
+ *
+ * strings and keys are unescaped and not null-terminated, they are only
+ * valid during the call unless parsed insitu. returning false stops the
+ * parser with LJSON_PARSE_HANDLER_STOPPED, e.g. once the wanted fields are
+ * found. on an error the handler has seen the events up to it.
+ * the functions mirror ljson_value::parse and friends, engine included.
+ */
+struct ljson_sax {
+  template<typename Handler>
+  static LJSON_STATE parse(const char* json, Handler& handler, size_t max_depth = LJSON_PARSE_MAX_DEPTH,
+                           LJSON_ENGINE engine = LJSON_ENGINE_ONE_PASS) {
+    return parse_range(json, json + strlen(json), false, false, handler, max_depth, engine);
+  }
+
+  template<typename Handler>
+  static LJSON_STATE parse(const char* data, size_t len, Handler& handler,
+                           size_t max_depth = LJSON_PARSE_MAX_DEPTH, LJSON_ENGINE engine = LJSON_ENGINE_ONE_PASS) {
+    return parse_range(data, data + len, false, false, handler, max_depth, engine);
+  }
+
+  template<typename Handler>
+  static LJSON_STATE parse_padded(const char* data, size_t len, Handler& handler,
+                                  size_t max_depth = LJSON_PARSE_MAX_DEPTH,
+                                  LJSON_ENGINE engine = LJSON_ENGINE_ONE_PASS) {
+    return parse_range(data, data + len, false, true, handler, max_depth, engine);
+  }
+
+  /// strings stay valid as long as json
+  template<typename Handler>
+  static LJSON_STATE parse_insitu(char* json, Handler& handler, size_t max_depth = LJSON_PARSE_MAX_DEPTH,
+                                  LJSON_ENGINE engine = LJSON_ENGINE_ONE_PASS) {
+    return parse_range(json, json + strlen(json), true, false, handler, max_depth, engine);
+  }
+
+private:
+  template<typename Handler>
+  static LJSON_STATE parse_range(const char* json, const char* end, bool insitu, bool padded, Handler& handler,
+                                 size_t max_depth, LJSON_ENGINE engine) {
+    ljson_context context(json, end, nullptr, insitu, padded, max_depth);
+    LJSON_STATE ret = engine == LJSON_ENGINE_TWO_STAGE ? context.parse_root_indexed(handler)
+                                                       : context.parse_root(handler);
+    /// unescaped strings of a failed parse may be left on the stack
+    context.top_ = 0;
+    return ret;
+  }
+};
+
+} // namespace ljson
+
+#endif //LJSON_LJSON_SAX_H_
@@ -0,0 +1,297 @@
+#ifndef LJSON_LJSON_SIMD_H_
+#define LJSON_LJSON_SIMD_H_
+
+/*
+ * vectorized scanners used by the parser, internal header.
+ * the instruction set is chosen at compile time: AVX2 when the compiler
+ * targets it (e.g. -mavx2 or -march=native), SSE2 on any x86-64, plain
+ * scalar code elsewhere.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/*
+ * on unpadded input the scanners only issue aligned loads, an aligned load
+ * never crosses a page so reading the whole blocks holding the first and the
+ * last byte cannot fault, but address sanitizer still reports it.
+ */
+#if defined(__clang__) || defined(__GNUC__)
+#define LJSON_NO_SANITIZE_ADDRESS __attribute__((no_sanitize_address))
+#else
+#define LJSON_NO_SANITIZE_ADDRESS
+#endif
+
+namespace ljson {
+
+namespace simd {
+
+inline bool is_string_special(char ch) {
+  return ch == '"' || ch == '\\' || static_cast<unsigned char>(ch) < 0x20;
+}
+
+#if defined(__AVX2__)
+const size_t kBlockSize = 32;
+#elif defined(__SSE2__)
+const size_t kBlockSize = 16;
+#else
+const size_t kBlockSize = 1;
+#endif
+
+inline int count_trailing_zeros(uint32_t mask) { return __builtin_ctz(mask); }
+
+#if defined(__AVX2__)
+typedef __m256i block_t;
+LJSON_NO_SANITIZE_ADDRESS inline block_t load_block(const char* p) { return _mm256_load_si256(reinterpret_cast<const __m256i*>(p)); }
+inline block_t splat(char ch) { return _mm256_set1_epi8(ch); }
+inline block_t eq(block_t a, block_t b) { return _mm256_cmpeq_epi8(a, b); }
+inline block_t either(block_t a, block_t b) { return _mm256_or_si256(a, b); }
+/// unsigned a <= b
+inline block_t below_eq(block_t a, block_t b) { return _mm256_cmpeq_epi8(_mm256_min_epu8(a, b), a); }
+inline uint32_t to_mask(block_t a) { return static_cast<uint32_t>(_mm256_movemask_epi8(a)); }
+const uint32_t kFullMask = 0xFFFFFFFFu;
+#elif defined(__SSE2__)
+typedef __m128i block_t;
+LJSON_NO_SANITIZE_ADDRESS inline block_t load_block(const char* p) { return _mm_load_si128(reinterpret_cast<const __m128i*>(p)); }
+inline block_t splat(char ch) { return _mm_set1_epi8(ch); }
+inline block_t eq(block_t a, block_t b) { return _mm_cmpeq_epi8(a, b); }
+inline block_t either(block_t a, block_t b) { return _mm_or_si128(a, b); }
+/// unsigned a <= b
+inline block_t below_eq(block_t a, block_t b) { return _mm_cmpeq_epi8(_mm_min_epu8(a, b), a); }
+inline uint32_t to_mask(block_t a) { return static_cast<uint32_t>(_mm_movemask_epi8(a)); }
+const uint32_t kFullMask = 0xFFFFu;
+#endif
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#if defined(__AVX2__)
+inline block_t load_unaligned(const char* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+#else
+inline block_t load_unaligned(const char* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+#endif
+
+/*
+ * first position in [p, end) whose byte has its bit set in match(block),
+ * end when there is none.
+ * Padded: the input has at least kBlockSize readable bytes past end, blocks
+ * are loaded from p on. otherwise only aligned blocks are loaded, starting
+ * with the one holding p, they stay in the pages holding [p, end).
+ */
+template<bool Padded, typename Match>
+LJSON_NO_SANITIZE_ADDRESS inline const char* scan(const char* p, const char* end, Match match) {
+  if (p >= end)
+    return end;
+  const char* block = p;
+  uint32_t skip = kFullMask;
+  if (!Padded) {
+    // start from the block holding p, bytes before p are masked out
+    size_t offset = reinterpret_cast<uintptr_t>(p) & (kBlockSize - 1);
+    block = p - offset;
+    skip = (kFullMask << offset) & kFullMask;
+  }
+  for (;; block += kBlockSize, skip = kFullMask) {
+    uint32_t mask = match(Padded ? load_unaligned(block) : load_block(block)) & skip;
+    auto left = static_cast<size_t>(end - block);
+    if (left <= kBlockSize) {
+      // last block, bytes from end on are masked out
+      if (left < kBlockSize)
+        mask &= (1u << left) - 1;
+      return mask != 0 ? block + count_trailing_zeros(mask) : end;
+    }
+    if (mask != 0)
+      return block + count_trailing_zeros(mask);
+  }
+}
+#endif
+
+/*
+ * @return: first position in [p, end) holding '"', '\\' or a byte below 0x20,
+ *          end when there is none
+ */
+template<bool Padded = false>
+inline const char* scan_string(const char* p, const char* end) {
+#if defined(__AVX2__) || defined(__SSE2__)
+  const block_t quote = splat('"');
+  const block_t backslash = splat('\\');
+  const block_t control = splat(0x1F);
+  return scan<Padded>(p, end, [&](block_t s) {
+    return to_mask(either(either(eq(s, quote), eq(s, backslash)), below_eq(s, control)));
+  });
+#else
+  while (p < end && !is_string_special(*p))
+    p++;
+  return p;
+#endif
+}
+
+inline bool is_whitespace(char ch) {
+  return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r';
+}
+
+/*
+ * @return: first position in [p, end) that is not ' ', '\t', '\n' or '\r',
+ *          end when there is none
+ */
+template<bool Padded = false>
+inline const char* skip_whitespace(const char* p, const char* end) {
+#if defined(__AVX2__) || defined(__SSE2__)
+  const block_t space = splat(' ');
+  const block_t tab = splat('\t');
+  const block_t lf = splat('\n');
+  const block_t cr = splat('\r');
+  return scan<Padded>(p, end, [&](block_t s) {
+    return ~to_mask(either(either(eq(s, space), eq(s, tab)), either(eq(s, lf), eq(s, cr))));
+  });
+#else
+  while (p < end && is_whitespace(*p))
+    p++;
+  return p;
+#endif
+}
+
+/// bit i of each mask is set for the byte p[i] of a 64 byte stretch
+struct masks64 {
+  uint64_t quote;
+  uint64_t backslash;
+  /// '{', '}', '[', ']', ':' and ','
+  uint64_t op;
+  uint64_t whitespace;
+};
+
+inline bool is_op(char ch) {
+  return ch == '{' || ch == '}' || ch == '[' || ch == ']' || ch == ':' || ch == ',';
+}
+
+/// classify the 64 bytes from p on, they all have to be readable
+inline masks64 classify64(const char* p) {
+  masks64 m = {0, 0, 0, 0};
+#if defined(__AVX2__) || defined(__SSE2__)
+  const block_t quote = splat('"');
+  const block_t backslash = splat('\\');
+  const block_t lower = splat(0x20);
+  const block_t open = splat('{');
+  const block_t close = splat('}');
+  const block_t colon = splat(':');
+  const block_t comma = splat(',');
+  const block_t space = splat(' ');
+  const block_t tab = splat('\t');
+  const block_t lf = splat('\n');
+  const block_t cr = splat('\r');
+  for (size_t i = 0; i < 64; i += kBlockSize) {
+    block_t s = load_unaligned(p + i);
+#if defined(__AVX2__)
+    // '[' and ']' differ from '{' and '}' by the 0x20 bit only
+    block_t folded = _mm256_or_si256(s, lower);
+#else
+    block_t folded = _mm_or_si128(s, lower);
+#endif
+    m.quote |= static_cast<uint64_t>(to_mask(eq(s, quote))) << i;
+    m.backslash |= static_cast<uint64_t>(to_mask(eq(s, backslash))) << i;
+    m.op |= static_cast<uint64_t>(to_mask(either(either(eq(folded, open), eq(folded, close)),
+                                                 either(eq(s, colon), eq(s, comma))))) << i;
+    m.whitespace |= static_cast<uint64_t>(to_mask(either(either(eq(s, space), eq(s, tab)),
+                                                         either(eq(s, lf), eq(s, cr))))) << i;
+  }
+#else
+  for (size_t i = 0; i < 64; ++i) {
+    uint64_t bit = uint64_t(1) << i;
+    if (p[i] == '"')
+      m.quote |= bit;
+    else if (p[i] == '\\')
+      m.backslash |= bit;
+    else if (is_op(p[i]))
+      m.op |= bit;
+    else if (is_whitespace(p[i]))
+      m.whitespace |= bit;
+  }
+#endif
+  return m;
+}
+
+/// bit i of each mask is set for the byte p[i] of a 64 byte stretch
+struct brackets64 {
+  uint64_t quote;
+  uint64_t backslash;
+  /// '{' and '['
+  uint64_t open;
+  /// '}' and ']'
+  uint64_t close;
+};
+
+/// the brackets of the 64 bytes from p on, they all have to be readable
+inline brackets64 classify_brackets64(const char* p) {
+  brackets64 m = {0, 0, 0, 0};
+#if defined(__AVX2__) || defined(__SSE2__)
+  const block_t quote = splat('"');
+  const block_t backslash = splat('\\');
+  const block_t lower = splat(0x20);
+  const block_t open = splat('{');
+  const block_t close = splat('}');
+  for (size_t i = 0; i < 64; i += kBlockSize) {
+    block_t s = load_unaligned(p + i);
+    block_t folded = either(s, lower);
+    m.quote |= static_cast<uint64_t>(to_mask(eq(s, quote))) << i;
+    m.backslash |= static_cast<uint64_t>(to_mask(eq(s, backslash))) << i;
+    m.open |= static_cast<uint64_t>(to_mask(eq(folded, open))) << i;
+    m.close |= static_cast<uint64_t>(to_mask(eq(folded, close))) << i;
+  }
+#else
+  for (size_t i = 0; i < 64; ++i) {
+    uint64_t bit = uint64_t(1) << i;
+    if (p[i] == '"')
+      m.quote |= bit;
+    else if (p[i] == '\\')
+      m.backslash |= bit;
+    else if (p[i] == '{' || p[i] == '[')
+      m.open |= bit;
+    else if (p[i] == '}' || p[i] == ']')
+      m.close |= bit;
+  }
+#endif
+  return m;
+}
+
+/*
+ * @backslash: backslashes of a 64 byte stretch
+ * @carry: in, the first byte is escaped by the previous stretch. out, the
+ *         first byte of the next one is
+ * @return: the bytes escaped by a backslash: the odd ones after each run of
+ *          backslashes, counting from the start of the run
+ */
+inline uint64_t find_escaped(uint64_t backslash, uint64_t* carry) {
+  const uint64_t even_bits = 0x5555555555555555ULL;
+  // an escaped backslash starts nothing
+  backslash &= ~*carry;
+  uint64_t follows_escape = backslash << 1 | *carry;
+  // runs starting on an odd bit, their carry out of the add flips the parity
+  uint64_t odd_starts = backslash & ~even_bits & ~follows_escape;
+  uint64_t sequences_starting_on_even_bits;
+  *carry = __builtin_add_overflow(odd_starts, backslash, &sequences_starting_on_even_bits) ? 1 : 0;
+  uint64_t invert_mask = sequences_starting_on_even_bits << 1;
+  return (even_bits ^ invert_mask) & follows_escape;
+}
+
+/// bit i of the result is the xor of bits 0 to i of x
+inline uint64_t prefix_xor(uint64_t x) {
+#if defined(__PCLMUL__)
+  __m128i all_ones = _mm_set1_epi8(static_cast<char>(0xFF));
+  return static_cast<uint64_t>(_mm_cvtsi128_si64(_mm_clmulepi64_si128(_mm_set_epi64x(0, x), all_ones, 0)));
+#else
+  x ^= x << 1;
+  x ^= x << 2;
+  x ^= x << 4;
+  x ^= x << 8;
+  x ^= x << 16;
+  x ^= x << 32;
+  return x;
+#endif
+}
+
+} // namespace simd
+
+} // namespace ljson
+
+#endif //LJSON_LJSON_SIMD_H_
@@ -0,0 +1,166 @@
+#include "ljson_tape.h"
+#include "ljson_context.h"
+#include "ljson_file.h"
+#include "ljson_index.h"
+#include <cstring> // memcpy(), strlen()
+
+namespace ljson {
+
+namespace {
+
+/*
+ * every value but a number takes one word for at least one byte of input, a
+ * number takes two words and is followed by a ',', ']', '}' or the end.
+ */
+size_t tape_capacity(size_t len) { return len + 2; }
+
+/// a string of n bytes between its quotes takes at most n + 5 bytes of the buffer
+size_t strings_capacity(size_t len) { return len / 2 * 5 + 8; }
+
+}
+
+ljson_tape::ljson_tape(size_t len)
+  : tape_(new uint64_t[tape_capacity(len)]), strings_(new char[strings_capacity(len)]), size_(0) {}
+
+/*
+ * appends to the tape of the document. open containers keep the index of
+ * their open word on the byte stack, their close word patches it.
+ */
+struct ljson_context::tape_builder {
+  typedef ljson_tape_value::tag tag;
+
+  tape_builder(ljson_context *context, ljson_tape *tape)
+    : c(context), doc_(tape), tape_(tape->tape_.get()), strings_(tape->strings_.get()), next_(0),
+      strings_size_(0) {}
+
+  /// an empty document with room for an input of len bytes
+  static ljson_tape* create(size_t len) { return new ljson_tape(len); }
+
+  bool null() { return append(ljson_tape_value::TAG_NULL, 0); }
+
+  bool boolean(bool b) { return append(b ? ljson_tape_value::TAG_TRUE : ljson_tape_value::TAG_FALSE, 0); }
+
+  bool number(const ljson_number_value& number) {
+    uint64_t bits;
+    switch (number.type) {
+      case LJSON_NUMBER_INT64:
+        append(ljson_tape_value::TAG_INT64, 0);
+        bits = static_cast<uint64_t>(number.int64);
+        break;
+      case LJSON_NUMBER_UINT64:
+        append(ljson_tape_value::TAG_UINT64, 0);
+        bits = number.uint64;
+        break;
+      default:
+        append(ljson_tape_value::TAG_DOUBLE, 0);
+        memcpy(&bits, &number.number, sizeof(bits));
+        break;
+    }
+    tape_[next_++] = bits;
+    return true;
+  }
+
+  bool string(const char *str, size_t len) {
+    append(ljson_tape_value::TAG_STRING, strings_size_);
+    char *p = strings_ + strings_size_;
+    if (len < UINT32_MAX) {
+      uint32_t short_len = static_cast<uint32_t>(len);
+      memcpy(p, &short_len, sizeof(short_len));
+      p += sizeof(short_len);
+    } else {
+      uint32_t mark = UINT32_MAX;
+      uint64_t long_len = len;
+      memcpy(p, &mark, sizeof(mark));
+      memcpy(p + sizeof(mark), &long_len, sizeof(long_len));
+      p += sizeof(mark) + sizeof(long_len);
+    }
+    memcpy(p, str, len);
+    p[len] = '\0';
+    strings_size_ = p + len + 1 - strings_;
+    return true;
+  }
+
+  bool key(const char *str, size_t len) { return string(str, len); }
+
+  bool start_array() { return open(ljson_tape_value::TAG_START_ARRAY); }
+
+  bool end_array(size_t size) { return close(ljson_tape_value::TAG_END_ARRAY, size); }
+
+  bool start_object() { return open(ljson_tape_value::TAG_START_OBJECT); }
+
+  bool end_object(size_t size) { return close(ljson_tape_value::TAG_END_OBJECT, size); }
+
+  bool open(tag t) {
+    memcpy(c->push(sizeof(next_)), &next_, sizeof(next_));
+    return append(t, 0);
+  }
+
+  bool close(tag t, size_t size) {
+    size_t open_index;
+    memcpy(&open_index, c->pop(sizeof(open_index)), sizeof(open_index));
+    tape_[open_index] |= next_;
+    return append(t, size);
+  }
+
+  bool append(tag t, uint64_t payload) {
+    assert(payload <= ljson_tape_value::kPayloadMask);
+    tape_[next_++] = (static_cast<uint64_t>(t) << 56) | payload;
+    return true;
+  }
+
+  /// once parsing succeeded
+  void finish() { doc_->size_ = next_; }
+
+  ljson_context *c;
+  ljson_tape *doc_;
+  uint64_t *tape_;
+  char *strings_;
+  size_t next_;
+  size_t strings_size_;
+};
+
+namespace {
+
+/// @end: one past the last byte of the input, no terminator is needed
+std::shared_ptr<ljson_tape> parse_tape(const char *json, const char *end, bool padded, size_t max_depth,
+                                       LJSON_ENGINE engine, int *ret) {
+  std::shared_ptr<ljson_tape> tape(ljson_context::tape_builder::create(end - json));
+  /// no arena: strings are copied into the tape as soon as they are parsed
+  ljson_context context(json, end, nullptr, false, padded, max_depth);
+  ljson_context::tape_builder builder(&context, tape.get());
+  *ret = engine == LJSON_ENGINE_TWO_STAGE ? context.parse_root_indexed(builder) : context.parse_root(builder);
+  if (*ret == LJSON_PARSE_OK) {
+    builder.finish();
+    return tape;
+  }
+  /// drop the open containers left
+  context.top_ = 0;
+  return nullptr;
+}
+
+}
+
+std::shared_ptr<ljson_tape> ljson_tape::parse(const char *json, int *ret, size_t max_depth, LJSON_ENGINE engine) {
+  return parse_tape(json, json + strlen(json), false, max_depth, engine, ret);
+}
+
+std::shared_ptr<ljson_tape> ljson_tape::parse(const char *data, size_t len, int *ret, size_t max_depth,
+                                              LJSON_ENGINE engine) {
+  return parse_tape(data, data + len, false, max_depth, engine, ret);
+}
+
+std::shared_ptr<ljson_tape> ljson_tape::parse_padded(const char *data, size_t len, int *ret, size_t max_depth,
+                                                     LJSON_ENGINE engine) {
+  return parse_tape(data, data + len, true, max_depth, engine, ret);
+}
+
+std::shared_ptr<ljson_tape> ljson_tape::parse_file(const char *path, int *ret, size_t max_depth, LJSON_ENGINE engine) {
+  auto file = ljson_mapped_file::open(path);
+  if (file == nullptr) {
+    *ret = LJSON_FILE_ERROR;
+    return nullptr;
+  }
+  return parse_tape(file->data(), file->data() + file->size(), file->padded(), max_depth, engine, ret);
+}
+
+} // namespace ljson
@@ -0,0 +1,247 @@
+#ifndef LJSON_LJSON_TAPE_H_
+#define LJSON_LJSON_TAPE_H_
+
+/*
+ * ljson_tape: a parsed document as a flat tape of 64-bit words plus a buffer
+ * of strings, instead of a tree of nodes. every value takes one word with
+ * its tag in the high byte, numbers take a second word with their bits.
+ * an array or object is an open word holding the index of its close word,
+ * and a close word holding the number of elements or members, so a whole
+ * subtree is skipped in O(1). strings are stored in the buffer as their
+ * length, 4 bytes (12 from 4GiB on), then their bytes and a '\0'.
+ *
+ * both arrays are allocated once per document, for the worst case of the
+ * input length: only the part actually used is touched.
+ */
+
+#include "ljson.h"
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+namespace ljson {
+
+class ljson_tape;
+struct ljson_tape_member;
+
+/// a value of a ljson_tape, a cheap handle valid as long as its document
+class ljson_tape_value {
+public:
+  /// tags in the high byte of a tape word
+  enum tag : uint8_t {
+    TAG_NULL = 'n',
+    TAG_TRUE = 't',
+    TAG_FALSE = 'f',
+    TAG_DOUBLE = 'd',
+    TAG_INT64 = 'l',
+    TAG_UINT64 = 'u',
+    TAG_STRING = '"',
+    TAG_START_ARRAY = '[',
+    TAG_END_ARRAY = ']',
+    TAG_START_OBJECT = '{',
+    TAG_END_OBJECT = '}',
+  };
+  static const uint64_t kPayloadMask = (uint64_t(1) << 56) - 1;
+
+  ljson_tape_value(const ljson_tape* tape, size_t index) : tape_(tape), index_(index) {}
+
+  inline LJSON_TYPE get_type() const;
+
+  /// any number type, integers above 2^53 are rounded
+  double get_number() const { return number_value().to_double(); }
+
+  inline LJSON_NUMBER_TYPE get_number_type() const;
+
+  bool is_int64() const { return number_value().is_int64(); }
+
+  bool is_uint64() const { return number_value().is_uint64(); }
+
+  int64_t get_int64() const { return number_value().to_int64(); }
+
+  uint64_t get_uint64() const { return number_value().to_uint64(); }
+
+  /// null-terminated, embedded '\0' are kept: see get_string_length()
+  inline const char* get_string() const;
+
+  inline size_t get_string_length() const;
+
+  /// number of array elements or object members
+  inline size_t size() const;
+
+  /// O(index), each element before it is skipped in O(1)
+  inline ljson_tape_value operator[](size_t index) const;
+
+  /// O(index) like operator[]
+  inline ljson_tape_member get_member(size_t index) const;
+
+  /// the value following this one on the tape, past its whole subtree
+  inline ljson_tape_value next() const;
+
+  /// position on the tape
+  size_t index() const { return index_; }
+
+private:
+  inline uint64_t word() const;
+  inline uint8_t tag_of() const { return static_cast<uint8_t>(word() >> 56); }
+  inline ljson_number_value number_value() const;
+  inline const char* string_at() const;
+
+  const ljson_tape* tape_;
+  size_t index_;
+};
+
+struct ljson_tape_member {
+  ljson_tape_value key;    /* always a string */
+  ljson_tape_value value;
+};
+
+class ljson_tape {
+public:
+  ljson_tape(const ljson_tape&) = delete;
+  ljson_tape& operator=(const ljson_tape&) = delete;
+
+  ljson_tape_value root() const { return ljson_tape_value(this, 0); }
+
+  const uint64_t* words() const { return tape_.get(); }
+
+  /// number of words used
+  size_t size() const { return size_; }
+
+  const char* strings() const { return strings_.get(); }
+
+  /// same contract as ljson_value::parse, strings are copied out of json
+  static std::shared_ptr<ljson_tape> parse(const char* json, int *ret,
+                                           size_t max_depth = LJSON_PARSE_MAX_DEPTH,
+                                           LJSON_ENGINE engine = LJSON_ENGINE_ONE_PASS);
+
+  /// same contract as ljson_value::parse(data, len, ret)
+  static std::shared_ptr<ljson_tape> parse(const char* data, size_t len, int *ret,
+                                           size_t max_depth = LJSON_PARSE_MAX_DEPTH,
+                                           LJSON_ENGINE engine = LJSON_ENGINE_ONE_PASS);
+
+  /// same contract as ljson_value::parse_padded
+  static std::shared_ptr<ljson_tape> parse_padded(const char* data, size_t len, int *ret,
+                                                  size_t max_depth = LJSON_PARSE_MAX_DEPTH,
+                                                  LJSON_ENGINE engine = LJSON_ENGINE_ONE_PASS);
+
+  /// same contract as ljson_value::parse_file, the tape always holds its own strings
+  static std::shared_ptr<ljson_tape> parse_file(const char* path, int *ret,
+                                                size_t max_depth = LJSON_PARSE_MAX_DEPTH,
+                                                LJSON_ENGINE engine = LJSON_ENGINE_ONE_PASS);
+
+private:
+  friend struct ljson_context;
+
+  /// room for the worst case of an input of len bytes
+  explicit ljson_tape(size_t len);
+
+  std::unique_ptr<uint64_t[]> tape_;
+  std::unique_ptr<char[]> strings_;
+  size_t size_;
+};
+
+uint64_t ljson_tape_value::word() const {
+  assert(index_ < tape_->size());
+  return tape_->words()[index_];
+}
+
+LJSON_TYPE ljson_tape_value::get_type() const {
+  switch (tag_of()) {
+    case TAG_NULL: return LJSON_NULL;
+    case TAG_TRUE: return LJSON_TRUE;
+    case TAG_FALSE: return LJSON_FALSE;
+    case TAG_STRING: return LJSON_STRING;
+    case TAG_START_ARRAY: return LJSON_ARRAY;
+    case TAG_START_OBJECT: return LJSON_OBJECT;
+    default:
+      assert(tag_of() == TAG_DOUBLE || tag_of() == TAG_INT64 || tag_of() == TAG_UINT64);
+      return LJSON_NUMBER;
+  }
+}
+
+LJSON_NUMBER_TYPE ljson_tape_value::get_number_type() const {
+  switch (tag_of()) {
+    case TAG_INT64: return LJSON_NUMBER_INT64;
+    case TAG_UINT64: return LJSON_NUMBER_UINT64;
+    default:
+      assert(tag_of() == TAG_DOUBLE);
+      return LJSON_NUMBER_DOUBLE;
+  }
+}
+
+ljson_number_value ljson_tape_value::number_value() const {
+  ljson_number_value value;
+  value.type = get_number_type();
+  /// the bits of the number follow its tag word
+  uint64_t bits = tape_->words()[index_ + 1];
+  switch (value.type) {
+    case LJSON_NUMBER_INT64: value.int64 = static_cast<int64_t>(bits); break;
+    case LJSON_NUMBER_UINT64: value.uint64 = bits; break;
+    default: memcpy(&value.number, &bits, sizeof(bits)); break;
+  }
+  return value;
+}
+
+const char* ljson_tape_value::string_at() const {
+  assert(tag_of() == TAG_STRING);
+  return tape_->strings() + (word() & kPayloadMask);
+}
+
+const char* ljson_tape_value::get_string() const {
+  const char* p = string_at();
+  uint32_t len;
+  memcpy(&len, p, sizeof(len));
+  return p + (len != UINT32_MAX ? sizeof(uint32_t) : sizeof(uint32_t) + sizeof(uint64_t));
+}
+
+size_t ljson_tape_value::get_string_length() const {
+  const char* p = string_at();
+  uint32_t len;
+  memcpy(&len, p, sizeof(len));
+  if (len != UINT32_MAX)
+    return len;
+  uint64_t long_len;
+  memcpy(&long_len, p + sizeof(uint32_t), sizeof(long_len));
+  return static_cast<size_t>(long_len);
+}
+
+size_t ljson_tape_value::size() const {
+  assert(tag_of() == TAG_START_ARRAY || tag_of() == TAG_START_OBJECT);
+  return static_cast<size_t>(tape_->words()[word() & kPayloadMask] & kPayloadMask);
+}
+
+ljson_tape_value ljson_tape_value::next() const {
+  switch (tag_of()) {
+    case TAG_START_ARRAY:
+    case TAG_START_OBJECT:
+      return ljson_tape_value(tape_, (word() & kPayloadMask) + 1);
+    case TAG_DOUBLE:
+    case TAG_INT64:
+    case TAG_UINT64:
+      return ljson_tape_value(tape_, index_ + 2);
+    default:
+      return ljson_tape_value(tape_, index_ + 1);
+  }
+}
+
+ljson_tape_value ljson_tape_value::operator[](size_t index) const {
+  assert(get_type() == LJSON_ARRAY && index < size());
+  ljson_tape_value v(tape_, index_ + 1);
+  while (index-- != 0)
+    v = v.next();
+  return v;
+}
+
+ljson_tape_member ljson_tape_value::get_member(size_t index) const {
+  assert(get_type() == LJSON_OBJECT && index < size());
+  /// keys are strings, one word each
+  ljson_tape_value key(tape_, index_ + 1);
+  while (index-- != 0)
+    key = ljson_tape_value(tape_, key.index_ + 1).next();
+  return ljson_tape_member{key, ljson_tape_value(tape_, key.index_ + 1)};
+}
+
+} // namespace ljson
+
+#endif //LJSON_LJSON_TAPE_H_
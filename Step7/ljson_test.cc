@@ -2,7 +2,29 @@
 // Created by 刘文景 on 2021/7/3.
 //
 #include "ljson.h"
+#include "ljson_file.h"
+#include "ljson_generator.h"
+#include "ljson_index.h"
+#include "ljson_ndjson.h"
+#include "ljson_ondemand.h"
+#include "ljson_parser.h"
+#include "ljson_push.h"
+#include "ljson_sax.h"
+#include "ljson_tape.h"
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <iterator>
+#include <thread>
+#if defined(__unix__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 using namespace ljson;
 
@@ -47,6 +69,9 @@ do { \
 #define EXPECT_TRUE(actual) EXPECT_EQ_BASE((actual) != 0, "true", "false", "%s")
 #define EXPECT_FALSE(actual) EXPECT_EQ_BASE((actual) != 0, "false", "true", "%s")
 
+#define EXPECT_EQ_INT64(expect, actual) EXPECT_EQ_BASE((expect) == (actual), (long long) (expect), (long long) (actual), "%lld")
+#define EXPECT_EQ_UINT64(expect, actual) EXPECT_EQ_BASE((expect) == (actual), (unsigned long long) (expect), (unsigned long long) (actual), "%llu")
+
 #define EXPECT_EQ_SIZE_T(expect, actual) EXPECT_EQ_BASE((expect) == (actual), (size_t) expect, (size_t)actual, "%zu")
 
 static void test_parse_null() {
@@ -113,6 +138,97 @@ static void test_parse_number() {
   TEST_NUMBER(-1.7976931348623157e+308, "-1.7976931348623157e+308");
 }
 
+#define TEST_INT64(expect, json)\
+    do {\
+        int ret = LJSON_PARSE_OK;\
+        auto value = ljson_value::parse(json, &ret);\
+        EXPECT_EQ_INT(LJSON_PARSE_OK, ret);\
+        EXPECT_EQ_INT(LJSON_NUMBER, value->get_type());\
+        auto& number = static_cast<const ljson_number&>(*value);\
+        EXPECT_EQ_INT(LJSON_NUMBER_INT64, number.get_number_type());\
+        EXPECT_EQ_INT64(expect, number.get_int64());\
+        EXPECT_EQ_DOUBLE(static_cast<double>(expect), number.get_double());\
+        auto compact = ljson_compact_value::parse(json, &ret);\
+        EXPECT_EQ_INT(LJSON_NUMBER_INT64, compact->get_number_type());\
+        EXPECT_EQ_INT64(expect, compact->get_int64());\
+    } while(0)
+
+#define TEST_UINT64(expect, json)\
+    do {\
+        int ret = LJSON_PARSE_OK;\
+        auto value = ljson_value::parse(json, &ret);\
+        EXPECT_EQ_INT(LJSON_PARSE_OK, ret);\
+        auto& number = static_cast<const ljson_number&>(*value);\
+        EXPECT_EQ_INT(LJSON_NUMBER_UINT64, number.get_number_type());\
+        EXPECT_TRUE(!number.is_int64());\
+        EXPECT_EQ_UINT64(expect, number.get_uint64());\
+        auto compact = ljson_compact_value::parse(json, &ret);\
+        EXPECT_EQ_INT(LJSON_NUMBER_UINT64, compact->get_number_type());\
+        EXPECT_EQ_UINT64(expect, compact->get_uint64());\
+    } while(0)
+
+#define TEST_NOT_INTEGER(expect, json)\
+    do {\
+        int ret = LJSON_PARSE_OK;\
+        auto value = ljson_value::parse(json, &ret);\
+        EXPECT_EQ_INT(LJSON_PARSE_OK, ret);\
+        auto& number = static_cast<const ljson_number&>(*value);\
+        EXPECT_EQ_INT(LJSON_NUMBER_DOUBLE, number.get_number_type());\
+        EXPECT_EQ_DOUBLE(expect, number.get_double());\
+    } while(0)
+
+static void test_parse_integer() {
+  TEST_INT64(0, "0");
+  TEST_INT64(1, "1");
+  TEST_INT64(-1, "-1");
+  TEST_INT64(1234567890, "1234567890");
+  TEST_INT64(9007199254740993LL, "9007199254740993"); /* 2^53 + 1, not a double */
+  TEST_INT64(1541815603606036480LL, "1541815603606036480"); /* snowflake id */
+  TEST_INT64(-1541815603606036481LL, "-1541815603606036481");
+  TEST_INT64(INT64_MAX, "9223372036854775807");
+  TEST_INT64(INT64_MIN, "-9223372036854775808");
+  TEST_UINT64(9223372036854775808ULL, "9223372036854775808");
+  TEST_UINT64(UINT64_MAX, "18446744073709551615");
+  TEST_UINT64(10000000000000000000ULL, "10000000000000000000");
+  TEST_NOT_INTEGER(18446744073709551616.0, "18446744073709551616");
+  TEST_NOT_INTEGER(99999999999999999999.0, "99999999999999999999");
+  TEST_NOT_INTEGER(-9223372036854775809.0, "-9223372036854775809");
+  TEST_NOT_INTEGER(100000000000000000000000.0, "100000000000000000000000");
+  TEST_NOT_INTEGER(1.0, "1.0");
+  TEST_NOT_INTEGER(100.0, "1e2");
+  TEST_NOT_INTEGER(0.0, "-0");
+
+  int ret = LJSON_PARSE_OK;
+  auto value = ljson_value::parse("[9007199254740993, -2, 18446744073709551615]", &ret);
+  auto elements = ljson_array::get_value_helper(value->get_value());
+  EXPECT_EQ_INT64(9007199254740993LL, static_cast<const ljson_number&>(*elements[0]).get_int64());
+  EXPECT_TRUE(static_cast<const ljson_number&>(*elements[1]).is_int64());
+  EXPECT_TRUE(!static_cast<const ljson_number&>(*elements[1]).is_uint64());
+  EXPECT_TRUE(static_cast<const ljson_number&>(*elements[2]).is_uint64());
+  EXPECT_EQ_DOUBLE(18446744073709551615.0, ljson_number::get_value_helper(elements[2]->get_value()));
+}
+
+/// inputs the fast paths cannot decide alone, expected values are correctly rounded
+static void test_parse_number_exact() {
+  TEST_NUMBER(9007199254740992.0, "9007199254740993"); /* halfway, ties to even */
+  TEST_NUMBER(9007199254740994.0, "9007199254740993.0000000000000000001");
+  TEST_NUMBER(9007199254740996.0, "9007199254740995");
+  TEST_NUMBER(1e23, "1e23");
+  TEST_NUMBER(1e23, "100000000000000000000000");
+  TEST_NUMBER(8.98846567431158e307, "8.98846567431158e307");
+  TEST_NUMBER(1.7976931348623157e+308, "1.7976931348623158e308"); /* rounds down to max double */
+  TEST_NUMBER(0.1, "0.1000000000000000055511151231257827021181583404541015625");
+  TEST_NUMBER(0.30000000000000004, "0.3000000000000000444089209850062616169452667236328125");
+  TEST_NUMBER(123456789012345678901234567890.0, "123456789012345678901234567890");
+  TEST_NUMBER(1.0, "1.00000000000000000000000000000000000000000000000000000000000000000000000000000000");
+  TEST_NUMBER(0.0, "0.000000000000000000000000000000000000000000001e-300");
+  TEST_NUMBER(4.9406564584124654e-324, "3e-324"); /* above halfway, rounds up to the minimum denormal */
+  TEST_NUMBER(0.0, "2.4703282292062327e-324"); /* just below halfway */
+  TEST_NUMBER(4.9406564584124654e-324, "2.4703282292062327208828439643411068618252990130716238221279284125033775363510437593264991818081799618989828234772285886546332835517796989819938739800539093906315035659515570226392290858392449105184435931802849936536152500319370457678249219365623669863658480757001585769269903706311928279558551332927834338409351978015531246597263579574622766465272827220056374006485499977096599470454020828166226237857393450736339007967761930577506740176324673600968951340535537458516661134223766678604162159680461914467291840300530057530849048765391711386591646239524912623653881879636239373280423891018672348497668235089863388587925628302755995657524455507255189313690836254779186948667994968324049705821028513185451396213837722826145437693412532098591327667236328125001e-324");
+  TEST_NUMBER(2.2250738585072011e-308, "2.2250738585072011e-308");
+  TEST_NUMBER(2.2250738585072012e-308, "2.2250738585072012e-308");
+}
+
 #define TEST_STRING(expect, json)\
     do {\
         int ret = 0;\
@@ -137,6 +253,291 @@ static void test_parse_string() {
   TEST_STRING("\xF0\x9D\x84\x9E", "\"\\ud834\\udd1e\"");  /* G clef sign U+1D11E */
 }
 
+/*
+ * a quote, an escape or a control character (cycling through 0x01..0x1F)
+ * at every offset of strings of every length up to 80, crossing the vector
+ * block boundaries, with the string starting at every alignment of a 32
+ * byte block.
+ */
+static void test_parse_string_blocks() {
+  std::vector<char> storage(64 + 100 + LJSON_PADDING + 1);
+  char* aligned = storage.data() + (64 - reinterpret_cast<uintptr_t>(storage.data()) % 64) % 64;
+  int checked = 0;
+  for (size_t len = 0; len <= 80; ++len) {
+    bool all = true;
+    for (size_t pos = 0; pos <= len; ++pos) {
+      for (int kind = 0; kind < 4; ++kind) {
+        if (pos == len && kind != 0)
+          continue;  /* no special byte at all */
+        std::string body;
+        for (size_t i = 0; i < len; ++i)
+          body += static_cast<char>('a' + i % 26);
+        std::string expect = body;
+        int error = LJSON_PARSE_OK;
+        if (pos < len) {
+          switch (kind) {
+            case 0: body.replace(pos, 1, "\\\""); expect[pos] = '"'; break;
+            case 1: body.replace(pos, 1, "\\n"); expect[pos] = '\n'; break;
+            case 2: body[pos] = static_cast<char>(1 + (len + pos) % 31); error = LJSON_PARSE_INVALID_STRING_CHAR; break;
+            default: body[pos] = '"'; error = LJSON_PARSE_ROOT_NOT_SINGULAR; break;
+          }
+        }
+        std::string json = "\"" + body + "\"";
+        char* p = aligned + (len + pos + kind) % 32;
+        memset(aligned, ' ', storage.data() + storage.size() - aligned);
+        memcpy(p, json.data(), json.size());
+        p[json.size()] = '\0';
+        for (int entry = 0; entry < 4; ++entry) {
+          int ret = LJSON_PARSE_OK;
+          std::shared_ptr<ljson_value> value;
+          switch (entry) {
+            case 0: value = ljson_value::parse(p, &ret); break;
+            case 1: value = ljson_value::parse(p, json.size(), &ret); break;
+            case 2: value = ljson_value::parse_padded(p, json.size(), &ret); break;
+            default: value = ljson_value::parse_insitu(p, &ret); break;  /* last, it rewrites p */
+          }
+          all = all && ret == error && (error != LJSON_PARSE_OK || (value->get_type() == LJSON_STRING &&
+                                        ljson_string::get_value_helper(value->get_value()) == expect));
+          checked++;
+        }
+      }
+    }
+    EXPECT_TRUE(all);
+  }
+  EXPECT_TRUE(checked > 30000);
+}
+
+#define TEST_INSITU_STRING(expect, json)\
+    do {\
+        int ret = 0;\
+        std::string buffer(json);\
+        auto value = ljson_value::parse_insitu(&buffer[0], &ret);\
+        EXPECT_EQ_INT(LJSON_PARSE_OK, ret);\
+        EXPECT_EQ_INT(LJSON_STRING, value->get_type());\
+        auto str = ljson_string::get_value_helper(value->get_value());\
+        EXPECT_EQ_STRING(expect, str);\
+    } while(0)
+
+static void test_parse_insitu_string() {
+  TEST_INSITU_STRING("","\"\"");
+  TEST_INSITU_STRING("Hello", "\"Hello\"");
+  TEST_INSITU_STRING("Hello\nWorld", "\"Hello\\nWorld\"");
+  TEST_INSITU_STRING("\" \\ / \b \f \n \r \t", "\"\\\" \\\\ \\/ \\b \\f \\n \\r \\t\"");
+  std::string test_str("Hello\0World",11);
+  TEST_INSITU_STRING(test_str, "\"Hello\\u0000World\"");
+  TEST_INSITU_STRING("\x24", "\"\\u0024\"");
+  TEST_INSITU_STRING("\xC2\xA2", "\"\\u00A2\"");
+  TEST_INSITU_STRING("\xE2\x82\xAC", "\"\\u20AC\"");
+  TEST_INSITU_STRING("\xF0\x9D\x84\x9E", "\"\\uD834\\uDD1E\"");
+  TEST_INSITU_STRING("a\xF0\x9D\x84\x9E" "b\tc", "\"a\\ud834\\udd1eb\\tc\"");
+}
+
+static void test_parse_insitu() {
+  char json[] = "{ \"key\" : [ \"plain\", \"esc\\naped\" ], \"k\\u0065y\" : 1 }";
+  int ret = LJSON_PARSE_OK;
+  auto value = ljson_compact_value::parse_insitu(json, &ret);
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+  EXPECT_EQ_SIZE_T(2, value->size());
+  /* strings and keys point into the input buffer */
+  auto& first = value->get_member(0);
+  EXPECT_TRUE(first.key.get_string() == json + 3);
+  EXPECT_EQ_SIZE_T(3, first.key.get_string_length());
+  auto& plain = first.value[0];
+  EXPECT_TRUE(plain.get_string() >= json && plain.get_string() < json + sizeof(json));
+  EXPECT_EQ_STRING("plain", std::string(plain.get_string(), plain.get_string_length()));
+  auto& escaped = first.value[1];
+  EXPECT_TRUE(escaped.get_string() >= json && escaped.get_string() < json + sizeof(json));
+  EXPECT_EQ_STRING("esc\naped", std::string(escaped.get_string(), escaped.get_string_length()));
+  auto& second = value->get_member(1);
+  EXPECT_EQ_STRING("key", std::string(second.key.get_string(), second.key.get_string_length()));
+  EXPECT_EQ_DOUBLE(1.0, second.value.get_number());
+
+  char object[] = "{ \"a\\tb\" : \"c\" }";
+  auto doc = ljson_value::parse_insitu(object, &ret);
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+  auto members = ljson_objects::get_value_helper(doc->get_value());
+  EXPECT_EQ_STRING("a\tb", members[0]->key);
+  EXPECT_EQ_STRING("c", ljson_string::get_value_helper(members[0]->value->get_value()));
+}
+
+#define TEST_INSITU_ERROR(error, json)\
+    do {\
+        int ret = LJSON_PARSE_OK;\
+        std::string buffer(json);\
+        auto value = ljson_value::parse_insitu(&buffer[0], &ret);\
+        EXPECT_EQ_INT(error, ret);\
+        EXPECT_NULL(value);\
+    } while(0)
+
+static void test_parse_insitu_error() {
+  TEST_INSITU_ERROR(LJSON_PARSE_MISS_QUOTATION_MARK, "\"abs");
+  TEST_INSITU_ERROR(LJSON_PARSE_MISS_QUOTATION_MARK, "\"a\\nbs");
+  TEST_INSITU_ERROR(LJSON_PARSE_INVALID_STRING_ESCAPE, "\"\\v\"");
+  TEST_INSITU_ERROR(LJSON_PARSE_INVALID_STRING_CHAR, "\"a\\n\x01\"");
+  TEST_INSITU_ERROR(LJSON_PARSE_INVALID_UNICODE_HEX, "\"\\u012\"");
+  TEST_INSITU_ERROR(LJSON_PARSE_INVALID_UNICODE_SURROGATE, "\"\\uD800\\uE000\"");
+  TEST_INSITU_ERROR(LJSON_PARSE_MISS_COLON, "{\"a\"}");
+}
+
+static void test_parse_whitespace() {
+  /* runs of every length, crossing the vector block boundaries */
+  for (size_t n = 0; n < 80; ++n) {
+    std::string ws;
+    for (size_t i = 0; i < n; ++i)
+      ws += " \t\n\r"[i % 4];
+    std::string json = ws + "[" + ws + "1" + ws + "," + ws + "{" + ws + "\"a\"" + ws + ":" + ws + "null" + ws + "}" + ws + "]" + ws;
+    int ret = LJSON_PARSE_OK;
+    auto value = ljson_value::parse(json.c_str(), &ret);
+    EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+    EXPECT_EQ_SIZE_T(2, ljson_array::get_value_helper(value->get_value()).size());
+    value = ljson_value::parse((json + "x").c_str(), &ret);
+    EXPECT_EQ_INT(LJSON_PARSE_ROOT_NOT_SINGULAR, ret);
+  }
+}
+
+#define TEST_BOUNDED(error, json, len)\
+    do {\
+        int ret = LJSON_PARSE_OK;\
+        ljson_value::parse(json, len, &ret);\
+        EXPECT_EQ_INT(error, ret);\
+        ljson_compact_value::parse(json, len, &ret);\
+        EXPECT_EQ_INT(error, ret);\
+    } while(0)
+
+static void test_parse_bounded() {
+  TEST_BOUNDED(LJSON_PARSE_OK, "truex", 4);
+  TEST_BOUNDED(LJSON_PARSE_OK, "[1,2]garbage", 5);
+  TEST_BOUNDED(LJSON_PARSE_OK, "1 \n ", 4);
+  TEST_BOUNDED(LJSON_PARSE_EXPECT_VALUE, "", 0);
+  TEST_BOUNDED(LJSON_PARSE_EXPECT_VALUE, "  1", 2);
+  TEST_BOUNDED(LJSON_PARSE_INVALID_VALUE, "null", 3);
+  TEST_BOUNDED(LJSON_PARSE_INVALID_VALUE, "-1", 1);
+  TEST_BOUNDED(LJSON_PARSE_INVALID_VALUE, "1.5", 2);
+  TEST_BOUNDED(LJSON_PARSE_INVALID_VALUE, "1e5", 2);
+  TEST_BOUNDED(LJSON_PARSE_MISS_QUOTATION_MARK, "\"abc\"", 4);
+  TEST_BOUNDED(LJSON_PARSE_INVALID_STRING_ESCAPE, "\"\\n\"", 2);
+  TEST_BOUNDED(LJSON_PARSE_INVALID_UNICODE_HEX, "\"\\u1234\"", 5);
+  TEST_BOUNDED(LJSON_PARSE_INVALID_UNICODE_SURROGATE, "\"\\uD834\\uDD1E\"", 8);
+  TEST_BOUNDED(LJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, "[1,2]", 4);
+  TEST_BOUNDED(LJSON_PARSE_MISS_COLON, "{\"a\":1}", 4);
+  /* '\0' is not a terminator any more */
+  TEST_BOUNDED(LJSON_PARSE_ROOT_NOT_SINGULAR, "[1]\0", 4);
+  TEST_BOUNDED(LJSON_PARSE_INVALID_STRING_CHAR, "\"a\0b\"", 5);
+
+  int ret = LJSON_PARSE_OK;
+  auto value = ljson_value::parse("123456", 3, &ret);
+  EXPECT_EQ_INT64(123, static_cast<const ljson_number&>(*value).get_int64());
+  auto compact = ljson_compact_value::parse("[\"abc\",\"d\\u00e9f\"]xyz", 18, &ret);
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+  EXPECT_EQ_STRING(std::string("abc"), std::string((*compact)[0].get_string(), (*compact)[0].get_string_length()));
+  EXPECT_EQ_STRING(std::string("d\xC3\xA9" "f"), std::string((*compact)[1].get_string(), (*compact)[1].get_string_length()));
+}
+
+/// every prefix of a document parses like the same prefix null-terminated, padding or not
+static void test_parse_bounded_prefixes() {
+  const char* documents[] = {
+    "[null, false, true, -12.5e+3, 18446744073709551615, \"a fairly long string crossing a block \\u00e9\\n\"]",
+    "{ \"key\" : { \"nested\" : [ 1, 2, [ ] ] },  \"text\":\"\\uD834\\uDD1E 0123456789abcdefghijklmnopqrstuvwxyz\" }    ",
+  };
+  for (const char* document : documents) {
+    size_t size = strlen(document);
+    for (size_t len = 0; len <= size; ++len) {
+      std::string terminated(document, len);
+      /// the padding holds bytes that would continue any token
+      std::string padded = terminated + std::string(LJSON_PADDING, '7');
+      std::string exact(document, len);
+      int expect = LJSON_PARSE_OK, ret = LJSON_PARSE_OK;
+      ljson_value::parse(terminated.c_str(), &expect);
+      ljson_value::parse(exact.data(), len, &ret);
+      EXPECT_EQ_INT(expect, ret);
+      ljson_value::parse_padded(padded.data(), len, &ret);
+      EXPECT_EQ_INT(expect, ret);
+      ljson_compact_value::parse_padded(padded.data(), len, &ret);
+      EXPECT_EQ_INT(expect, ret);
+    }
+  }
+}
+
+#if defined(__unix__)
+/// input ending right before an unreadable page
+static void test_parse_bounded_page_end() {
+  auto page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  auto base = static_cast<char*>(mmap(nullptr, 2 * page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+  if (base == MAP_FAILED)
+    return;
+  mprotect(base + page, page, PROT_NONE);
+  const char* documents[] = {"\"string running to the end of the page\"", "[1, 2       ", "123", "  \t\n  "};
+  const int expects[] = {LJSON_PARSE_OK, LJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, LJSON_PARSE_OK,
+                         LJSON_PARSE_EXPECT_VALUE};
+  for (size_t i = 0; i < sizeof(documents) / sizeof(documents[0]); ++i) {
+    size_t len = strlen(documents[i]);
+    char* data = base + page - len;
+    memcpy(data, documents[i], len);
+    int ret = LJSON_PARSE_OK;
+    ljson_value::parse(data, len, &ret);
+    EXPECT_EQ_INT(expects[i], ret);
+    ljson_compact_value::parse(data, len, &ret);
+    EXPECT_EQ_INT(expects[i], ret);
+  }
+  munmap(base, 2 * page);
+}
+#endif
+
+static std::string make_nested_arrays(size_t depth) {
+  return std::string(depth, '[') + std::string(depth, ']');
+}
+
+static void test_parse_nesting() {
+  int ret = LJSON_PARSE_OK;
+  ljson_value::parse("[[]]", &ret, 2);
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+  ljson_value::parse("[[]]", &ret, 1);
+  EXPECT_EQ_INT(LJSON_PARSE_NESTING_TOO_DEEP, ret);
+  ljson_value::parse("[]", &ret, 0);
+  EXPECT_EQ_INT(LJSON_PARSE_NESTING_TOO_DEEP, ret);
+  ljson_value::parse("1", &ret, 0);
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+  ljson_value::parse("{\"a\":{\"b\":[1,{}]}}", &ret, 4);
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+  ljson_compact_value::parse("{\"a\":{\"b\":[1,{}]}}", &ret, 4);
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+  ljson_compact_value::parse("{\"a\":{\"b\":[1,{}]}}", &ret, 3);
+  EXPECT_EQ_INT(LJSON_PARSE_NESTING_TOO_DEEP, ret);
+  /* siblings do not add up */
+  ljson_value::parse("[[],[[]],[],{\"a\":[]}]", &ret, 3);
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+
+  /* far deeper than any call stack would allow */
+  std::string deep = make_nested_arrays(1000000);
+  ljson_value::parse(deep.c_str(), &ret);
+  EXPECT_EQ_INT(LJSON_PARSE_NESTING_TOO_DEEP, ret);
+  ljson_compact_value::parse(deep.c_str(), &ret);
+  EXPECT_EQ_INT(LJSON_PARSE_NESTING_TOO_DEEP, ret);
+  auto value = ljson_value::parse(deep.c_str(), &ret, deep.size());
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+  EXPECT_EQ_INT(LJSON_ARRAY, value->get_type());
+  auto compact = ljson_compact_value::parse(deep.c_str(), &ret, deep.size());
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+  size_t depth = 0;
+  for (const ljson_compact_value* v = compact.get(); v->size() != 0; v = &(*v)[0])
+    depth++;
+  EXPECT_EQ_SIZE_T(999999, depth);
+
+  std::string objects;
+  for (int i = 0; i < 100000; ++i)
+    objects += "{\"a\":";
+  objects += "null" + std::string(100000, '}');
+  ljson_value::parse(objects.c_str(), &ret, 100000);
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+  ljson_value::parse(objects.c_str(), &ret, 99999);
+  EXPECT_EQ_INT(LJSON_PARSE_NESTING_TOO_DEEP, ret);
+  /* unbalanced deep input fails cleanly */
+  ljson_value::parse(deep.substr(0, deep.size() - 1).c_str(), &ret, deep.size());
+  EXPECT_EQ_INT(LJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, ret);
+  ljson_compact_value::parse((objects + "}").c_str(), &ret, 100000);
+  EXPECT_EQ_INT(LJSON_PARSE_ROOT_NOT_SINGULAR, ret);
+}
+
 static void test_parse_array() {
   {
     int ret = 0;
@@ -286,6 +687,8 @@ static void test_parse_root_not_singular() {
 static void test_parse_number_too_big() {
   TEST_ERROR(LJSON_PARSE_NUMBER_TOO_BIG, "1e309");
   TEST_ERROR(LJSON_PARSE_NUMBER_TOO_BIG, "-1e309");
+  TEST_ERROR(LJSON_PARSE_NUMBER_TOO_BIG, "1.7976931348623159e308");
+  TEST_ERROR(LJSON_PARSE_NUMBER_TOO_BIG, "1e100000000000000000000");
 }
 
 static void test_parse_missing_quotation_mark() {
@@ -376,6 +779,17 @@ static void test_access_number() {
   auto value = ljson_number::create(123.45);
   auto number = std::static_pointer_cast<double>(value->get_value());
   EXPECT_EQ_DOUBLE(123.45, *number);
+
+  value = ljson_number::create_int64(-42);
+  EXPECT_EQ_INT64(-42, static_cast<const ljson_number&>(*value).get_int64());
+  EXPECT_EQ_DOUBLE(-42.0, ljson_number::get_value_helper(value->get_value()));
+  value = ljson_number::create_uint64(42);
+  EXPECT_EQ_INT(LJSON_NUMBER_INT64, static_cast<const ljson_number&>(*value).get_number_type());
+  value = ljson_number::create_uint64(UINT64_MAX);
+  EXPECT_EQ_UINT64(UINT64_MAX, static_cast<const ljson_number&>(*value).get_uint64());
+  value->set_value(std::make_shared<double>(0.5));
+  EXPECT_EQ_INT(LJSON_NUMBER_DOUBLE, static_cast<const ljson_number&>(*value).get_number_type());
+  EXPECT_EQ_DOUBLE(0.5, static_cast<const ljson_number&>(*value).get_double());
 }
 
 static void test_access_string() {
@@ -387,12 +801,1034 @@ static void test_access_string() {
   EXPECT_EQ_STRING("Hello", str);
 }
 
+static void test_arena_allocate() {
+  ljson_arena arena;
+  EXPECT_EQ_SIZE_T(0, arena.chunk_count());
+  auto c = static_cast<char*>(arena.allocate(1, 1));
+  auto d = static_cast<double*>(arena.allocate(sizeof(double), alignof(double)));
+  EXPECT_TRUE(c != nullptr);
+  EXPECT_EQ_SIZE_T(0, reinterpret_cast<uintptr_t>(d) % alignof(double));
+  EXPECT_EQ_SIZE_T(1, arena.chunk_count());
+  /* oversized request gets its own chunk */
+  auto big = static_cast<char*>(arena.allocate(1 << 22, 1));
+  big[(1 << 22) - 1] = 'x';
+  EXPECT_EQ_SIZE_T(2, arena.chunk_count());
+  auto s = arena.copy_string("Hello", 5);
+  EXPECT_EQ_STRING("Hello", std::string(s, 5));
+}
+
+static void test_arena_cleanup() {
+  auto counter = std::make_shared<int>(0);
+  {
+    ljson_arena arena;
+    arena.create_with_cleanup<std::shared_ptr<int>>(counter);
+    EXPECT_EQ_INT(2, (int)counter.use_count());
+  }
+  EXPECT_EQ_INT(1, (int)counter.use_count());
+}
+
+static void test_arena_document_lifetime() {
+  std::shared_ptr<ljson_value> element;
+  std::shared_ptr<ljson_value> member;
+  {
+    int ret = LJSON_PARSE_OK;
+    auto value = ljson_value::parse("[ 1, \"abc\", { \"k\" : [ true ] } ]", &ret);
+    EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+    auto array = ljson_array::get_value_helper(value->get_value());
+    element = array[1];
+    auto objects = ljson_objects::get_value_helper(array[2]->get_value());
+    EXPECT_EQ_SIZE_T(1, objects.size());
+    EXPECT_EQ_STRING("k", objects[0]->key);
+    member = objects[0]->value;
+  }
+  /* children keep the whole document alive */
+  EXPECT_EQ_INT(LJSON_STRING, element->get_type());
+  EXPECT_EQ_STRING("abc", ljson_string::get_value_helper(element->get_value()));
+  EXPECT_EQ_INT(LJSON_ARRAY, member->get_type());
+  auto inside = ljson_array::get_value_helper(member->get_value());
+  EXPECT_EQ_SIZE_T(1, inside.size());
+  EXPECT_EQ_INT(LJSON_TRUE, inside[0]->get_type());
+}
+
+static void test_arena_set_value() {
+  int ret = LJSON_PARSE_OK;
+  auto value = ljson_value::parse("[ \"abc\", [ 1 ], { \"a\" : 1 } ]", &ret);
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+  auto array = ljson_array::get_value_helper(value->get_value());
+  array[0]->set_value(std::make_shared<std::string>("Hello"));
+  EXPECT_EQ_STRING("Hello", ljson_string::get_value_helper(array[0]->get_value()));
+  std::vector<std::shared_ptr<ljson_value>> elements{ljson_number::create(2.0), ljson_null::create()};
+  array[1]->set_value(std::make_shared<std::vector<std::shared_ptr<ljson_value>>>(elements));
+  auto inside = ljson_array::get_value_helper(array[1]->get_value());
+  EXPECT_EQ_SIZE_T(2, inside.size());
+  EXPECT_EQ_DOUBLE(2.0, ljson_number::get_value_helper(inside[0]->get_value()));
+  EXPECT_EQ_INT(LJSON_NULL, inside[1]->get_type());
+  std::vector<std::shared_ptr<ljson_member>> members{std::make_shared<ljson_member>("b", ljson_true::create())};
+  array[2]->set_value(std::make_shared<std::vector<std::shared_ptr<ljson_member>>>(members));
+  auto objects = ljson_objects::get_value_helper(array[2]->get_value());
+  EXPECT_EQ_SIZE_T(1, objects.size());
+  EXPECT_EQ_STRING("b", objects[0]->key);
+  EXPECT_EQ_INT(LJSON_TRUE, objects[0]->value->get_type());
+  /* the object owns the new values, assigning to the members passed in or handed out changes nothing */
+  members[0]->key = std::string(100, 'k');
+  members[0]->value = ljson_false::create();
+  objects[0]->value = ljson_null::create();
+  const ljson_objects& object = array[2]->as_object();
+  EXPECT_EQ_INT(LJSON_TRUE, object["b"].get_type());
+  EXPECT_EQ_INT(LJSON_TRUE, object.find("b")->get_type());
+  EXPECT_EQ_STRING("b", std::string(object.begin()->key, object.begin()->key_size));
+  EXPECT_EQ_INT(LJSON_TRUE, object.begin()->value->get_type());
+  EXPECT_EQ_STRING("{\"b\":true}", ljson_generator::stringify(*array[2]));
+}
+
+static void test_arena_reset() {
+  auto counter = std::make_shared<int>(0);
+  ljson_arena arena;
+  arena.create_with_cleanup<std::shared_ptr<int>>(counter);
+  for (int i = 0; i < 10; ++i)
+    arena.allocate(1000, 1);
+  arena.allocate(1 << 22, 1);
+  EXPECT_TRUE(arena.chunk_count() > 2);
+  arena.reset();
+  /* the cleanups ran, the current chunk is bumped from its start again */
+  EXPECT_EQ_INT(1, (int)counter.use_count());
+  EXPECT_EQ_SIZE_T(1, arena.chunk_count());
+  auto first = arena.allocate(64, 1);
+  arena.reset();
+  EXPECT_TRUE(first == arena.allocate(64, 1));
+  EXPECT_EQ_SIZE_T(1, arena.chunk_count());
+  ljson_arena empty;
+  empty.reset();
+  EXPECT_EQ_SIZE_T(0, empty.chunk_count());
+}
+
+static void test_arena_wide_containers() {
+  /* keys and values of nested objects interleave on the scratch stacks */
+  int ret = LJSON_PARSE_OK;
+  auto value = ljson_value::parse("{ \"a\" : { \"b\" : 1, \"c\" : [ { \"d\" : 2 }, 3 ] }, \"e\" : 4 }", &ret);
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+  auto objects = ljson_objects::get_value_helper(value->get_value());
+  EXPECT_EQ_SIZE_T(2, objects.size());
+  EXPECT_EQ_STRING("a", objects[0]->key);
+  EXPECT_EQ_STRING("e", objects[1]->key);
+  EXPECT_EQ_DOUBLE(4.0, ljson_number::get_value_helper(objects[1]->value->get_value()));
+  auto inner = ljson_objects::get_value_helper(objects[0]->value->get_value());
+  EXPECT_EQ_STRING("b", inner[0]->key);
+  EXPECT_EQ_STRING("c", inner[1]->key);
+  auto array = ljson_array::get_value_helper(inner[1]->value->get_value());
+  EXPECT_EQ_SIZE_T(2, array.size());
+  EXPECT_EQ_STRING("d", ljson_objects::get_value_helper(array[0]->get_value())[0]->key);
+  EXPECT_EQ_DOUBLE(3.0, ljson_number::get_value_helper(array[1]->get_value()));
+  std::string json = "{";
+  for (int i = 0; i < 100000; ++i)
+    json += (i ? ",\"k" : "\"k") + std::to_string(i) + "\":[" + std::to_string(i) + "]";
+  json += "}";
+  value = ljson_value::parse(json.c_str(), &ret);
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+  objects = ljson_objects::get_value_helper(value->get_value());
+  EXPECT_EQ_SIZE_T(100000, objects.size());
+  EXPECT_EQ_STRING("k99999", objects[99999]->key);
+  array = ljson_array::get_value_helper(objects[99999]->value->get_value());
+  EXPECT_EQ_DOUBLE(99999.0, ljson_number::get_value_helper(array[0]->get_value()));
+}
+
+static void test_arena_large_document() {
+  std::string json = "[";
+  for (int i = 0; i < 100000; ++i) {
+    json += i ? ",{\"key\":\"value\",\"n\":" : "{\"key\":\"value\",\"n\":";
+    json += std::to_string(i);
+    json += "}";
+  }
+  json += "]";
+  int ret = LJSON_PARSE_OK;
+  auto value = ljson_value::parse(json.c_str(), &ret);
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+  auto array = ljson_array::get_value_helper(value->get_value());
+  EXPECT_EQ_SIZE_T(100000, array.size());
+  auto objects = ljson_objects::get_value_helper(array[99999]->get_value());
+  EXPECT_EQ_STRING("value", ljson_string::get_value_helper(objects[0]->value->get_value()));
+  EXPECT_EQ_DOUBLE(99999.0, ljson_number::get_value_helper(objects[1]->value->get_value()));
+}
+
+static void test_compact_parse() {
+  EXPECT_EQ_SIZE_T(16, sizeof(ljson_compact_value));
+  int ret = LJSON_PARSE_OK;
+  auto value = ljson_compact_value::parse(
+  " { "
+  "\"n\" : null , "
+  "\"f\" : false , "
+  "\"t\" : true , "
+  "\"i\" : 123 , "
+  "\"s\" : \"a\\u0000c\", "
+  "\"a\" : [ 1, 2, 3 ],"
+  "\"o\" : { \"1\" : 1, \"2\" : 2, \"3\" : 3 }"
+  " } "
+  , &ret);
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+  EXPECT_EQ_INT(LJSON_OBJECT, value->get_type());
+  EXPECT_EQ_SIZE_T(7, value->size());
+  const char* keys = "nftisao";
+  LJSON_TYPE types[] = {LJSON_NULL, LJSON_FALSE, LJSON_TRUE, LJSON_NUMBER, LJSON_STRING, LJSON_ARRAY, LJSON_OBJECT};
+  for (size_t i = 0; i < 7; ++i) {
+    auto& member = value->get_member(i);
+    EXPECT_EQ_INT(LJSON_STRING, member.key.get_type());
+    EXPECT_EQ_SIZE_T(1, member.key.get_string_length());
+    EXPECT_TRUE(keys[i] == member.key.get_string()[0]);
+    EXPECT_EQ_INT(types[i], member.value.get_type());
+  }
+  EXPECT_EQ_DOUBLE(123.0, value->get_member(3).value.get_number());
+  auto& str = value->get_member(4).value;
+  EXPECT_EQ_STRING(std::string("a\0c", 3), std::string(str.get_string(), str.get_string_length()));
+  auto& array = value->get_member(5).value;
+  EXPECT_EQ_SIZE_T(3, array.size());
+  for (size_t i = 0; i < 3; ++i)
+    EXPECT_EQ_DOUBLE(i + 1.0, array[i].get_number());
+  auto& inside = value->get_member(6).value;
+  EXPECT_EQ_SIZE_T(3, inside.size());
+  EXPECT_EQ_DOUBLE(3.0, inside.get_member(2).value.get_number());
+}
+
+#define TEST_COMPACT_ERROR(error, json)\
+    do {\
+        int ret = LJSON_PARSE_OK;\
+        auto value = ljson_compact_value::parse(json, &ret);\
+        EXPECT_EQ_INT(error, ret);\
+        EXPECT_NULL(value);\
+    } while(0)
+
+static void test_compact_parse_error() {
+  TEST_COMPACT_ERROR(LJSON_PARSE_EXPECT_VALUE, " ");
+  TEST_COMPACT_ERROR(LJSON_PARSE_INVALID_VALUE, "nul");
+  TEST_COMPACT_ERROR(LJSON_PARSE_ROOT_NOT_SINGULAR, "null x");
+  TEST_COMPACT_ERROR(LJSON_PARSE_NUMBER_TOO_BIG, "1e309");
+  TEST_COMPACT_ERROR(LJSON_PARSE_MISS_QUOTATION_MARK, "\"abs");
+  TEST_COMPACT_ERROR(LJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, "[[1, \"a\"]");
+  TEST_COMPACT_ERROR(LJSON_PARSE_MISS_KEY, "{\"a\":[1],1:1");
+  TEST_COMPACT_ERROR(LJSON_PARSE_MISS_COLON, "{\"a\"}");
+  TEST_COMPACT_ERROR(LJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, "{\"a\":{}");
+}
+
+/// writes every event as text, stops after stop_after events when set
+struct sax_recorder {
+  bool event(const std::string& text) {
+    log += log.empty() ? text : " " + text;
+    return ++events != stop_after;
+  }
+  bool null() { return event("null"); }
+  bool boolean(bool b) { return event(b ? "true" : "false"); }
+  bool number(const ljson_number_value& number) {
+    char buffer[32];
+    if (number.is_int64())
+      snprintf(buffer, sizeof(buffer), "%lld", static_cast<long long>(number.to_int64()));
+    else
+      snprintf(buffer, sizeof(buffer), "%g", number.to_double());
+    return event(buffer);
+  }
+  bool string(const char* str, size_t len) { return event("\"" + std::string(str, len) + "\""); }
+  bool key(const char* str, size_t len) { return event(std::string(str, len) + ":"); }
+  bool start_object() { return event("{"); }
+  bool end_object(size_t size) { return event("}" + std::to_string(size)); }
+  bool start_array() { return event("["); }
+  bool end_array(size_t size) { return event("]" + std::to_string(size)); }
+
+  std::string log;
+  int events = 0;
+  int stop_after = -1;
+};
+
+#define TEST_SAX(expect, json)\
+    do {\
+        sax_recorder recorder;\
+        EXPECT_EQ_INT(LJSON_PARSE_OK, ljson_sax::parse(json, recorder));\
+        EXPECT_EQ_STRING(std::string(expect), recorder.log);\
+    } while(0)
+
+static void test_sax_events() {
+  TEST_SAX("null", "null");
+  TEST_SAX("-1.5", " -1.5 ");
+  TEST_SAX("9007199254740993", "9007199254740993");
+  TEST_SAX("\"a\nb\"", "\"a\\nb\"");
+  TEST_SAX("[ ]0", "[]");
+  TEST_SAX("{ }0", "{ }");
+  TEST_SAX("[ null false true 1 \"x\" ]5", "[null,false,true,1,\"x\"]");
+  TEST_SAX("{ a: [ 1 { }0 ]2 b\tc: { d: \"e\" }1 }2", "{\"a\":[1,{}],\"b\\tc\":{\"d\":\"e\"}}");
+  TEST_SAX("[ [ [ ]0 ]1 [ ]0 ]2", "[[[]],[]]");
+}
+
+static void test_sax_stop() {
+  /* pull one field and skip the rest of the input */
+  struct find_id {
+    bool null() { return true; }
+    bool boolean(bool) { return true; }
+    bool number(const ljson_number_value& number) {
+      if (!next_is_id)
+        return true;
+      id = number.to_int64();
+      return false;
+    }
+    bool string(const char*, size_t) { next_is_id = false; return true; }
+    bool key(const char* str, size_t len) {
+      next_is_id = std::string(str, len) == "id";
+      return true;
+    }
+    bool start_object() { return true; }
+    bool end_object(size_t) { return true; }
+    bool start_array() { return true; }
+    bool end_array(size_t) { return true; }
+
+    bool next_is_id = false;
+    int64_t id = 0;
+  } handler;
+  EXPECT_EQ_INT(LJSON_PARSE_HANDLER_STOPPED,
+                ljson_sax::parse("{\"name\":\"x\",\"id\":1541815603606036480,\"tags\":[1,2,3]} trailing garbage", handler));
+  EXPECT_EQ_INT64(1541815603606036480LL, handler.id);
+
+  sax_recorder recorder;
+  recorder.stop_after = 3;
+  EXPECT_EQ_INT(LJSON_PARSE_HANDLER_STOPPED, ljson_sax::parse("[1,[2,3],4]", recorder));
+  EXPECT_EQ_STRING(std::string("[ 1 ["), recorder.log);
+  recorder = sax_recorder();
+  recorder.stop_after = 2;
+  EXPECT_EQ_INT(LJSON_PARSE_HANDLER_STOPPED, ljson_sax::parse("{\"a\":{\"b\":1}}", recorder));
+  EXPECT_EQ_STRING(std::string("{ a:"), recorder.log);
+}
+
+static void test_sax_error() {
+  sax_recorder recorder;
+  EXPECT_EQ_INT(LJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, ljson_sax::parse("[1,2", recorder));
+  EXPECT_EQ_STRING(std::string("[ 1 2"), recorder.log);
+  recorder = sax_recorder();
+  EXPECT_EQ_INT(LJSON_PARSE_ROOT_NOT_SINGULAR, ljson_sax::parse("[] x", recorder));
+  EXPECT_EQ_STRING(std::string("[ ]0"), recorder.log);
+  recorder = sax_recorder();
+  EXPECT_EQ_INT(LJSON_PARSE_INVALID_STRING_ESCAPE, ljson_sax::parse("{\"a\":\"\\x\"}", recorder));
+  recorder = sax_recorder();
+  EXPECT_EQ_INT(LJSON_PARSE_NESTING_TOO_DEEP, ljson_sax::parse("[[[1]]]", recorder, 2));
+  EXPECT_EQ_STRING(std::string("[ ["), recorder.log);
+}
+
+static void test_sax_input() {
+  sax_recorder recorder;
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ljson_sax::parse("[\"ab\"]garbage", 6, recorder));
+  EXPECT_EQ_STRING(std::string("[ \"ab\" ]1"), recorder.log);
+  std::string padded = std::string("{\"k\":\"v\"}") + std::string(LJSON_PADDING, '"');
+  recorder = sax_recorder();
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ljson_sax::parse_padded(padded.data(), 9, recorder));
+  EXPECT_EQ_STRING(std::string("{ k: \"v\" }1"), recorder.log);
+  char insitu[] = "[\"a\\u00e9\", \"plain\"]";
+  recorder = sax_recorder();
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ljson_sax::parse_insitu(insitu, recorder));
+  EXPECT_EQ_STRING(std::string("[ \"a\xC3\xA9\" \"plain\" ]2"), recorder.log);
+}
+
+/// feed json to a push parser in chunks of chunk bytes, the first one first bytes long
+static LJSON_STATE push_chunks(const std::string& json, size_t first, size_t chunk, sax_recorder& recorder) {
+  ljson_push_parser<sax_recorder> parser(recorder);
+  size_t pos = std::min(first, json.size());
+  LJSON_STATE ret = parser.feed(json.data(), pos);
+  while (ret == LJSON_PARSE_OK && pos < json.size()) {
+    size_t n = std::min(chunk, json.size() - pos);
+    ret = parser.feed(json.data() + pos, n);
+    pos += n;
+  }
+  return ret == LJSON_PARSE_OK ? parser.finish() : ret;
+}
+
+static void test_push_split() {
+  const char* documents[] = {
+    "null",
+    " true ",
+    "-12.5e-3",
+    "1541815603606036480",
+    "\"a\\\"b\\\\c\\n\\u00e9\\uD834\\uDD1E\"",
+    "[1,[\"x\",{\"k\\\"ey\":false}],[],{}]",
+    "{\"name\":\"ljson\",\"ids\":[1,2,3],\"nested\":{\"a\":[null,{\"b\":-0}]}}",
+  };
+  for (const char* json : documents) {
+    sax_recorder expect;
+    EXPECT_EQ_INT(LJSON_PARSE_OK, ljson_sax::parse(json, expect));
+    std::string text(json);
+    /* cut once at every position, then byte by byte */
+    for (size_t cut = 0; cut <= text.size(); ++cut) {
+      sax_recorder recorder;
+      EXPECT_EQ_INT(LJSON_PARSE_OK, push_chunks(text, cut, text.size(), recorder));
+      EXPECT_EQ_STRING(expect.log, recorder.log);
+    }
+    sax_recorder recorder;
+    EXPECT_EQ_INT(LJSON_PARSE_OK, push_chunks(text, 0, 1, recorder));
+    EXPECT_EQ_STRING(expect.log, recorder.log);
+  }
+}
+
+static void test_push_stream() {
+  std::vector<std::shared_ptr<ljson_value>> documents;
+  ljson_document_handler handler([&documents](std::shared_ptr<ljson_value> document) {
+    documents.push_back(document);
+    return true;
+  });
+  ljson_push_parser<ljson_document_handler> parser(handler);
+  /* a value is out as soon as it closes, a number needs what follows it */
+  EXPECT_EQ_INT(LJSON_PARSE_OK, parser.feed("[1,\"a", 5));
+  EXPECT_EQ_SIZE_T(0, documents.size());
+  EXPECT_EQ_SIZE_T(1, parser.depth());
+  EXPECT_EQ_INT(LJSON_PARSE_OK, parser.feed("b\"] 4", 5));
+  EXPECT_EQ_SIZE_T(1, documents.size());
+  EXPECT_EQ_INT(LJSON_PARSE_OK, parser.feed("2\n{\"k\":", 7));
+  EXPECT_EQ_SIZE_T(2, documents.size());
+  EXPECT_EQ_INT(LJSON_PARSE_OK, parser.feed("nu", 2));
+  EXPECT_EQ_INT(LJSON_PARSE_OK, parser.feed("ll}7", 4));
+  EXPECT_EQ_SIZE_T(3, documents.size());
+  EXPECT_EQ_INT(LJSON_PARSE_OK, parser.finish());
+  EXPECT_EQ_SIZE_T(4, documents.size());
+
+  EXPECT_EQ_INT(LJSON_ARRAY, documents[0]->get_type());
+  auto elements = ljson_array::get_value_helper(documents[0]->get_value());
+  EXPECT_EQ_SIZE_T(2, elements.size());
+  EXPECT_EQ_STRING("ab", ljson_string::get_value_helper(elements[1]->get_value()));
+  EXPECT_EQ_INT64(42, std::static_pointer_cast<ljson_number>(documents[1])->get_int64());
+  EXPECT_EQ_INT(LJSON_OBJECT, documents[2]->get_type());
+  auto members = ljson_objects::get_value_helper(documents[2]->get_value());
+  EXPECT_EQ_SIZE_T(1, members.size());
+  EXPECT_EQ_STRING("k", members[0]->key);
+  EXPECT_EQ_INT(LJSON_NULL, members[0]->value->get_type());
+  EXPECT_EQ_INT64(7, std::static_pointer_cast<ljson_number>(documents[3])->get_int64());
+
+  /* an empty stream holds no value and no error */
+  parser.reset();
+  EXPECT_EQ_INT(LJSON_PARSE_OK, parser.feed(" \n", 2));
+  EXPECT_EQ_INT(LJSON_PARSE_OK, parser.finish());
+  EXPECT_EQ_SIZE_T(4, documents.size());
+}
+
+static void test_push_error() {
+  const char* documents[] = {
+    "[1,2", "[1,2 x", "[", "{", "{\"a\"", "{\"a\":", "{\"a\":1,}", "{1:2}", "[1,]", "[1 2]",
+    "\"abc", "\"\\x\"", "\"\\u12\"", "\"a\tb\"", "nul", "tru e", "[truex]", "-", "1.", "[01]", "?",
+    /* a top level number or literal runs into the next value */
+    "01", "truefalse", "1-2", "true1",
+  };
+  for (const char* json : documents) {
+    sax_recorder expect;
+    LJSON_STATE error = ljson_sax::parse(json, expect);
+    EXPECT_TRUE(error != LJSON_PARSE_OK);
+    std::string text(json);
+    sax_recorder recorder;
+    EXPECT_EQ_INT(error, push_chunks(text, 0, 1, recorder));
+    EXPECT_EQ_STRING(expect.log, recorder.log);
+    recorder = sax_recorder();
+    EXPECT_EQ_INT(error, push_chunks(text, text.size(), 1, recorder));
+  }
+
+  /* errors stick until reset */
+  sax_recorder recorder;
+  ljson_push_parser<sax_recorder> parser(recorder, 2);
+  EXPECT_EQ_INT(LJSON_PARSE_NESTING_TOO_DEEP, parser.feed("[[[", 3));
+  EXPECT_EQ_INT(LJSON_PARSE_NESTING_TOO_DEEP, parser.feed("]]]", 3));
+  EXPECT_EQ_INT(LJSON_PARSE_NESTING_TOO_DEEP, parser.finish());
+  parser.reset();
+  recorder = sax_recorder();
+  recorder.stop_after = 2;
+  EXPECT_EQ_INT(LJSON_PARSE_HANDLER_STOPPED, parser.feed("[1,2]", 5));
+  EXPECT_EQ_STRING(std::string("[ 1"), recorder.log);
+  parser.reset();
+  recorder = sax_recorder();
+  EXPECT_EQ_INT(LJSON_PARSE_OK, parser.feed("[[1]]", 5));
+  EXPECT_EQ_INT(LJSON_PARSE_OK, parser.finish());
+  EXPECT_EQ_STRING(std::string("[ [ 1 ]1 ]1"), recorder.log);
+
+  /* documents are built again once the handler is reset with the parser */
+  std::vector<std::shared_ptr<ljson_value>> built;
+  ljson_document_handler handler([&built](std::shared_ptr<ljson_value> document) {
+    built.push_back(document);
+    return true;
+  });
+  ljson_push_parser<ljson_document_handler> builder(handler);
+  EXPECT_EQ_INT(LJSON_PARSE_OK, builder.feed("{\"a\":[1,2,", 10));
+  EXPECT_EQ_INT(LJSON_PARSE_EXPECT_VALUE, builder.finish());
+  EXPECT_EQ_SIZE_T(0, built.size());
+  builder.reset();
+  handler.reset();
+  EXPECT_EQ_INT(LJSON_PARSE_OK, builder.feed("[3] 4", 5));
+  EXPECT_EQ_INT(LJSON_PARSE_OK, builder.finish());
+  EXPECT_EQ_SIZE_T(2, built.size());
+  if (built.size() == 2) {
+    EXPECT_EQ_SIZE_T(1, built[0]->size());
+    EXPECT_EQ_DOUBLE(3.0, ljson_number::get_value_helper((*built[0])[0].get_value()));
+    EXPECT_EQ_DOUBLE(4.0, ljson_number::get_value_helper(built[1]->get_value()));
+  }
+}
+
+static void test_ndjson_parse() {
+  const std::string input =
+    "{\"id\":1}\n"
+    "\n"
+    "[2, \"two\"]\r\n"
+    "   \t\n"
+    "{\"id\":3,}\n"
+    "\"four\"\n"
+    "5";
+  const size_t offsets[] = {0, 10, 27, 37, 44};
+  const int rets[] = {LJSON_PARSE_OK, LJSON_PARSE_OK, LJSON_PARSE_MISS_KEY, LJSON_PARSE_OK, LJSON_PARSE_OK};
+  /* one batch per line and more workers than batches, then a single batch */
+  for (size_t batch_size : {size_t(1), size_t(1 << 20)}) {
+    ljson_ndjson::options opts;
+    opts.threads = 4;
+    opts.batch_size = batch_size;
+    auto records = ljson_ndjson::parse(input.data(), input.size(), opts);
+    EXPECT_EQ_SIZE_T(5, records.size());
+    for (size_t i = 0; i < records.size() && i < 5; ++i) {
+      EXPECT_EQ_SIZE_T(offsets[i], records[i].offset);
+      EXPECT_EQ_INT(rets[i], records[i].ret);
+      EXPECT_TRUE((records[i].value != nullptr) == (rets[i] == LJSON_PARSE_OK));
+    }
+    if (records.size() == 5) {
+      EXPECT_EQ_INT(LJSON_ARRAY, records[1].value->get_type());
+      EXPECT_EQ_STRING("four", ljson_string::get_value_helper(records[3].value->get_value()));
+      EXPECT_EQ_DOUBLE(5.0, ljson_number::get_value_helper(records[4].value->get_value()));
+    }
+  }
+  EXPECT_EQ_SIZE_T(0, ljson_ndjson::parse(input.data(), 0).size());
+  EXPECT_EQ_SIZE_T(0, ljson_ndjson::parse("\n\n \n", 4).size());
+}
+
+static void test_ndjson_unordered() {
+  std::string input;
+  size_t offset_sum = 0;
+  for (int i = 0; i < 1000; ++i) {
+    offset_sum += input.size();
+    input += "{\"id\":" + std::to_string(i) + ",\"tags\":[\"a\",\"b\"]}\n";
+  }
+  ljson_ndjson::options opts;
+  opts.threads = 3;
+  opts.batch_size = 256;
+  std::atomic<size_t> count(0), offsets(0), errors(0);
+  ljson_ndjson::parse_unordered(input.data(), input.size(), [&](ljson_ndjson::record& r) {
+    count++;
+    offsets += r.offset;
+    if (r.ret != LJSON_PARSE_OK)
+      errors++;
+  }, opts);
+  EXPECT_EQ_SIZE_T(1000, count.load());
+  EXPECT_EQ_SIZE_T(offset_sum, offsets.load());
+  EXPECT_EQ_SIZE_T(0, errors.load());
+}
+
+/// stage 1 positions computed byte by byte
+static std::vector<uint32_t> reference_positions(const std::string& json) {
+  std::vector<uint32_t> positions;
+  bool escaped = false, in_string = false, follows_scalar = false;
+  for (size_t i = 0; i < json.size(); ++i) {
+    char ch = json[i];
+    bool quote = ch == '"' && !escaped;
+    bool scalar = false;
+    if (in_string) {
+      in_string = !quote;
+    } else {
+      bool op = ch == '{' || ch == '}' || ch == '[' || ch == ']' || ch == ':' || ch == ',';
+      scalar = !op && ch != ' ' && ch != '\t' && ch != '\n' && ch != '\r';
+      if (op || (scalar && !follows_scalar))
+        positions.push_back(static_cast<uint32_t>(i));
+      in_string = quote;
+    }
+    follows_scalar = scalar && !quote;
+    escaped = ch == '\\' && !escaped;
+  }
+  return positions;
+}
+
+static void test_index_positions() {
+  ljson_structural_index index;
+  index.build("{\"a\\\"b\": [1, -2.5e3,\"x\\\\\" ,true]}", 33);
+  const uint32_t expect[] = {0, 1, 7, 9, 10, 11, 13, 19, 20, 26, 27, 31, 32, 33};
+  EXPECT_EQ_SIZE_T(13, index.size());
+  for (size_t i = 0; i < 14 && i <= index.size(); ++i)
+    EXPECT_EQ_SIZE_T(expect[i], index.positions()[i]);
+
+  /* random runs of quotes, backslashes and the rest across 64 byte stretches */
+  const char alphabet[] = "\"\\\\\\a [,1";
+  uint32_t seed = 12345;
+  for (int round = 0; round < 2000; ++round) {
+    std::string json;
+    size_t len = round % 300;
+    for (size_t i = 0; i < len; ++i) {
+      seed = seed * 1103515245 + 12345;
+      json += alphabet[(seed >> 16) % (sizeof(alphabet) - 1)];
+    }
+    auto expect_positions = reference_positions(json);
+    index.build(json.data(), json.size());
+    EXPECT_EQ_SIZE_T(expect_positions.size(), index.size());
+    if (expect_positions.size() == index.size()) {
+      EXPECT_TRUE(std::equal(expect_positions.begin(), expect_positions.end(), index.positions()));
+      EXPECT_EQ_SIZE_T(json.size(), index.positions()[index.size()]);
+    }
+  }
+}
+
+static void test_two_stage_parse() {
+  std::string long_string = "\"" + std::string(70, 'x') + "\\\\\\\"" + std::string(60, ' ') + "\\u00e9\"";
+  std::string long_array = "[";
+  for (int i = 0; i < 100; ++i)
+    long_array += (i ? ", " : "") + std::string("{\"id\":") + std::to_string(i) + ",\"s\":\"a\\\\\\\"b\",\"t\":[true,null]}";
+  long_array += "]";
+  const std::string documents[] = {
+    "null", " false ", "-12.5e-3", "1541815603606036480", "\"a\\nb\"", "[]", "{ }", " [ [ ] , { } ] ",
+    "{\"name\":\"ljson\",\"ids\":[1,2,3],\"nested\":{\"a\":[null,{\"b\":-0}]}}",
+    long_string, long_array,
+    /* invalid ones */
+    "", "  ", "[1x]", "[1 2]", "[1\"x\"]", "[\"a\"1]", "{\"a\"x:1}", "{\"a\" 1}", "{1:2}", "{\"a\":1,}", "[1,]",
+    "[1,2", "[", "{", "\"abc", "\"a\tb\"", "\"\\x\"", "nul", "nul l", "tru e", "[truex]", "[] x", "1 2", "-",
+    "[\"a\\", "\\\"", "[\"\\\\\"\"]", "[0x1]", "[\x80]", std::string("[1,\0]", 5),
+  };
+  for (const std::string& json : documents) {
+    sax_recorder one_pass, two_stage;
+    LJSON_STATE expect = ljson_sax::parse(json.data(), json.size(), one_pass);
+    EXPECT_EQ_INT(expect, ljson_sax::parse(json.data(), json.size(), two_stage, LJSON_PARSE_MAX_DEPTH,
+                                           LJSON_ENGINE_TWO_STAGE));
+    EXPECT_EQ_STRING(one_pass.log, two_stage.log);
+  }
+
+  int ret = LJSON_PARSE_OK;
+  auto value = ljson_value::parse(long_array.data(), long_array.size(), &ret, LJSON_PARSE_MAX_DEPTH,
+                                  LJSON_ENGINE_TWO_STAGE);
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+  EXPECT_EQ_SIZE_T(100, ljson_array::get_value_helper(value->get_value()).size());
+  auto compact = ljson_compact_value::parse(long_array.c_str(), &ret, LJSON_PARSE_MAX_DEPTH, LJSON_ENGINE_TWO_STAGE);
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+  EXPECT_EQ_SIZE_T(100, compact->size());
+  EXPECT_EQ_STRING("a\\\"b", std::string((*compact)[99].get_member(1).value.get_string(),
+                                         (*compact)[99].get_member(1).value.get_string_length()));
+  ljson_value::parse("[[[1]]]", &ret, 2, LJSON_ENGINE_TWO_STAGE);
+  EXPECT_EQ_INT(LJSON_PARSE_NESTING_TOO_DEEP, ret);
+  char insitu[] = "{\"k\": \"v\\u00e9\", \"n\": 1}";
+  compact = ljson_compact_value::parse_insitu(insitu, &ret, LJSON_PARSE_MAX_DEPTH, LJSON_ENGINE_TWO_STAGE);
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+  EXPECT_EQ_STRING("v\xC3\xA9", std::string(compact->get_member(0).value.get_string(),
+                                            compact->get_member(0).value.get_string_length()));
+}
+
+static void test_tape_parse() {
+  int ret = LJSON_PARSE_OK;
+  auto tape = ljson_tape::parse(
+  " { "
+  "\"n\" : null , "
+  "\"f\" : false , "
+  "\"t\" : true , "
+  "\"i\" : -123 , "
+  "\"s\" : \"a\\u0000c\", "
+  "\"a\" : [ 1.5, 18446744073709551615, [ ] ],"
+  "\"o\" : { \"1\" : 1, \"2\" : 2, \"3\" : 3 }"
+  " } "
+  , &ret);
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+  auto value = tape->root();
+  EXPECT_EQ_INT(LJSON_OBJECT, value.get_type());
+  EXPECT_EQ_SIZE_T(7, value.size());
+  const char* keys = "nftisao";
+  LJSON_TYPE types[] = {LJSON_NULL, LJSON_FALSE, LJSON_TRUE, LJSON_NUMBER, LJSON_STRING, LJSON_ARRAY, LJSON_OBJECT};
+  for (size_t i = 0; i < 7; ++i) {
+    auto member = value.get_member(i);
+    EXPECT_EQ_INT(LJSON_STRING, member.key.get_type());
+    EXPECT_EQ_SIZE_T(1, member.key.get_string_length());
+    EXPECT_TRUE(keys[i] == member.key.get_string()[0]);
+    EXPECT_EQ_INT(types[i], member.value.get_type());
+  }
+  EXPECT_TRUE(value.get_member(3).value.is_int64());
+  EXPECT_EQ_INT64(-123, value.get_member(3).value.get_int64());
+  auto str = value.get_member(4).value;
+  EXPECT_EQ_STRING(std::string("a\0c", 3), std::string(str.get_string(), str.get_string_length()));
+  EXPECT_TRUE(str.get_string()[3] == '\0');
+  auto array = value.get_member(5).value;
+  EXPECT_EQ_SIZE_T(3, array.size());
+  EXPECT_EQ_DOUBLE(1.5, array[0].get_number());
+  EXPECT_EQ_INT(LJSON_NUMBER_UINT64, array[1].get_number_type());
+  EXPECT_EQ_UINT64(18446744073709551615ULL, array[1].get_uint64());
+  EXPECT_EQ_SIZE_T(0, array[2].size());
+  auto inside = value.get_member(6).value;
+  EXPECT_EQ_SIZE_T(3, inside.size());
+  EXPECT_EQ_DOUBLE(3.0, inside.get_member(2).value.get_number());
+
+  /// a container is skipped in one step, the root spans the whole tape
+  EXPECT_EQ_SIZE_T(value.get_member(6).key.index(), array.next().index());
+  EXPECT_EQ_SIZE_T(tape->size(), value.next().index());
+  EXPECT_EQ_SIZE_T(34, tape->size());
+  EXPECT_TRUE((tape->words()[array.index()] >> 56) == '[');
+  EXPECT_TRUE((tape->words()[array.next().index() - 1] >> 56) == ']');
+
+  tape = ljson_tape::parse("\"x\"", &ret);
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+  EXPECT_EQ_SIZE_T(1, tape->size());
+  EXPECT_EQ_STRING(std::string("x"), std::string(tape->root().get_string()));
+  tape = ljson_tape::parse("42", 2, &ret);
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+  EXPECT_EQ_SIZE_T(2, tape->size());
+  EXPECT_EQ_INT64(42, tape->root().get_int64());
+}
+
+#define TEST_TAPE_ERROR(error, json)\
+    do {\
+        int ret = LJSON_PARSE_OK;\
+        auto tape = ljson_tape::parse(json, &ret);\
+        EXPECT_EQ_INT(error, ret);\
+        EXPECT_NULL(tape);\
+    } while(0)
+
+static void test_tape_parse_error() {
+  TEST_TAPE_ERROR(LJSON_PARSE_EXPECT_VALUE, " ");
+  TEST_TAPE_ERROR(LJSON_PARSE_INVALID_VALUE, "nul");
+  TEST_TAPE_ERROR(LJSON_PARSE_ROOT_NOT_SINGULAR, "null x");
+  TEST_TAPE_ERROR(LJSON_PARSE_NUMBER_TOO_BIG, "1e309");
+  TEST_TAPE_ERROR(LJSON_PARSE_MISS_QUOTATION_MARK, "\"abs");
+  TEST_TAPE_ERROR(LJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, "[[1, \"a\"]");
+  TEST_TAPE_ERROR(LJSON_PARSE_MISS_KEY, "{\"a\":[1],1:1");
+  TEST_TAPE_ERROR(LJSON_PARSE_MISS_COLON, "{\"a\"}");
+  TEST_TAPE_ERROR(LJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, "{\"a\":{}");
+  int ret = LJSON_PARSE_OK;
+  EXPECT_NULL(ljson_tape::parse("[[[1]]]", &ret, 2));
+  EXPECT_EQ_INT(LJSON_PARSE_NESTING_TOO_DEEP, ret);
+}
+
+/// replays a tape value as sax events, elements are walked with next()
+static void tape_replay(const ljson_tape_value& v, sax_recorder& out) {
+  switch (v.get_type()) {
+    case LJSON_NULL: out.null(); break;
+    case LJSON_TRUE: out.boolean(true); break;
+    case LJSON_FALSE: out.boolean(false); break;
+    case LJSON_STRING: out.string(v.get_string(), v.get_string_length()); break;
+    case LJSON_NUMBER: {
+      ljson_number_value number;
+      number.type = v.get_number_type();
+      if (v.is_int64())
+        number.int64 = v.get_int64();
+      else
+        number.number = v.get_number();
+      out.number(number);
+      break;
+    }
+    case LJSON_ARRAY:
+      out.start_array();
+      if (v.size() != 0) {
+        ljson_tape_value e = v[0];
+        for (size_t i = 0; i < v.size(); ++i, e = e.next())
+          tape_replay(e, out);
+      }
+      out.end_array(v.size());
+      break;
+    default:
+      out.start_object();
+      for (size_t i = 0; i < v.size(); ++i) {
+        auto member = v.get_member(i);
+        out.key(member.key.get_string(), member.key.get_string_length());
+        tape_replay(member.value, out);
+      }
+      out.end_object(v.size());
+      break;
+  }
+}
+
+static void test_tape_engines() {
+  std::string long_array = "[";
+  for (int i = 0; i < 100; ++i)
+    long_array += (i ? ", " : "") + std::string("{\"id\":") + std::to_string(i) + ",\"s\":\"a\\\\\\\"b\",\"t\":[true,null]}";
+  long_array += "]";
+  const std::string documents[] = {
+    "null", " false ", "-12.5e-3", "1541815603606036480", "\"a\\nb\"", "[]", "{ }", " [ [ ] , { } ] ",
+    "{\"name\":\"ljson\",\"ids\":[1,2,3],\"nested\":{\"a\":[null,{\"b\":-0}]}}", long_array,
+  };
+  for (const std::string& json : documents) {
+    sax_recorder expect;
+    EXPECT_EQ_INT(LJSON_PARSE_OK, ljson_sax::parse(json.data(), json.size(), expect));
+    for (LJSON_ENGINE engine : {LJSON_ENGINE_ONE_PASS, LJSON_ENGINE_TWO_STAGE}) {
+      int ret = LJSON_PARSE_OK;
+      auto tape = ljson_tape::parse(json.data(), json.size(), &ret, LJSON_PARSE_MAX_DEPTH, engine);
+      EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+      if (tape == nullptr)
+        continue;
+      EXPECT_EQ_SIZE_T(tape->size(), tape->root().next().index());
+      sax_recorder replayed;
+      tape_replay(tape->root(), replayed);
+      EXPECT_EQ_STRING(expect.log, replayed.log);
+    }
+  }
+}
+
+static void test_ondemand_lookup() {
+  const char* json =
+  " { \"skip\" : [ { \"a\" : \"]}\\\"[{\" }, [ [ ] ], \"\\\\\" ], "
+  "\"user\" : { \"name\" : \"a\\u00e9b\", \"id\" : 1541815603606036480, \"tags\" : [ \"x\", null, true, -1.5 ] } , "
+  "\"e\\u0073c\" : false, \"plain\" : \"text\" } ";
+  ljson_ondemand_document doc(json);
+  int64_t id = 0;
+  EXPECT_EQ_INT(LJSON_PARSE_OK, doc["user"]["id"].get_int64(&id));
+  EXPECT_EQ_INT64(1541815603606036480LL, id);
+  uint64_t uid = 0;
+  EXPECT_EQ_INT(LJSON_PARSE_OK, doc["user"]["id"].get_uint64(&uid));
+  EXPECT_EQ_UINT64(1541815603606036480ULL, uid);
+  ljson_ondemand_value user = doc["user"];
+  EXPECT_EQ_INT(LJSON_OBJECT, user.get_type());
+  std::string name;
+  EXPECT_EQ_INT(LJSON_PARSE_OK, user["name"].get_string(&name));
+  EXPECT_EQ_STRING(std::string("a\xC3\xA9" "b"), name);
+  const char* str = nullptr;
+  size_t len = 0;
+  EXPECT_EQ_INT(LJSON_PARSE_OK, user["name"].get_string(&str, &len));
+  EXPECT_EQ_STRING(std::string("a\xC3\xA9" "b"), std::string(str, len));
+  /// a string without escape points into the input
+  EXPECT_EQ_INT(LJSON_PARSE_OK, doc["plain"].get_string(&str, &len));
+  EXPECT_TRUE(str > json && str < json + strlen(json));
+  EXPECT_EQ_STRING(std::string("text"), std::string(str, len));
+  size_t size = 0;
+  EXPECT_EQ_INT(LJSON_PARSE_OK, user["tags"].size(&size));
+  EXPECT_EQ_SIZE_T(4, size);
+  EXPECT_EQ_INT(LJSON_PARSE_OK, doc.root().size(&size));
+  EXPECT_EQ_SIZE_T(4, size);
+  EXPECT_EQ_INT(LJSON_PARSE_OK, user["tags"][1].get_null());
+  bool b = false;
+  EXPECT_EQ_INT(LJSON_PARSE_OK, user["tags"][2].get_bool(&b));
+  EXPECT_TRUE(b);
+  double number = 0.0;
+  EXPECT_EQ_INT(LJSON_PARSE_OK, user["tags"][3].get_number(&number));
+  EXPECT_EQ_DOUBLE(-1.5, number);
+  /// keys are compared unescaped
+  EXPECT_EQ_INT(LJSON_PARSE_OK, doc["esc"].get_bool(&b));
+  EXPECT_TRUE(!b);
+  EXPECT_EQ_INT(LJSON_PARSE_OK, doc["skip"][2].get_string(&name));
+  EXPECT_EQ_STRING(std::string("\\"), name);
+  EXPECT_EQ_INT(LJSON_PARSE_OK, doc["skip"][0]["a"].get_string(&name));
+  EXPECT_EQ_STRING(std::string("]}\"[{"), name);
+
+  /// brackets, quotes and backslash runs in skipped strings land on every offset of a 64 byte stretch
+  for (size_t shift = 0; shift < 70; ++shift) {
+    std::string skipped = "{\"skip\":[" + std::string(shift, ' ') + "\"]\\\\\",{\"k\":[\"}\\\"]\\\\\"]},";
+    for (int i = 0; i < 5; ++i)
+      skipped += "[[\"\\\\\\\"[\"],{\"a\":{}}],";
+    skipped += "\"" + std::string(shift, '\\') + std::string(shift % 2, '\\') + "\"], \"x\":5}";
+    int ret = LJSON_PARSE_OK;
+    ljson_value::parse(skipped.data(), skipped.size(), &ret);
+    EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+    ljson_ondemand_document skipping(skipped.data(), skipped.size());
+    EXPECT_EQ_INT(LJSON_PARSE_OK, skipping["x"].get_int64(&id));
+    EXPECT_EQ_INT64(5, id);
+    EXPECT_EQ_INT(LJSON_PARSE_OK, skipping["skip"].size(&size));
+    EXPECT_EQ_SIZE_T(8, size);
+  }
+
+  ljson_ondemand_document scalar("  42 ");
+  EXPECT_EQ_INT(LJSON_PARSE_OK, scalar.root().get_number(&number));
+  EXPECT_EQ_DOUBLE(42.0, number);
+  std::string padded = "[1,[2,3],4]" + std::string(LJSON_PADDING, ' ');
+  auto padded_doc = ljson_ondemand_document::padded(padded.data(), 11);
+  EXPECT_EQ_INT(LJSON_PARSE_OK, padded_doc[2].get_int64(&id));
+  EXPECT_EQ_INT64(4, id);
+}
+
+static void test_ondemand_error() {
+  ljson_ondemand_document doc("{\"a\":[1,2],\"b\":\"s\",\"c\":1x,\"d\":-1}");
+  int64_t i = 0;
+  uint64_t u = 0;
+  double number = 0.0;
+  EXPECT_EQ_INT(LJSON_ACCESS_NO_SUCH_KEY, doc["z"].error());
+  EXPECT_EQ_INT(LJSON_ACCESS_NO_SUCH_KEY, doc["z"]["y"][0].get_int64(&i));
+  EXPECT_EQ_INT(LJSON_ACCESS_INDEX_OUT_OF_RANGE, doc["a"][2].error());
+  EXPECT_EQ_INT(LJSON_ACCESS_INCORRECT_TYPE, doc["a"]["x"].error());
+  EXPECT_EQ_INT(LJSON_ACCESS_INCORRECT_TYPE, doc["b"][0].error());
+  EXPECT_EQ_INT(LJSON_ACCESS_INCORRECT_TYPE, doc["b"].get_number(&number));
+  EXPECT_EQ_INT(LJSON_ACCESS_INCORRECT_TYPE, doc["d"].get_uint64(&u));
+  EXPECT_EQ_INT(LJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, doc["c"].get_int64(&i));
+  /// "c" is only skipped on the way to "d"
+  EXPECT_EQ_INT(LJSON_PARSE_OK, doc["d"].get_int64(&i));
+  EXPECT_EQ_INT64(-1, i);
+
+  EXPECT_EQ_INT(LJSON_PARSE_EXPECT_VALUE, ljson_ondemand_document(" ").root().error());
+  EXPECT_EQ_INT(LJSON_PARSE_ROOT_NOT_SINGULAR, ljson_ondemand_document("1 2").root().get_int64(&i));
+  EXPECT_EQ_INT(LJSON_PARSE_INVALID_VALUE, ljson_ondemand_document("nul").root().get_null());
+  EXPECT_EQ_INT(LJSON_PARSE_MISS_QUOTATION_MARK, ljson_ondemand_document("[\"a]").root()[1].error());
+  EXPECT_EQ_INT(LJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, ljson_ondemand_document("[[1,2]").root()[1].error());
+  EXPECT_EQ_INT(LJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, ljson_ondemand_document("[1 2]").root()[1].error());
+  EXPECT_EQ_INT(LJSON_PARSE_INVALID_VALUE, ljson_ondemand_document("[1,]").root()[1].error());
+  EXPECT_EQ_INT(LJSON_PARSE_MISS_KEY, ljson_ondemand_document("{1:2}")["a"].error());
+  EXPECT_EQ_INT(LJSON_PARSE_MISS_COLON, ljson_ondemand_document("{\"a\" 1}")["a"].error());
+  EXPECT_EQ_INT(LJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, ljson_ondemand_document("{\"a\":1")["b"].error());
+  std::string str;
+  EXPECT_EQ_INT(LJSON_PARSE_INVALID_STRING_ESCAPE, ljson_ondemand_document("\"\\x\"").root().get_string(&str));
+}
+
+#if defined(__unix__)
+/// @return: path of a new temporary file holding content
+static std::string write_temp_file(const std::string& content) {
+  char path[] = "/tmp/ljson_test_XXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0)
+    return "";
+  EXPECT_TRUE(write(fd, content.data(), content.size()) == static_cast<ssize_t>(content.size()));
+  close(fd);
+  return path;
+}
+
+/// whether path is mapped in this process, always false where /proc is missing
+static bool is_mapped(const std::string& path) {
+  std::ifstream maps("/proc/self/maps");
+  std::string line;
+  while (std::getline(maps, line))
+    if (line.find(path) != std::string::npos)
+      return true;
+  return false;
+}
+
+static void test_parse_file() {
+  std::string path = write_temp_file("{\"name\" : \"ljson\", \"escaped\" : \"a\\u00e9\", \"ids\" : [1, 2, 3]}\n");
+  int ret = LJSON_PARSE_OK;
+  auto value = ljson_value::parse_file(path.c_str(), &ret);
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+  auto members = ljson_objects::get_value_helper(value->get_value());
+  EXPECT_EQ_SIZE_T(3, members.size());
+  EXPECT_EQ_STRING(std::string("ljson"), ljson_string::get_value_helper(members[0]->value->get_value()));
+
+  auto compact = ljson_compact_value::parse_file(path.c_str(), &ret);
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+  EXPECT_TRUE(!is_mapped(path));
+  compact = ljson_compact_value::parse_file(path.c_str(), &ret, LJSON_FILE_ZERO_COPY);
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+  EXPECT_EQ_STRING(std::string("ljson"), std::string(compact->get_member(0).value.get_string(),
+                                                     compact->get_member(0).value.get_string_length()));
+  EXPECT_EQ_STRING(std::string("a\xC3\xA9"), std::string(compact->get_member(1).value.get_string(),
+                                                         compact->get_member(1).value.get_string_length()));
+  EXPECT_EQ_SIZE_T(3, compact->get_member(2).value.size());
+  /// the document keeps the mapping its strings point into
+#if defined(__linux__)
+  EXPECT_TRUE(is_mapped(path));
+#endif
+  compact.reset();
+  EXPECT_TRUE(!is_mapped(path));
+
+  auto tape = ljson_tape::parse_file(path.c_str(), &ret);
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+  EXPECT_EQ_SIZE_T(3, tape->root().size());
+  auto file = ljson_mapped_file::open(path.c_str());
+  EXPECT_TRUE(file != nullptr && file->padded());
+  unlink(path.c_str());
+
+  /// a file filling its last page has no padding
+  auto page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  path = write_temp_file("[" + std::string(page - 3, ' ') + "1]");
+  file = ljson_mapped_file::open(path.c_str());
+  EXPECT_TRUE(file != nullptr && !file->padded());
+  EXPECT_EQ_SIZE_T(page, file->size());
+  value = ljson_value::parse_file(path.c_str(), &ret, LJSON_FILE_ZERO_COPY);
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+  unlink(path.c_str());
+
+  path = write_temp_file("");
+  value = ljson_value::parse_file(path.c_str(), &ret);
+  EXPECT_EQ_INT(LJSON_PARSE_EXPECT_VALUE, ret);
+  path = write_temp_file("[1,");
+  value = ljson_value::parse_file(path.c_str(), &ret, LJSON_FILE_ZERO_COPY);
+  EXPECT_EQ_INT(LJSON_PARSE_EXPECT_VALUE, ret);
+  EXPECT_NULL(value);
+  EXPECT_TRUE(!is_mapped(path));
+  unlink(path.c_str());
+
+  errno = 0;
+  value = ljson_value::parse_file("/nonexistent/ljson.json", &ret);
+  EXPECT_EQ_INT(LJSON_FILE_ERROR, ret);
+  EXPECT_EQ_INT(ENOENT, errno);
+  EXPECT_NULL(value);
+}
+#endif
+
+static void test_parser_reuse() {
+  const char* json = "{ \"id\" : 7, \"name\" : \"a\\tb\", \"tags\" : [ \"x\", true, null ] }";
+  for (LJSON_ENGINE engine : {LJSON_ENGINE_ONE_PASS, LJSON_ENGINE_TWO_STAGE}) {
+    ljson_parser parser(LJSON_PARSE_MAX_DEPTH, engine);
+    int ret = LJSON_PARSE_OK;
+    const ljson_value* roots[3];
+    for (int i = 0; i < 3; ++i) {
+      auto value = parser.parse(json, &ret);
+      EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+      auto objects = ljson_objects::get_value_helper(value->get_value());
+      EXPECT_EQ_SIZE_T(3, objects.size());
+      EXPECT_EQ_STRING("a\tb", ljson_string::get_value_helper(objects[1]->value->get_value()));
+      roots[i] = value.get();
+    }
+    /* each document was dropped before the next one, the arena is reused */
+    EXPECT_TRUE(roots[1] == roots[2]);
+    /* a document still alive keeps its arena, the next one gets a new one */
+    auto kept = parser.parse("[ \"kept\", 1 ]", &ret);
+    auto other = parser.parse("[ \"other\", 2 ]", &ret);
+    EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+    auto array = ljson_array::get_value_helper(kept->get_value());
+    EXPECT_EQ_STRING("kept", ljson_string::get_value_helper(array[0]->get_value()));
+    EXPECT_EQ_DOUBLE(1.0, ljson_number::get_value_helper(array[1]->get_value()));
+    array = ljson_array::get_value_helper(other->get_value());
+    EXPECT_EQ_STRING("other", ljson_string::get_value_helper(array[0]->get_value()));
+    /* compact documents share the same buffers */
+    auto compact = parser.parse_compact("[ 1, { \"k\" : \"v\" } ]", &ret);
+    EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+    EXPECT_EQ_SIZE_T(2, compact->size());
+    EXPECT_EQ_STRING("v", std::string((*compact)[1].get_member(0).value.get_string(), 1));
+    char insitu[] = "[ \"in\\nsitu\" ]";
+    auto value = parser.parse_insitu(insitu, &ret);
+    EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+    array = ljson_array::get_value_helper(value->get_value());
+    EXPECT_EQ_STRING("in\nsitu", ljson_string::get_value_helper(array[0]->get_value()));
+  }
+  /* without reuse_arena every document gets its own arena */
+  ljson_parser fresh(LJSON_PARSE_MAX_DEPTH, LJSON_ENGINE_ONE_PASS, false);
+  int ret = LJSON_PARSE_OK;
+  for (int i = 0; i < 2; ++i) {
+    auto value = fresh.parse("[ [ [ 1 ] ] ]", &ret);
+    EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+    EXPECT_EQ_INT(LJSON_ARRAY, value->get_type());
+  }
+}
+
+static void test_parser_error() {
+  for (LJSON_ENGINE engine : {LJSON_ENGINE_ONE_PASS, LJSON_ENGINE_TWO_STAGE}) {
+    ljson_parser parser(2, engine);
+    int ret = LJSON_PARSE_OK;
+    /* values of the containers left open are dropped, the next parse starts clean */
+    EXPECT_TRUE(parser.parse("[ \"a\\u12\", 1 ]", &ret) == nullptr);
+    EXPECT_EQ_INT(LJSON_PARSE_INVALID_UNICODE_HEX, ret);
+    EXPECT_TRUE(parser.parse("{ \"a\" : [ 1, 2 }", &ret) == nullptr);
+    EXPECT_EQ_INT(LJSON_PARSE_MISS_COMMA_OR_SQUARE_BRACKET, ret);
+    EXPECT_TRUE(parser.parse_compact("[ [ [ ] ] ]", &ret) == nullptr);
+    EXPECT_EQ_INT(LJSON_PARSE_NESTING_TOO_DEEP, ret);
+    auto value = parser.parse("[ [ 1, \"b\" ] ]", &ret);
+    EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+    auto array = ljson_array::get_value_helper(value->get_value());
+    EXPECT_EQ_SIZE_T(1, array.size());
+    EXPECT_EQ_SIZE_T(2, ljson_array::get_value_helper(array[0]->get_value()).size());
+    value = nullptr;
+    parser.reset();
+    value = parser.parse("7", &ret);
+    EXPECT_EQ_DOUBLE(7.0, ljson_number::get_value_helper(value->get_value()));
+    parser.release();
+    EXPECT_TRUE(parser.parse("", &ret) == nullptr);
+    EXPECT_EQ_INT(LJSON_PARSE_EXPECT_VALUE, ret);
+    value = parser.parse(" null ", &ret);
+    EXPECT_EQ_INT(LJSON_NULL, value->get_type());
+  }
+}
+
 static void test_parse() {
   test_parse_null();
   test_parse_false();
   test_parse_true();
   test_parse_number();
+  test_parse_number_exact();
+  test_parse_integer();
   test_parse_string();
+  test_parse_string_blocks();
+  test_parse_insitu_string();
+  test_parse_insitu();
+  test_parse_insitu_error();
+  test_parse_whitespace();
+  test_parse_bounded();
+  test_parse_nesting();
+  test_parse_bounded_prefixes();
+#if defined(__unix__)
+  test_parse_bounded_page_end();
+  test_parse_file();
+#endif
   test_parse_array();
   test_parse_objects();
   test_parse_expect_value();
@@ -410,16 +1846,625 @@ static void test_parse() {
   test_parse_miss_comma_or_square_bracket();
 }
 
+static void test_access_views() {
+  int ret = LJSON_PARSE_OK;
+  auto value = ljson_value::parse("[ \"ab\\u0000c\", [ 1, 2, 3 ], { \"k\" : null, \"l\" : \"v\" } ]", &ret);
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+  const ljson_value& root = *value;
+  EXPECT_EQ_SIZE_T(3, root.size());
+  EXPECT_EQ_SIZE_T(4, root[0].size());
+  EXPECT_EQ_STRING(std::string("ab\0c", 4), std::string(root[0].as_string(), root[0].size()));
+  double sum = 0.0;
+  for (const ljson_value& e : root[1].as_array())
+    sum += ljson_number::get_value_helper(e.get_value());
+  EXPECT_EQ_DOUBLE(6.0, sum);
+  const ljson_array& array = root.as_array();
+  EXPECT_EQ_SIZE_T(3, static_cast<size_t>(array.end() - array.begin()));
+  EXPECT_TRUE(&*array.begin() == &root[0]);
+  EXPECT_EQ_INT(LJSON_OBJECT, array.begin()[2].get_type());
+  const ljson_objects& object = root[2].as_object();
+  EXPECT_EQ_SIZE_T(2, object.size());
+  std::string keys;
+  for (const ljson_objects::entry& m : object)
+    keys += std::string(m.key, m.key_size);
+  EXPECT_EQ_STRING("kl", keys);
+  EXPECT_EQ_INT(LJSON_NULL, object[0].value->get_type());
+  EXPECT_EQ_STRING("v", std::string(object[1].value->as_string(), object[1].value->size()));
+  /* views of a parsed node follow set_value() */
+  auto elements = ljson_array::get_value_helper(value->get_value());
+  elements[0]->set_value(std::make_shared<std::string>("changed"));
+  EXPECT_EQ_STRING("changed", std::string(root[0].as_string(), root[0].size()));
+  /* built values have the same views */
+  auto built = ljson_array::create({ljson_string::create("x"), ljson_number::create(2.0)});
+  EXPECT_EQ_SIZE_T(2, built->size());
+  EXPECT_EQ_STRING("x", std::string((*built)[0].as_string(), (*built)[0].size()));
+  EXPECT_EQ_INT(LJSON_NUMBER, (*built)[1].get_type());
+  built->set_value(std::make_shared<std::vector<std::shared_ptr<ljson_value>>>(
+      std::vector<std::shared_ptr<ljson_value>>{ljson_null::create()}));
+  EXPECT_EQ_SIZE_T(1, built->size());
+  EXPECT_EQ_INT(LJSON_NULL, (*built)[0].get_type());
+  auto members = ljson_objects::create({std::make_shared<ljson_member>("key", ljson_true::create())});
+  EXPECT_EQ_SIZE_T(1, members->size());
+  const ljson_objects::entry& m = members->as_object()[0];
+  EXPECT_EQ_STRING("key", std::string(m.key, m.key_size));
+  EXPECT_EQ_INT(LJSON_TRUE, m.value->get_type());
+  /* members passed in or handed out are copies, assigning to them leaves the object as it is */
+  std::vector<std::shared_ptr<ljson_member>> kept{std::make_shared<ljson_member>("a", ljson_string::create("v")),
+                                                  std::make_shared<ljson_member>("b", ljson_null::create())};
+  auto shared = ljson_objects::create(kept);
+  kept[0]->key = std::string(100, 'k');
+  kept[0]->value = ljson_false::create();
+  auto handed = ljson_objects::get_value_helper(shared->get_value());
+  handed[1]->key = "renamed";
+  handed[1]->value = ljson_string::create("x");
+  EXPECT_EQ_STRING("v", std::string((*shared)["a"].as_string(), (*shared)["a"].size()));
+  EXPECT_EQ_INT(LJSON_NULL, shared->as_object().find("b")->get_type());
+  EXPECT_TRUE(shared->as_object().find("renamed") == nullptr);
+  keys.clear();
+  for (const ljson_objects::entry& e : shared->as_object())
+    keys += std::string(e.key, e.key_size) + (e.value->get_type() == LJSON_STRING ? "s" : "n");
+  EXPECT_EQ_STRING("asbn", keys);
+  EXPECT_EQ_STRING("{\"a\":\"v\",\"b\":null}", ljson_generator::stringify(*shared));
+  EXPECT_TRUE(ljson_objects().begin() == ljson_objects().end());
+  EXPECT_EQ_SIZE_T(0, ljson_array::create()->size());
+}
+
+static void test_access_find() {
+  int ret = LJSON_PARSE_OK;
+  auto small = ljson_value::parse("{ \"a\" : { \"b\" : 1 }, \"dup\" : 2, \"dup\" : 3, \"\" : 4 }", &ret);
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+  EXPECT_EQ_DOUBLE(1.0, ljson_number::get_value_helper((*small)["a"]["b"].get_value()));
+  EXPECT_EQ_DOUBLE(2.0, ljson_number::get_value_helper((*small)["dup"].get_value()));
+  EXPECT_EQ_DOUBLE(4.0, ljson_number::get_value_helper((*small)[std::string()].get_value()));
+  EXPECT_TRUE(small->as_object().find("missing") == nullptr);
+  EXPECT_TRUE(small->as_object().find("dupx", 3) == small->as_object().find("dup"));
+  EXPECT_EQ_INT(LJSON_NULL, (*small)["missing"].get_type());
+  /* every step of a chain past a missing key or a value of another type reads as null */
+  EXPECT_EQ_INT(LJSON_NULL, (*small)["missing"]["b"].get_type());
+  EXPECT_EQ_INT(LJSON_NULL, (*small)["missing"]["b"][0]["c"].get_type());
+  EXPECT_EQ_INT(LJSON_NULL, (*small)["dup"]["b"].get_type());
+  EXPECT_EQ_INT(LJSON_NULL, (*small)["dup"][0].get_type());
+  EXPECT_EQ_INT(LJSON_NULL, (*small)["a"][std::string("b")]["c"].get_type());
+  EXPECT_EQ_INT(LJSON_NULL, (*small)[0].get_type());
+  auto array = ljson_value::parse("[[1], \"s\"]", &ret);
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+  EXPECT_EQ_DOUBLE(1.0, ljson_number::get_value_helper((*array)[0][0].get_value()));
+  EXPECT_EQ_INT(LJSON_NULL, (*array)[0][1].get_type());
+  EXPECT_EQ_INT(LJSON_NULL, (*array)[2]["a"].get_type());
+  EXPECT_EQ_INT(LJSON_NULL, (*array)[1][0].get_type());
+  EXPECT_EQ_INT(LJSON_NULL, (*array)["a"].get_type());
+  /* large objects go through the hash index, the same answers */
+  std::string json = "{";
+  for (int i = 0; i < 1000; ++i)
+    json += "\"key" + std::to_string(i) + "\":" + std::to_string(i) + ",";
+  json += "\"key7\":-1,\"\":\"empty\"}";
+  auto large = ljson_value::parse(json.c_str(), &ret);
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+  const ljson_objects& object = large->as_object();
+  EXPECT_EQ_SIZE_T(1002, object.size());
+  bool all = true;
+  for (int i = 0; i < 1000; ++i) {
+    const ljson_value* v = object.find("key" + std::to_string(i));
+    all = all && v != nullptr && ljson_number::get_value_helper(v->get_value()) == i;
+  }
+  EXPECT_TRUE(all);
+  /* the first of duplicate keys wins */
+  EXPECT_EQ_DOUBLE(7.0, ljson_number::get_value_helper(object["key7"].get_value()));
+  EXPECT_EQ_STRING("empty", std::string((*large)[""].as_string(), (*large)[""].size()));
+  EXPECT_TRUE(object.find("key1000") == nullptr);
+  EXPECT_TRUE(object.find("key") == nullptr);
+  /* the index follows set_value() */
+  /* members holding values of the document itself would keep its arena alive forever */
+  std::vector<std::shared_ptr<ljson_member>> members;
+  for (int i = 0; i < 20; ++i)
+    members.push_back(std::make_shared<ljson_member>("key" + std::to_string(i), ljson_number::create(i)));
+  members[3] = std::make_shared<ljson_member>("renamed", ljson_true::create());
+  large->set_value(std::make_shared<std::vector<std::shared_ptr<ljson_member>>>(members));
+  EXPECT_TRUE(object.find("key3") == nullptr);
+  EXPECT_TRUE(object.find("key30") == nullptr);
+  EXPECT_EQ_INT(LJSON_TRUE, object["renamed"].get_type());
+  EXPECT_EQ_DOUBLE(19.0, ljson_number::get_value_helper(object["key19"].get_value()));
+  /* built objects */
+  std::vector<std::shared_ptr<ljson_member>> built;
+  for (int i = 0; i < 40; ++i)
+    built.push_back(std::make_shared<ljson_member>("m" + std::to_string(i), ljson_number::create(i)));
+  auto value = ljson_objects::create(built);
+  EXPECT_EQ_DOUBLE(39.0, ljson_number::get_value_helper((*value)["m39"].get_value()));
+  built.resize(2);
+  value->set_value(std::make_shared<std::vector<std::shared_ptr<ljson_member>>>(built));
+  EXPECT_TRUE(value->as_object().find("m39") == nullptr);
+  EXPECT_EQ_DOUBLE(1.0, ljson_number::get_value_helper((*value)["m1"].get_value()));
+  /* the index is over the object's own members, assigning to the ones passed in or handed out changes nothing */
+  std::vector<std::shared_ptr<ljson_member>> kept;
+  for (int i = 0; i < 40; ++i)
+    kept.push_back(std::make_shared<ljson_member>("m" + std::to_string(i), ljson_number::create(i)));
+  value = ljson_objects::create(kept);
+  EXPECT_EQ_DOUBLE(39.0, ljson_number::get_value_helper((*value)["m39"].get_value()));
+  auto handed = ljson_objects::get_value_helper(value->get_value());
+  for (int i = 0; i < 40; ++i) {
+    kept[i]->key = "x" + std::string(64, 'y') + std::to_string(i);
+    kept[i]->value = ljson_null::create();
+    handed[i]->key = "z" + std::to_string(i);
+    handed[i]->value = ljson_null::create();
+  }
+  all = true;
+  for (int i = 0; i < 40; ++i) {
+    const ljson_value* v = value->as_object().find("m" + std::to_string(i));
+    all = all && v != nullptr && ljson_number::get_value_helper(v->get_value()) == i;
+  }
+  EXPECT_TRUE(all);
+  EXPECT_TRUE(value->as_object().find("z0") == nullptr);
+}
+
+static void test_access_find_concurrent() {
+  std::string json = "{";
+  for (int i = 0; i < 500; ++i)
+    json += (i ? ",\"k" : "\"k") + std::to_string(i) + "\":" + std::to_string(i);
+  json += "}";
+  int ret = LJSON_PARSE_OK;
+  auto value = ljson_value::parse(json.c_str(), &ret);
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+  /* the first lookups race to build the index */
+  std::atomic<int> found(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t)
+    threads.emplace_back([&value, &found, t] {
+      for (int i = t; i < 500; i += 4)
+        if (value->as_object().find("k" + std::to_string(i)) != nullptr)
+          found++;
+    });
+  for (auto& t : threads)
+    t.join();
+  EXPECT_EQ_INT(500, found.load());
+}
+
+/* both document types are written back the same way */
+#define TEST_STRINGIFY(expect, json) \
+do { \
+  int ret = LJSON_PARSE_OK; \
+  auto value = ljson_value::parse(json, &ret); \
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ret); \
+  EXPECT_EQ_STRING(std::string(expect), ljson_generator::stringify(*value)); \
+  auto compact = ljson_compact_value::parse(json, &ret); \
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ret); \
+  EXPECT_EQ_STRING(std::string(expect), ljson_generator::stringify(*compact)); \
+} while(0)
+
+#define TEST_ROUNDTRIP(json) TEST_STRINGIFY(json, json)
+
+static void test_stringify_literal() {
+  TEST_ROUNDTRIP("null");
+  TEST_ROUNDTRIP("true");
+  TEST_ROUNDTRIP("false");
+  TEST_STRINGIFY("[null,true,false]", " [ null , true , false ] ");
+}
+
+static void test_stringify_number() {
+  TEST_ROUNDTRIP("0");
+  TEST_ROUNDTRIP("-1");
+  TEST_ROUNDTRIP("9223372036854775807");
+  TEST_ROUNDTRIP("-9223372036854775808");
+  TEST_ROUNDTRIP("18446744073709551615");
+  TEST_ROUNDTRIP("1.5");
+  TEST_ROUNDTRIP("-0.0");
+  TEST_ROUNDTRIP("0.5");
+  TEST_ROUNDTRIP("1.0000000000000002");
+  /* doubles keep a fraction or an exponent part */
+  TEST_STRINGIFY("0.0", "0e10");
+  TEST_STRINGIFY("-0.0", "-0");
+  TEST_STRINGIFY("100.0", "1e2");
+  TEST_STRINGIFY("9007199254740992.0", "9007199254740992.0");
+  TEST_STRINGIFY("100000000000000000000.0", "1e20");
+  TEST_STRINGIFY("1e+21", "1e21");
+  TEST_STRINGIFY("0.000001", "1e-6");
+  TEST_STRINGIFY("1e-7", "1e-7");
+  TEST_STRINGIFY("1.5e-7", "0.00000015");
+  /* the shortest digits that read back the same */
+  TEST_STRINGIFY("0.1", "0.1");
+  TEST_STRINGIFY("0.3", "0.29999999999999998");
+  TEST_STRINGIFY("1e+300", "1e300");
+  TEST_STRINGIFY("5e-324", "4.9406564584124654e-324");
+  TEST_STRINGIFY("1.7976931348623157e+308", "1.7976931348623157e308");
+  TEST_STRINGIFY("2.2250738585072014e-308", "2.2250738585072014e-308");
+  TEST_STRINGIFY("123456789.125", "123456789.125");
+  TEST_STRINGIFY("-6.02214076e+23", "-6.02214076e23");
+  TEST_STRINGIFY("1.2345678901234567e+89", "12345678901234567e73");
+  TEST_STRINGIFY("9.5367431640625e-7", "9.5367431640625e-7");
+  /* every double reads back the same */
+  const double doubles[] = {0.1, 1.0 / 3, 2.2250738585072014e-308, 123456789.125, -6.02214076e23, 5e-324};
+  for (double d : doubles) {
+    auto text = ljson_generator::stringify(*ljson_number::create(d));
+    int ret = LJSON_PARSE_OK;
+    auto value = ljson_value::parse(text.c_str(), &ret);
+    EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+    EXPECT_EQ_DOUBLE(d, ljson_number::get_value_helper(value->get_value()));
+  }
+  /* no json form, written as null */
+  EXPECT_EQ_STRING(std::string("null"), ljson_generator::stringify(*ljson_number::create(HUGE_VAL)));
+  EXPECT_EQ_STRING(std::string("null"), ljson_generator::stringify(*ljson_number::create(std::nan(""))));
+}
+
+/* random bit patterns: the text reads back as the same bits and is no longer than printf's shortest */
+static void test_stringify_number_random() {
+  uint64_t seed = 88172645463325252ull;
+  for (int round = 0; round < 20000; ++round) {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    uint64_t bits = seed;
+    if (round % 4 == 1)
+      bits &= 0x800FFFFFFFFFFFFFull | (static_cast<uint64_t>(round % 3) << 52);  /* subnormals and tiny */
+    else if (round % 4 == 2)
+      bits &= 0xFFF0000000000000ull | 0xFFull << (round % 40);                  /* few fraction bits */
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    if (!std::isfinite(d))
+      continue;
+    auto text = ljson_generator::stringify(*ljson_number::create(d));
+    int ret = LJSON_PARSE_OK;
+    auto value = ljson_value::parse(text.c_str(), &ret);
+    EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+    EXPECT_EQ_INT(LJSON_NUMBER, value->get_type());
+    double back = ljson_number::get_value_helper(value->get_value());
+    EXPECT_TRUE(memcmp(&d, &back, sizeof(d)) == 0);
+
+    std::string mantissa;
+    for (char ch : text.substr(0, text.find('e')))
+      if (ch >= '0' && ch <= '9')
+        mantissa += ch;
+    size_t first = mantissa.find_first_not_of('0'), last = mantissa.find_last_not_of('0');
+    int digits = first == std::string::npos ? 1 : static_cast<int>(last - first + 1);
+    char shortest[32];
+    for (int precision = 1; precision <= 17; ++precision) {
+      snprintf(shortest, sizeof(shortest), "%.*e", precision - 1, d);
+      if (strtod(shortest, nullptr) == d) {
+        EXPECT_TRUE(digits <= precision);
+        break;
+      }
+    }
+  }
+}
+
+static void test_stringify_string() {
+  TEST_ROUNDTRIP("\"\"");
+  TEST_ROUNDTRIP("\"Hello\"");
+  TEST_ROUNDTRIP("\"Hello\\nWorld\"");
+  TEST_ROUNDTRIP("\"\\\" \\\\ / \\b \\f \\n \\r \\t\"");
+  TEST_ROUNDTRIP("\"Hello\\u0000World\"");
+  TEST_ROUNDTRIP("\"\\u0001\\u001F\"");
+  /* '/' and non ascii bytes are not escaped */
+  TEST_STRINGIFY("\"/\xC2\xA2\xE2\x82\xAC\xF0\x9D\x84\x9E\"", "\"\\/\\u00A2\\u20AC\\uD834\\uDD1E\"");
+  /* a long string with an escape near its end */
+  std::string text(1000, 'x');
+  text += "\\t";
+  TEST_ROUNDTRIP(("\"" + text + "\"").c_str());
+  /* escapes at every offset of the scanned blocks, in strings and keys */
+  for (size_t offset = 0; offset < 70; ++offset) {
+    std::string str = std::string(offset, 'x') + "\\u0001\\n" + std::string(offset % 40, 'y') + "\\\"";
+    TEST_ROUNDTRIP(("\"" + str + "\"").c_str());
+    TEST_ROUNDTRIP(("{\"" + str + "\":\"" + str + "\"}").c_str());
+  }
+  /* a long run of escapes, up to six bytes written for one */
+  std::string controls;
+  for (int i = 0; i < 300; ++i)
+    controls += i % 2 ? "\\u001F" : "\\r\\n";
+  TEST_ROUNDTRIP(("\"" + controls + "\"").c_str());
+}
+
+static void test_stringify_container() {
+  TEST_ROUNDTRIP("[]");
+  TEST_ROUNDTRIP("{}");
+  TEST_ROUNDTRIP("[null,false,true,123,\"abc\",[1,2,3]]");
+  TEST_ROUNDTRIP("{\"n\":null,\"f\":false,\"t\":true,\"i\":123,\"s\":\"abc\",\"a\":[1,2,3],"
+                 "\"o\":{\"1\":1,\"2\":2,\"3\":3}}");
+  TEST_ROUNDTRIP("{\"k\\ney\":[[[]],{}],\"dup\":1,\"dup\":2}");
+  /* built values, and appending to a buffer */
+  auto built = ljson_array::create({ljson_string::create("a\"b"), ljson_number::create_int64(-5),
+                                    ljson_objects::create({std::make_shared<ljson_member>("x", ljson_null::create())})});
+  ljson_buffer out;
+  out.append("data: ", 6);
+  ljson_generator::stringify(*built, &out);
+  EXPECT_EQ_STRING(std::string("data: [\"a\\\"b\",-5,{\"x\":null}]"), out.str());
+  size_t capacity = out.capacity();
+  out.clear();
+  ljson_generator::stringify(*built, &out);
+  EXPECT_EQ_SIZE_T(capacity, out.capacity());
+  EXPECT_EQ_STRING(std::string("[\"a\\\"b\",-5,{\"x\":null}]"), out.str());
+}
+
+static void test_stringify_large() {
+  std::string json = "[";
+  for (int i = 0; i < 10000; ++i)
+    json += (i ? ",{\"id\":" : "{\"id\":") + std::to_string(i) + ",\"name\":\"name\\t" + std::to_string(i) + "\"}";
+  json += "]";
+  TEST_ROUNDTRIP(json.c_str());
+}
+
+/* far deeper than any call stack would allow, like test_parse_nesting() */
+static void test_stringify_deep() {
+  std::string deep = make_nested_arrays(1000000);
+  int ret = LJSON_PARSE_OK;
+  auto value = ljson_value::parse(deep.c_str(), &ret, deep.size());
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+  EXPECT_TRUE(ljson_generator::stringify(*value) == deep);
+  auto compact = ljson_compact_value::parse(deep.c_str(), &ret, deep.size());
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+  EXPECT_TRUE(ljson_generator::stringify(*compact) == deep);
+  /* objects and arrays in turn, with members after the deep ones */
+  std::string mixed;
+  for (int i = 0; i < 100000; ++i)
+    mixed += "{\"a\":[";
+  mixed += "null";
+  for (int i = 0; i < 100000; ++i)
+    mixed += "],\"b\":1}";
+  value = ljson_value::parse(mixed.c_str(), &ret, mixed.size());
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+  EXPECT_TRUE(ljson_generator::stringify(*value) == mixed);
+  compact = ljson_compact_value::parse(mixed.c_str(), &ret, mixed.size());
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+  EXPECT_TRUE(ljson_generator::stringify(*compact) == mixed);
+}
+
+#if defined(__unix__)
+/// @return: everything written to a pipe by fn, read on another thread as it comes
+static std::string read_pipe(const std::function<void(int fd)>& fn) {
+  int fds[2];
+  EXPECT_EQ_INT(0, pipe(fds));
+  std::string received;
+  std::thread reader([&] {
+    char chunk[4096];
+    ssize_t n;
+    while ((n = read(fds[0], chunk, sizeof(chunk))) > 0)
+      received.append(chunk, static_cast<size_t>(n));
+  });
+  fn(fds[1]);
+  close(fds[1]);
+  reader.join();
+  close(fds[0]);
+  return received;
+}
+
+static void test_stringify_fd() {
+  /* long strings and keys are referenced, short ones and escapes copied, more segments than IOV_MAX */
+  std::string json = "{\"" + std::string(600, 'k') + "\":\"" + std::string(100000, 'a') + "\\n" +
+                     std::string(700, 'b') + "\\\"\\\"\",\"items\":[";
+  for (int i = 0; i < 3000; ++i)
+    json += (i ? "," : "") + std::string("{\"n\":") + std::to_string(i * 0.5) + ",\"s\":\"" +
+            std::string(500 + i % 50, static_cast<char>('a' + i % 26)) + "\",\"short\":\"x\"}";
+  json += "],\"end\":null}";
+  int ret = LJSON_PARSE_OK;
+  auto value = ljson_value::parse(json.c_str(), &ret);
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+  auto compact = ljson_compact_value::parse(json.c_str(), &ret);
+  EXPECT_EQ_INT(LJSON_PARSE_OK, ret);
+  std::string expect = ljson_generator::stringify(*value);
+
+  EXPECT_EQ_STRING(expect, read_pipe([&](int fd) { EXPECT_TRUE(ljson_generator::write(*value, fd)); }));
+  EXPECT_EQ_STRING(expect, read_pipe([&](int fd) { EXPECT_TRUE(ljson_generator::write(*compact, fd)); }));
+  EXPECT_EQ_STRING(std::string("[1,\"s\"]"), read_pipe([&](int fd) {
+    EXPECT_TRUE(ljson_generator::write(*ljson_value::parse("[1,\"s\"]", &ret), fd));
+  }));
+
+  /* a file, read back */
+  std::string path = write_temp_file("");
+  int fd = open(path.c_str(), O_WRONLY | O_TRUNC);
+  EXPECT_TRUE(ljson_generator::write(*value, fd));
+  close(fd);
+  std::ifstream in(path, std::ios::binary);
+  EXPECT_EQ_STRING(expect, std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()));
+  unlink(path.c_str());
+
+  EXPECT_TRUE(!ljson_generator::write(*value, -1));
+  EXPECT_EQ_INT(EBADF, errno);
+}
+#endif
+
+static void test_writer_buffer() {
+  ljson_buffer out;
+  ljson_writer writer(&out);
+  writer.start_object();
+  writer.key("id");
+  writer.number(42);
+  writer.key(std::string("ratio"));
+  writer.number(0.1);
+  writer.key("big", 3);
+  writer.number(static_cast<uint64_t>(18446744073709551615ull));
+  writer.key("name");
+  writer.string("a\"b\n");
+  writer.key("tags");
+  writer.start_array();
+  writer.string(std::string("x"));
+  writer.null();
+  writer.boolean(true);
+  writer.boolean(false);
+  writer.start_array();
+  writer.end_array();
+  writer.start_object();
+  writer.end_object();
+  writer.end_array();
+  writer.end_object();
+  EXPECT_TRUE(writer.flush());
+  EXPECT_EQ_STRING(std::string("{\"id\":42,\"ratio\":0.1,\"big\":18446744073709551615,\"name\":\"a\\\"b\\n\","
+                               "\"tags\":[\"x\",null,true,false,[],{}]}"), out.str());
+
+  /* a scalar document, then a new one after reset() */
+  out.clear();
+  writer.reset();
+  writer.number(-1);
+  writer.reset();
+  writer.string("s");
+  EXPECT_EQ_STRING(std::string("-1\"s\""), out.str());
+
+  /* parsed documents go in as values */
+  int ret = LJSON_PARSE_OK;
+  auto value = ljson_value::parse(" { \"a\" : [ 1 , 2.5 ] } ", &ret);
+  auto compact = ljson_compact_value::parse("[true]", &ret);
+  out.clear();
+  writer.reset();
+  writer.start_array();
+  writer.value(*value);
+  writer.value(*compact);
+  writer.end_array();
+  EXPECT_EQ_STRING(std::string("[{\"a\":[1,2.5]},[true]]"), out.str());
+}
+
+static void test_writer_sink() {
+  /* a document larger than the staging buffer reaches the callback in pieces */
+  std::string expect = "[";
+  for (int i = 0; i < 3000; ++i)
+    expect += (i ? "," : "") + std::string("{\"i\":") + std::to_string(i) + ",\"s\":\"text\"}";
+  expect += "]";
+
+  std::string received;
+  size_t calls = 0;
+  {
+    ljson_writer writer([&](const char* data, size_t len) {
+      received.append(data, len);
+      calls++;
+    });
+    writer.start_array();
+    for (int i = 0; i < 3000; ++i) {
+      writer.start_object();
+      writer.key("i");
+      writer.number(i);
+      writer.key("s");
+      writer.string("text");
+      writer.end_object();
+    }
+    writer.end_array();
+    EXPECT_TRUE(calls > 1);
+    EXPECT_TRUE(received.size() < expect.size());
+    /* the destructor flushes the rest */
+  }
+  EXPECT_EQ_STRING(expect, received);
+
+#if defined(__unix__)
+  /* the same through a pipe */
+  int fds[2];
+  EXPECT_EQ_INT(0, pipe(fds));
+  {
+    ljson_writer writer(fds[1]);
+    writer.start_object();
+    writer.key("k");
+    writer.string(std::string(1000, 'v'));
+    writer.end_object();
+    EXPECT_TRUE(writer.flush());
+    EXPECT_TRUE(writer.ok());
+  }
+  close(fds[1]);
+  std::string piped;
+  char chunk[256];
+  ssize_t n;
+  while ((n = read(fds[0], chunk, sizeof(chunk))) > 0)
+    piped.append(chunk, static_cast<size_t>(n));
+  close(fds[0]);
+  EXPECT_EQ_STRING("{\"k\":\"" + std::string(1000, 'v') + "\"}", piped);
+
+  /* a failed write is reported by flush() and ok() */
+  ljson_writer broken(-1);
+  broken.null();
+  EXPECT_TRUE(!broken.flush());
+  EXPECT_EQ_INT(EBADF, errno);
+  EXPECT_TRUE(!broken.ok());
+#endif
+}
+
 static void test_access() {
   test_access_null();
   test_access_boolean();
   test_access_number();
   test_access_string();
+  test_access_views();
+  test_access_find();
+  test_access_find_concurrent();
+}
+
+static void test_compact() {
+  test_compact_parse();
+  test_compact_parse_error();
+}
+
+static void test_arena() {
+  test_arena_allocate();
+  test_arena_cleanup();
+  test_arena_document_lifetime();
+  test_arena_set_value();
+  test_arena_reset();
+  test_arena_wide_containers();
+  test_arena_large_document();
+}
+
+static void test_stringify() {
+  test_stringify_literal();
+  test_stringify_number();
+  test_stringify_number_random();
+  test_stringify_string();
+  test_stringify_container();
+  test_stringify_large();
+  test_stringify_deep();
+#if defined(__unix__)
+  test_stringify_fd();
+#endif
+}
+
+static void test_writer() {
+  test_writer_buffer();
+  test_writer_sink();
+}
+
+static void test_parser() {
+  test_parser_reuse();
+  test_parser_error();
+}
+
+static void test_sax() {
+  test_sax_events();
+  test_sax_stop();
+  test_sax_error();
+  test_sax_input();
+}
+
+static void test_push() {
+  test_push_split();
+  test_push_stream();
+  test_push_error();
+}
+
+static void test_two_stage() {
+  test_index_positions();
+  test_two_stage_parse();
+}
+
+static void test_ndjson() {
+  test_ndjson_parse();
+  test_ndjson_unordered();
+}
+
+static void test_ondemand() {
+  test_ondemand_lookup();
+  test_ondemand_error();
+}
+
+static void test_tape() {
+  test_tape_parse();
+  test_tape_parse_error();
+  test_tape_engines();
 }
 
 int main() {
   test_parse();
   test_access();
+  test_arena();
+  test_compact();
+  test_parser();
+  test_stringify();
+  test_writer();
+  test_sax();
+  test_push();
+  test_ndjson();
+  test_two_stage();
+  test_tape();
+  test_ondemand();
   printf("%d/%d (%3.2f%%) passed\n", test_pass, test_count, test_pass * 100.0 / test_count);
   return main_ret;
 }